@@ -15,9 +15,14 @@ public:
   struct CellState {
     bool curr{false};
     bool prev{false};
+    bool shown{false};
   };
   std::vector<std::vector<CellState>> cells;
 
+  // The grid and cells are painted into a canvas, and only the cells that
+  // changed since the last frame are painted again
+  std::shared_ptr<baphomet::PixelCanvas> canvas{nullptr};
+
   std::vector<int> stay{2, 3};
   std::vector<int> born{3};
 
@@ -34,6 +39,13 @@ public:
         std::vector<CellState>(CELL_COLS)
     );
 
+    canvas = gfx->make_pixel_canvas(
+        CELL_COLS * CELL_SIZE + CELL_COLS + 1,
+        CELL_ROWS * CELL_SIZE + CELL_ROWS + 1,
+        true
+    );
+    paint_grid();
+
     timer->every("Simulate", 16.667ms, [&]{ step_simulate(); });
     timer->pause("Simulate");
   }
@@ -67,8 +79,8 @@ public:
   void draw() override {
     gfx->clear(BG_COLOR);
 
-    draw_grid();
-    draw_cells();
+    paint_cells();
+    gfx->draw_pixel_canvas(canvas, WIN_PADW, WIN_PADH);
 
     if (is_in_grid(input->mouse.x, input->mouse.y)) {
       auto cell_pos = mouse_pos_to_cell_pos(input->mouse.x, input->mouse.y);
@@ -151,23 +163,12 @@ public:
       }
   }
 
-  void draw_grid() {
+  void paint_grid() {
+    canvas->fill(BG_COLOR);
     for (int r = 0; r <= CELL_ROWS; ++r)
-      gfx->line(
-          WIN_PADW,
-          WIN_PADH + r * CELL_SIZE + r,
-          window->w() - WIN_PADW,
-          WIN_PADH + r * CELL_SIZE + r,
-          GRID_COLOR
-      );
+      canvas->fill_rect(0, r * CELL_SIZE + r, canvas->w(), 1, GRID_COLOR);
     for (int c = 0; c <= CELL_COLS; ++c)
-      gfx->line(
-          WIN_PADW + c * CELL_SIZE + c,
-          WIN_PADH,
-          WIN_PADW + c * CELL_SIZE + c,
-          window->h() - WIN_PADH,
-          GRID_COLOR
-      );
+      canvas->fill_rect(c * CELL_SIZE + c, 0, 1, canvas->h(), GRID_COLOR);
   }
 
   void draw_cell(int r, int c, const baphomet::RGB &color) {
@@ -180,11 +181,19 @@ public:
     );
   }
 
-  void draw_cells() {
+  void paint_cells() {
     for (int r = 0; r < CELL_ROWS; ++r)
       for (int c = 0; c < CELL_COLS; ++c)
-        if (cells[r][c].curr)
-          draw_cell(r, c, CELL_COLOR);
+        if (cells[r][c].curr != cells[r][c].shown) {
+          canvas->fill_rect(
+              c * CELL_SIZE + c + 1,
+              r * CELL_SIZE + r + 1,
+              CELL_SIZE,
+              CELL_SIZE,
+              cells[r][c].curr ? CELL_COLOR : BG_COLOR
+          );
+          cells[r][c].shown = cells[r][c].curr;
+        }
   }
 };
 
@@ -72,6 +72,10 @@ private:
 
   FrameCounter frame_counter_{};
 
+  // Seconds between redraws of the (cached) overlay, unless something
+  // invalidates it sooner
+  static constexpr double OVERLAY_REFRESH_INTERVAL_{0.25};
+
   struct {
     bool enabled{false};
 
@@ -79,6 +83,9 @@ private:
 
     std::unique_ptr<CP437> font{nullptr};
 
+    // Frame time that has passed since the overlay was last drawn
+    Duration pending_dt{Duration::zero()};
+
     struct {
       std::deque<DebugLogLine> lines{};
     } log;
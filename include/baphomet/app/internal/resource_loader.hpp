@@ -17,6 +17,8 @@ public:
 
   const std::shared_ptr<gl::TextureUnit> &get_texture_unit(const std::string &name);
 
+  void unload_texture_unit(const std::string &name);
+
   static std::string resolve_resource_path(const std::string &path);
 
 private:
@@ -3,10 +3,15 @@
 #include "baphomet/app/application.hpp"
 #include "baphomet/app/runner.hpp"
 
+#include "baphomet/gfx/camera.hpp"
 #include "baphomet/gfx/color.hpp"
+#include "baphomet/gfx/draw_recorder.hpp"
 #include "baphomet/gfx/particle_system.hpp"
+#include "baphomet/gfx/pixel_canvas.hpp"
 #include "baphomet/gfx/spritesheet.hpp"
+#include "baphomet/gfx/static_layer.hpp"
 #include "baphomet/gfx/texture.hpp"
+#include "baphomet/gfx/tilemap.hpp"
 
 #include "baphomet/mgr/timermgr.hpp"
 
@@ -0,0 +1,54 @@
+#pragma once
+
+/* A view onto a render target's drawing: a viewport (the part of the target
+ * it draws into, in target pixels) plus a view transform (which point of
+ * the world is at the viewport's centre, zoom and rotation). A render target
+ * with cameras draws everything it was given once per camera, from the same
+ * vertex buffers, so split screens and minimaps don't have to issue their
+ * draws again.
+ *
+ * The default view maps world coordinates one to one onto the viewport.
+ */
+
+#include "baphomet/util/shapes.hpp"
+
+#include "glm/glm.hpp"
+
+namespace baphomet {
+
+class Camera {
+public:
+  Camera() = default;
+  Camera(float x, float y, float w, float h);
+
+  Camera &viewport(float x, float y, float w, float h);
+  Rect viewport() const;
+
+  // The world point shown at the middle of the viewport
+  Camera &center(float x, float y);
+  Point center() const;
+
+  Camera &zoom(float zoom);
+  float zoom() const;
+
+  // Degrees, rotating the view about its centre
+  Camera &angle(float angle);
+  float angle() const;
+
+  // World to clip space, for a viewport of this size
+  glm::mat4 projection() const;
+
+  // World to viewport pixels, the part of projection() the camera adds
+  glm::mat4 view() const;
+
+  // The axis-aligned part of the world the viewport can see
+  Rect visible() const;
+
+private:
+  Rect viewport_{};
+  Point center_{};
+  float zoom_{1.0f};
+  float angle_{0.0f};
+};
+
+} // namespace baphomet
@@ -0,0 +1,267 @@
+#pragma once
+
+/* Draw calls captured away from the main thread, to be merged into a render
+ * target later with GfxMgr::merge_recorders. A recorder touches no OpenGL
+ * state, so each worker thread can fill its own while the main thread (or
+ * another worker) does something else. A single recorder must not be used
+ * from more than one thread at a time.
+ *
+ * Each draw is turned into vertices as it's recorded, by the same code the
+ * batches use, and kept in plain arrays per batch, with depths counted from
+ * 0 for the recorder. Merging only adds the target's current depth to them
+ * and appends the arrays to the target's batches, so the work stays on the
+ * recording threads.
+ *
+ * Every draw is recorded under the sort key current at the time. Merging
+ * takes each run of draws recorded under one key as a whole, in ascending
+ * key order, and within one key in the order the recorders were passed and
+ * the draws were recorded, so giving each thread its own key (or range of
+ * keys) reserves it a slice of the draw order no matter when it finishes.
+ *
+ * Culling and damage tracking happen while recording, so a recorder has to
+ * be told about them up front; GfxMgr::make_recorder hands out one set up
+ * like the current render target. Translucent draws always go to the batch
+ * of their own type, even into targets that unify their alpha batches.
+ */
+
+#include "baphomet/gfx/color.hpp"
+#include "baphomet/util/shapes.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace baphomet {
+
+namespace gl {
+enum class BatchType;
+class TextureArray;
+class TextureUnit;
+} // namespace gl
+
+class BatchSet;
+class Spritesheet;
+class Texture;
+struct TextureSource;
+
+class DrawRecorder {
+  friend class BatchSet;
+
+public:
+  explicit DrawRecorder(std::uint64_t sort_key = 0);
+
+  // Applies to everything recorded from now on
+  void sort_key(std::uint64_t key);
+  std::uint64_t sort_key() const;
+
+  // Draws lying entirely outside the rectangle, after rotation, are
+  // dropped as they're recorded. Unlimited until this is called.
+  void cull_to(float x, float y, float w, float h);
+
+  // Keeps what the target needs to work out damage from these draws.
+  // Merging a recorder that doesn't into a target tracking damage marks
+  // all of it damaged. Off by default.
+  void track_damage(bool enable);
+
+  void clear();
+
+  bool empty() const;
+
+  // Draws recorded since the last clear, not counting culled ones
+  std::size_t size() const;
+
+  std::size_t culled_count() const;
+
+  void pixel(float x, float y, const baphomet::RGB &color);
+  void pixel(Point p, const baphomet::RGB &color);
+
+  void line(float x0, float y0, float x1, float y1, const baphomet::RGB &color, float cx, float cy, float angle);
+  void line(float x0, float y0, float x1, float y1, const baphomet::RGB &color);
+  void line(Line l, const baphomet::RGB &color);
+
+  void fill_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle);
+  void fill_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color);
+  void fill_tri(Tri t, const baphomet::RGB &color);
+
+  void fill_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle);
+  void fill_rect(float x, float y, float w, float h, const baphomet::RGB &color, float angle);
+  void fill_rect(float x, float y, float w, float h, const baphomet::RGB &color);
+  void fill_rect(Rect r, const baphomet::RGB &color);
+
+  void fill_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle);
+  void fill_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color);
+  void fill_oval(Oval o, const baphomet::RGB &color);
+
+  void fill_circle(float x, float y, float radius, const baphomet::RGB &color);
+  void fill_circle(Circle c, const baphomet::RGB &color);
+
+  void draw_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle);
+  void draw_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color);
+  void draw_tri(Tri t, const baphomet::RGB &color);
+
+  void draw_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle);
+  void draw_rect(float x, float y, float w, float h, const baphomet::RGB &color, float angle);
+  void draw_rect(float x, float y, float w, float h, const baphomet::RGB &color);
+  void draw_rect(Rect r, const baphomet::RGB &color);
+
+  void draw_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle);
+  void draw_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color);
+  void draw_oval(Oval o, const baphomet::RGB &color);
+
+  void draw_circle(float x, float y, float radius, const baphomet::RGB &color);
+  void draw_circle(Circle c, const baphomet::RGB &color);
+
+  // The same as Texture::draw, with (tx, ty, tw, th) in the texture's own
+  // pixels wherever it was packed. Only textures loaded through GfxMgr
+  // can be recorded; others are skipped.
+  void texture(
+      const Texture &tex,
+      float x, float y, float w, float h,
+      float tx, float ty, float tw, float th,
+      float cx, float cy, float angle,
+      const baphomet::RGB &color = rgb(0xffffff)
+  );
+
+  void texture(
+      const Texture &tex,
+      float x, float y, float w, float h,
+      const baphomet::RGB &color = rgb(0xffffff)
+  );
+
+  void texture(
+      const Texture &tex,
+      float x, float y,
+      const baphomet::RGB &color = rgb(0xffffff)
+  );
+
+  // The same as Spritesheet::draw. Names the sheet doesn't have are
+  // skipped.
+  void sprite(
+      const Spritesheet &sheet,
+      const std::string &name,
+      float x, float y, float w, float h,
+      float cx, float cy, float angle,
+      const baphomet::RGB &color = rgb(0xffffff)
+  );
+
+  void sprite(
+      const Spritesheet &sheet,
+      const std::string &name,
+      float x, float y, float w, float h,
+      const baphomet::RGB &color = rgb(0xffffff)
+  );
+
+  void sprite(
+      const Spritesheet &sheet,
+      const std::string &name,
+      float x, float y,
+      const baphomet::RGB &color = rgb(0xffffff)
+  );
+
+private:
+  // Which draw a damage record came from, so different draws with the
+  // same arguments don't compare equal
+  enum class Kind_ : std::uint8_t {
+    pixel, line,
+    fill_tri, fill_rect, fill_oval,
+    draw_tri, draw_rect, draw_oval,
+    texture, sprite
+  };
+
+  // Screen space bounding box, padded the way BatchSet pads its own
+  struct Bounds_ {
+    float x0, y0, x1, y1;
+  };
+
+  // Vertices bound for one batch of the target, laid out the way that
+  // batch lays them out. Lined batches also number their vertices from 0
+  // in the index arrays.
+  struct Span_ {
+    gl::BatchType type;
+
+    // Texture and sprite batches are per texture, keyed by name
+    std::string name{};
+    std::shared_ptr<gl::TextureUnit> unit{nullptr};
+    std::shared_ptr<gl::TextureArray> pages{nullptr};
+
+    std::vector<float> opaque{};
+    std::vector<float> alpha{};
+    std::vector<unsigned int> opaque_indices{};
+    std::vector<unsigned int> alpha_indices{};
+  };
+
+  // One translucent draw, in slots of its span's alpha vertices (indices
+  // for lined spans)
+  struct AlphaCmd_ {
+    std::uint32_t span;
+    std::uint32_t first, count;
+    Bounds_ bounds;
+  };
+
+  struct Damage_ {
+    std::uint64_t hash;
+    Bounds_ bounds;
+  };
+
+  // Everything recorded under one sort key in a row. Draws take depths
+  // 0 to z_count - 1 in recording order.
+  struct Run_ {
+    std::uint64_t key{0};
+    std::vector<Span_> spans{};
+    std::vector<AlphaCmd_> alpha_cmds{};
+    std::vector<Damage_> damage{};
+    float z_count{0.0f};
+  };
+
+  std::uint64_t sort_key_{0};
+
+  // Runs past run_count_ are left over from before the last clear, and
+  // kept for their storage
+  std::vector<Run_> runs_{};
+  std::size_t run_count_{0};
+  std::size_t last_span_{0};
+
+  Bounds_ cull_{
+      -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+      std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity()
+  };
+  std::size_t culled_count_{0};
+
+  bool track_damage_{false};
+
+  Bounds_ bounds_of_(std::initializer_list<float> points, float cx, float cy, float angle) const;
+
+  // Counts it, if so
+  bool culled_(const Bounds_ &bounds);
+
+  // The run being recorded into, started if the sort key changed
+  Run_ &run_();
+
+  // The span of run for the batch, started if there isn't one yet
+  Span_ &span_(Run_ &run, gl::BatchType type, const std::string &name = {});
+
+  // Makes room for n more elements at the end of v
+  template <typename T>
+  static std::span<T> grow_(std::vector<T> &v, std::size_t n);
+
+  template <typename... Ts>
+  void track_damage_values_(Run_ &run, const Bounds_ &bounds, Kind_ kind, const Ts &...values);
+
+  // Finishes a draw that just wrote its vertices to the end of span, taking
+  // up count slots (or indices) of its alpha arrays if translucent
+  void close_(Run_ &run, const Span_ &span, bool translucent, std::size_t count, const Bounds_ &bounds);
+
+  void texture_(
+      const TextureSource &source,
+      float x, float y, float w, float h,
+      float tx, float ty, float tw, float th,
+      float cx, float cy, float angle,
+      const baphomet::RGB &color
+  );
+};
+
+} // namespace baphomet
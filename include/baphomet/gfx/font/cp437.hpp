@@ -11,7 +11,8 @@ public:
       TexRenderFunc render_func,
       const std::string &name,
       GLuint width, GLuint height,
-      GLuint char_w, GLuint char_h
+      GLuint char_w, GLuint char_h,
+      TextureSource source = {}
   );
 
   GLuint char_w() const;
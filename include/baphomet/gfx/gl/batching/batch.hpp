@@ -1,25 +1,43 @@
 #pragma once
 
+#include "baphomet/gfx/gl/batching/vertex_layout.hpp"
+#include "baphomet/gfx/gl/frame_block.hpp"
 #include "baphomet/gfx/gl/shader.hpp"
+#include "baphomet/gfx/gl/stream_ring.hpp"
 #include "baphomet/gfx/gl/vec_buffer.hpp"
 #include "baphomet/gfx/gl/vertex_array.hpp"
 
 #include "glm/glm.hpp"
 
 #include <memory>
+#include <span>
+#include <vector>
 
 namespace baphomet::gl {
 
-enum class BatchType { none, pixel, line, tri, rect, oval, lined, texture };
+enum class BatchType { none, pixel, line, tri, rect, oval, lined, texture, sprite, uber, static_layer };
+
+// A range of the alpha buffer, in slots (or indices for LinedBatch)
+struct DrawRange {
+  GLint first;
+  GLsizei count;
+};
 
 class Batch {
 public:
   BatchType type{BatchType::none};
 
-  Batch(std::size_t floats_per_vertex, BatchType type);
+  Batch(VertexLayout layout, BatchType type);
 
   virtual void clear();
 
+  // Vertices are streamed through ring from now on, if it isn't null
+  void stream_through(std::shared_ptr<StreamRing> ring);
+
+  // Hash buffer contents before uploading them, skipping the upload when
+  // they match what is already on the GPU
+  virtual void fingerprint_uploads(bool enable);
+
   bool empty_opaque();
   bool empty_alpha();
 
@@ -29,19 +47,60 @@ public:
   virtual std::size_t vertex_count_opaque();
   virtual std::size_t vertex_count_alpha();
 
-  virtual void draw_opaque(float z_max, glm::mat4 projection) = 0;
-  virtual void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) = 0;
+  // Both draw with whatever FrameBlock constants were written last
+  virtual void draw_opaque() = 0;
+
+  // Draws every range with the shader bound once, submitting them together where the batch can
+  virtual void draw_alpha(std::span<const DrawRange> ranges) = 0;
+
+  // Appends vertices made by the batch's static write, in the order they
+  // were written, with z_offset added to every z. Lets them be made away
+  // from the batch, on any thread (see DrawRecorder).
+  void append_opaque(std::span<const float> vertices, float z_offset);
+  void append_alpha(std::span<const float> vertices, float z_offset);
 
 protected:
+  VertexLayout layout_{};
   std::size_t floats_per_vertex_{0};
 
-  std::unique_ptr<Shader> shader_{nullptr};
+  // Vertices making up one primitive, and the slot of each vertex that
+  // holds its z
+  std::size_t prim_vertices_{1};
+  std::size_t z_slot_{2};
+
+  // Shared by every batch of the same type
+  std::shared_ptr<Shader> shader_{nullptr};
 
   std::unique_ptr<VertexArray> opaque_vao_{nullptr};
   std::unique_ptr<VecBuffer<float>> opaque_vertices_{nullptr};
 
   std::unique_ptr<VertexArray> alpha_vao_{nullptr};
   std::unique_ptr<VecBuffer<float>> alpha_vertices_{nullptr};
+
+  std::shared_ptr<StreamRing> stream_ring_{nullptr};
+  bool fingerprint_{false};
+
+  // Scratch space for building multi-draws, kept around between frames
+  std::vector<GLint> multi_firsts_{};
+  std::vector<GLsizei> multi_counts_{};
+
+  // projection and z_max come from the FrameBlock written for the pass
+  void use_shader_();
+
+  void draw_alpha_arrays_(DrawMode mode, std::span<const DrawRange> ranges);
+
+  std::unique_ptr<VecBuffer<float>> make_vertices_(std::size_t initial_size, bool front_to_back);
+
+  // Creates the buffers and vertex arrays the first time they're needed
+  virtual void init_opaque_();
+  virtual void init_alpha_();
+
+  // Copies whole vertices from src to dst, adding z_offset to their z
+  void copy_rebased_(std::span<const float> src, std::span<float> dst, float z_offset) const;
+
+  // Syncs vertices and points vao at whichever buffer they ended up in,
+  // returning the index of vertex 0 of the VecBuffer in that buffer
+  GLint sync_vertices_(VecBuffer<float> *vertices, VertexArray *vao, const std::vector<AttrDef> &definitions);
 };
 
 } // namespace baphomet::gl
@@ -0,0 +1,46 @@
+#pragma once
+
+/* Batches whose primitives all share one shape (rects, ovals, textured quads)
+ * store a single record per primitive and draw it over a shared unit mesh
+ * with instancing, instead of expanding every primitive into full vertices
+ * on the CPU.
+ *
+ * For these batches floats_per_vertex_ is the number of slots per instance
+ * record. Ranges given to draw_alpha are still in slots, so BatchSet
+ * can treat them like any other batch.
+ */
+
+#include "baphomet/gfx/gl/batching/batch.hpp"
+#include "baphomet/gfx/gl/static_buffer.hpp"
+
+#include <vector>
+
+namespace baphomet::gl {
+
+class InstancedBatch : public Batch {
+public:
+  // The mesh is a list of 2d positions, drawn as triangles, which is
+  // exposed to the shaders at location 0. The instance layout follows
+  // from location 1.
+  InstancedBatch(VertexLayout instance_layout, BatchType type, const std::vector<float> &mesh);
+
+  std::size_t vertex_count_opaque() override;
+  std::size_t vertex_count_alpha() override;
+
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
+
+protected:
+  std::unique_ptr<StaticBuffer<float>> mesh_{nullptr};
+  GLsizei mesh_vertex_count_{0};
+
+  std::vector<AttrDef> instance_definitions_{};
+
+  void init_opaque_() override;
+  void init_alpha_() override;
+
+private:
+  void init_vao_(std::unique_ptr<VertexArray> &vao, const VecBuffer<float> *instances);
+};
+
+} // namespace baphomet::gl
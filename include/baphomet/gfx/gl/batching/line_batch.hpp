@@ -6,6 +6,9 @@ namespace baphomet::gl {
 
 class LineBatch : public Batch {
 public:
+  // Slots written per line, 2 vertices of 4
+  static constexpr std::size_t SLOTS{8};
+
   LineBatch();
   ~LineBatch() = default;
 
@@ -13,19 +16,29 @@ public:
     float x0, float y0,
     float x1, float y1,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  // Writes the vertices add would, into SLOTS slots of dst
+  static void write(
+    std::span<float> dst,
+    float x0, float y0,
+    float x1, float y1,
+    float z,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
-  void draw_opaque(float z_max, glm::mat4 projection) override;
-  void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) override;
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
 
 private:
   void add_opaque_(
     float x0, float y0,
     float x1, float y1,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
@@ -33,7 +46,7 @@ private:
     float x0, float y0,
     float x1, float y1,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 };
@@ -6,17 +6,27 @@ namespace baphomet::gl {
 
 class LinedBatch : public Batch {
 public:
+  // Ends each outline in the index buffers
+  static constexpr unsigned int RESTART_INDEX{65565};
+
+  // Slots per vertex, and slots and indices written per outline
+  static constexpr std::size_t VERTEX_SLOTS{4};
+  static constexpr std::size_t TRI_SLOTS{12}, TRI_INDICES{4};
+  static constexpr std::size_t RECT_SLOTS{16}, RECT_INDICES{5};
+
   LinedBatch();
   ~LinedBatch() = default;
 
   void clear() override;
 
+  void fingerprint_uploads(bool enable) override;
+
   void add_tri(
       float x0, float y0,
       float x1, float y1,
       float x2, float y2,
       float z,
-      float r, float g, float b, float a,
+      std::uint32_t color,
       float cx, float cy, float angle
   );
 
@@ -24,40 +34,67 @@ public:
       float x, float y,
       float w, float h,
       float z,
-      float r, float g, float b, float a,
+      std::uint32_t color,
+      float cx, float cy, float angle
+  );
+
+  // Write the vertices and indices add_tri and add_rect would, into
+  // dst and dst_indices, numbering the vertices from base
+  static void write_tri(
+      std::span<float> dst,
+      std::span<unsigned int> dst_indices,
+      unsigned int base,
+      float x0, float y0,
+      float x1, float y1,
+      float x2, float y2,
+      float z,
+      std::uint32_t color,
       float cx, float cy, float angle
   );
 
-  void add_oval(
+  static void write_rect(
+      std::span<float> dst,
+      std::span<unsigned int> dst_indices,
+      unsigned int base,
       float x, float y,
-      float x_radius, float y_radius,
+      float w, float h,
       float z,
-      float r, float g, float b, float a,
+      std::uint32_t color,
       float cx, float cy, float angle
   );
 
+  // Like Batch::append_*, along with indices numbered from 0, which are
+  // moved to wherever the vertices end up
+  void append_opaque(std::span<const float> vertices, std::span<const unsigned int> indices, float z_offset);
+  void append_alpha(std::span<const float> vertices, std::span<const unsigned int> indices, float z_offset);
+
   std::size_t size_opaque() override;
   std::size_t size_alpha() override;
 
   std::size_t vertex_count_opaque() override;
   std::size_t vertex_count_alpha() override;
 
-  void draw_opaque(float z_max, glm::mat4 projection) override;
-  void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) override;
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
 
 private:
   std::unique_ptr<VecBuffer<unsigned int>> opaque_indices_{nullptr};
   std::unique_ptr<VecBuffer<unsigned int>> alpha_indices_{nullptr};
 
+  std::vector<const void *> multi_offsets_{};
+  std::vector<GLint> multi_base_vertices_{};
+
   void check_initialize_opaque_();
   void check_initialize_alpha_();
 
+  static void copy_indices_(std::span<const unsigned int> src, std::span<unsigned int> dst, unsigned int base);
+
   void add_tri_opaque_(
       float x0, float y0,
       float x1, float y1,
       float x2, float y2,
       float z,
-      float r, float g, float b, float a,
+      std::uint32_t color,
       float cx, float cy, float angle
   );
 
@@ -66,7 +103,7 @@ private:
       float x1, float y1,
       float x2, float y2,
       float z,
-      float r, float g, float b, float a,
+      std::uint32_t color,
       float cx, float cy, float angle
   );
 
@@ -74,7 +111,7 @@ private:
       float x, float y,
       float w, float h,
       float z,
-      float r, float g, float b, float a,
+      std::uint32_t color,
       float cx, float cy, float angle
   );
 
@@ -82,51 +119,9 @@ private:
       float x, float y,
       float w, float h,
       float z,
-      float r, float g, float b, float a,
-      float cx, float cy, float angle
-  );
-
-  void add_oval_opaque_(
-      float x, float y,
-      float x_radius, float y_radius,
-      float z,
-      float r, float g, float b, float a,
-      float cx, float cy, float angle
-  );
-
-  void add_oval_opaque_recurse_(
-      std::vector<float> &vertices,
-      std::vector<unsigned int> &indices,
-      unsigned int &base,
-      float x, float y,
-      float x_radius, float y_radius,
-      float z,
-      float r, float g, float b, float a,
-      float cx, float cy, float angle,
-      float x0, float y0, float a0,
-      float x1, float y1, float a1
-  );
-
-  void add_oval_alpha_(
-      float x, float y,
-      float x_radius, float y_radius,
-      float z,
-      float r, float g, float b, float a,
+      std::uint32_t color,
       float cx, float cy, float angle
   );
-
-  void add_oval_alpha_recurse_(
-      std::vector<float> &vertices,
-      std::vector<unsigned int> &indices,
-      unsigned int &base,
-      float x, float y,
-      float x_radius, float y_radius,
-      float z,
-      float r, float g, float b, float a,
-      float cx, float cy, float angle,
-      float x0, float y0, float a0,
-      float x1, float y1, float a1
-  );
 };
 
 } // namespace baphomet::gl
@@ -1,24 +1,26 @@
 #pragma once
 
-/* The tessellation strategy is described here:
- *   http://www.humus.name/index.php?page=News&ID=228
-
- * ...specifically the third option shown that is called "max area"
- * This seems to give very good performance, and means there is
- * not a bunch of hand-tuning done to handle how many vertices
- * the circle should have depending on the size, as it is 
- * recursive.
- * 
- * It may be a good idea to convert this to an iterative algo instead
- * of using recursion so there's no chance of overflowing the stack
+/* Ovals are drawn as instances of a single quad covering each oval's
+ * bounds, with the fragment shader working out the signed distance (in
+ * pixels) to the edge. The CPU does the same small amount of work, and
+ * the GPU draws two triangles, no matter how large the oval is.
+ *
+ * The distance also gives antialiased edges in the alpha pass. The opaque
+ * pass has no blending, so there the edge is cut off at half coverage.
+ *
+ * Outlines are the same quads, shaded only within half a line width of
+ * the edge, so they share the batch with filled ovals.
  */
 
-#include "baphomet/gfx/gl/batching/batch.hpp"
+#include "baphomet/gfx/gl/batching/instanced_batch.hpp"
 
 namespace baphomet::gl {
 
-class OvalBatch : public Batch {
+class OvalBatch : public InstancedBatch {
 public:
+  // Slots in each instance record
+  static constexpr std::size_t SLOTS{11};
+
   OvalBatch();
   ~OvalBatch() = default;
 
@@ -26,48 +28,54 @@ public:
     float x, float y,
     float x_radius, float y_radius,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
-  void draw_opaque(float z_max, glm::mat4 projection) override;
-  void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) override;
-
-private:
-  void add_opaque_(
+  // A line_width wide outline, centred on the edge of the oval
+  void add_outline(
     float x, float y,
     float x_radius, float y_radius,
+    float line_width,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
-  void add_opaque_recurse_(
+  // Writes the record add (line_width 0) or add_outline would, into SLOTS
+  // slots of dst
+  static void write(
+    std::span<float> dst,
     float x, float y,
     float x_radius, float y_radius,
+    float line_width,
     float z,
-    float r, float g, float b, float a,
-    float cx, float cy, float angle,
-    float x0, float y0, float a0,
-    float x1, float y1, float a1
+    std::uint32_t color,
+    float cx, float cy, float angle
   );
 
-  void add_alpha_(
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
+
+private:
+  Uniform<bool> opaque_{};
+
+  void add_opaque_(
     float x, float y,
     float x_radius, float y_radius,
+    float line_width,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
-  void add_alpha_recurse_(
+  void add_alpha_(
     float x, float y,
     float x_radius, float y_radius,
+    float line_width,
     float z,
-    float r, float g, float b, float a,
-    float cx, float cy, float angle,
-    float x0, float y0, float a0,
-    float x1, float y1, float a1
+    std::uint32_t color,
+    float cx, float cy, float angle
   );
 };
 
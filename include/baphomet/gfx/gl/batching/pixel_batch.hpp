@@ -6,29 +6,40 @@ namespace baphomet::gl {
 
 class PixelBatch : public Batch {
 public:
+  // Slots written per pixel
+  static constexpr std::size_t SLOTS{4};
+
   PixelBatch();
   ~PixelBatch() = default;
 
   void add(
     float x, float y,
     float z,
-    float r, float g, float b, float a
+    std::uint32_t color
+  );
+
+  // Writes the vertex add would, into SLOTS slots of dst
+  static void write(
+    std::span<float> dst,
+    float x, float y,
+    float z,
+    std::uint32_t color
   );
 
-  void draw_opaque(float z_max, glm::mat4 projection) override;
-  void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) override;
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
 
 private:
   void add_opaque_(
     float x, float y,
     float z,
-    float r, float g, float b, float a
+    std::uint32_t color
   );
 
   void add_alpha_(
     float x, float y,
     float z,
-    float r, float g, float b, float a
+    std::uint32_t color
   );
 };
 
@@ -1,11 +1,14 @@
 #pragma once
 
-#include "baphomet/gfx/gl/batching/batch.hpp"
+#include "baphomet/gfx/gl/batching/instanced_batch.hpp"
 
 namespace baphomet::gl {
 
-class RectBatch : public Batch {
+class RectBatch : public InstancedBatch {
 public:
+  // Slots in each instance record
+  static constexpr std::size_t SLOTS{10};
+
   RectBatch();
   ~RectBatch() = default;
 
@@ -13,19 +16,26 @@ public:
     float x, float y,
     float w, float h,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
-  void draw_opaque(float z_max, glm::mat4 projection) override;
-  void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) override;
+  // Writes the record add would, into SLOTS slots of dst
+  static void write(
+    std::span<float> dst,
+    float x, float y,
+    float w, float h,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
 
 private:
   void add_opaque_(
     float x, float y,
     float w, float h,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
@@ -33,7 +43,7 @@ private:
     float x, float y,
     float w, float h,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 };
@@ -0,0 +1,77 @@
+#pragma once
+
+/* Like TextureBatch, but drawing from the layers of a TextureArray, so any
+ * mix of textures loaded into the same array goes into one batch. The layer
+ * is part of each instance record.
+ */
+
+#include "baphomet/gfx/gl/batching/instanced_batch.hpp"
+#include "baphomet/gfx/gl/texture_array.hpp"
+
+namespace baphomet::gl {
+
+class SpriteBatch : public InstancedBatch {
+public:
+  // Slots in each instance record
+  static constexpr std::size_t SLOTS{15};
+
+  explicit SpriteBatch(std::shared_ptr<TextureArray> pages);
+  ~SpriteBatch() = default;
+
+  // tx, ty, tw, th are in pixels of the given layer
+  void add(
+    int layer,
+    bool fully_opaque,
+    float x, float y,
+    float w, float h,
+    float tx, float ty,
+    float tw, float th,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  // Writes the record add would, into SLOTS slots of dst
+  static void write(
+    std::span<float> dst,
+    const TextureArray &pages,
+    int layer,
+    float x, float y,
+    float w, float h,
+    float tx, float ty,
+    float tw, float th,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
+
+private:
+  std::shared_ptr<TextureArray> pages_{nullptr};
+
+  void add_opaque_(
+    int layer,
+    float x, float y,
+    float w, float h,
+    float tx, float ty,
+    float tw, float th,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void add_alpha_(
+    int layer,
+    float x, float y,
+    float w, float h,
+    float tx, float ty,
+    float tw, float th,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+};
+
+} // namespace baphomet::gl
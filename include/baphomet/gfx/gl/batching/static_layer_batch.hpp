@@ -0,0 +1,56 @@
+#pragma once
+
+/* Draws StaticGeometry recorded earlier, each time at its own offset,
+ * scale and z. Nothing is uploaded per frame; each draw only sets a couple
+ * of uniforms.
+ *
+ * A layer is one ordered list of triangles, so every draw of one goes in
+ * the alpha pass, as a single primitive as far as BatchSet is concerned.
+ */
+
+#include "baphomet/gfx/gl/batching/uber_batch.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace baphomet::gl {
+
+class StaticLayerBatch : public Batch {
+public:
+  StaticLayerBatch();
+  ~StaticLayerBatch() = default;
+
+  void clear() override;
+
+  void add(
+    std::shared_ptr<const StaticGeometry> geometry,
+    float x, float y,
+    float scale_x, float scale_y,
+    float z
+  );
+
+  // Ranges are in draws, rather than slots
+  std::size_t size_opaque() override;
+  std::size_t size_alpha() override;
+
+  std::size_t vertex_count_opaque() override;
+  std::size_t vertex_count_alpha() override;
+
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
+
+private:
+  struct Draw_ {
+    std::shared_ptr<const StaticGeometry> geometry;
+    float x, y;
+    float scale_x, scale_y;
+    float z;
+  };
+
+  std::vector<Draw_> draws_{};
+
+  Uniform<glm::vec4> transform_{};
+  Uniform<float> z_base_{};
+};
+
+} // namespace baphomet::gl
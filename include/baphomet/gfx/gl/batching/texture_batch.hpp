@@ -1,11 +1,11 @@
 #pragma once
 
-#include "baphomet/gfx/gl/batching/batch.hpp"
+#include "baphomet/gfx/gl/batching/instanced_batch.hpp"
 #include "baphomet/gfx/gl/texture_unit.hpp"
 
 namespace baphomet::gl {
 
-class TextureBatch : public Batch {
+class TextureBatch : public InstancedBatch {
 public:
   TextureBatch(const std::shared_ptr<gl::TextureUnit> &texture_unit);
   ~TextureBatch() = default;
@@ -18,16 +18,37 @@ public:
     float tx, float ty,
     float tw, float th,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
-  void draw_opaque(float z_max, glm::mat4 projection) override;
-  void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) override;
+  // Slots in each instance record for texture_unit, which depends on
+  // its size (see half_uvs_exact_)
+  static std::size_t slots(const TextureUnit &texture_unit);
+
+  // Writes the record add would, into slots(texture_unit) slots of dst
+  static void write(
+    std::span<float> dst,
+    const TextureUnit &texture_unit,
+    float x, float y,
+    float w, float h,
+    float tx, float ty,
+    float tw, float th,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
 
 private:
-  const std::shared_ptr<gl::TextureUnit> &texture_unit_;
-  float x_px_unit_{0.0f}, y_px_unit_{0.0f};
+  std::shared_ptr<gl::TextureUnit> texture_unit_{nullptr};
+
+  static VertexLayout instance_layout_(const TextureUnit &texture_unit);
+  // Half float UVs are only used when every texel edge is exactly
+  // representable, which is true for power of two sizes up to 2048
+  static bool half_uvs_exact_(const TextureUnit &texture_unit);
 
   void add_opaque_(
     float x, float y,
@@ -35,7 +56,7 @@ private:
     float tx, float ty,
     float tw, float th,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
@@ -45,7 +66,7 @@ private:
     float tx, float ty,
     float tw, float th,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 };
@@ -6,6 +6,9 @@ namespace baphomet::gl {
 
 class TriBatch : public Batch {
 public:
+  // Slots written per tri, 3 vertices of 4
+  static constexpr std::size_t SLOTS{12};
+
   TriBatch();
   ~TriBatch() = default;
 
@@ -14,12 +17,23 @@ public:
     float x1, float y1,
     float x2, float y2,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  // Writes the vertices add would, into SLOTS slots of dst
+  static void write(
+    std::span<float> dst,
+    float x0, float y0,
+    float x1, float y1,
+    float x2, float y2,
+    float z,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
-  void draw_opaque(float z_max, glm::mat4 projection) override;
-  void draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) override;
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
 
 private:
   void add_opaque_(
@@ -27,7 +41,7 @@ private:
     float x1, float y1,
     float x2, float y2,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 
@@ -36,7 +50,7 @@ private:
     float x1, float y1,
     float x2, float y2,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
   );
 };
@@ -0,0 +1,163 @@
+#pragma once
+
+/* Every primitive type in one vertex format, one shader and one buffer, so
+ * translucent draws can be interleaved freely without splitting the alpha
+ * pass. Everything is expanded into triangles on the CPU, and each vertex
+ * carries a mode that tells the fragment shader how to colour it: solid,
+ * sampled from one of two atlas texture arrays, or an SDF ellipse (filled
+ * or outlined). Lines and outlines become one pixel wide quads.
+ *
+ * Only the alpha pass goes through here; opaque geometry is depth tested
+ * and already draws correctly in any order from the regular batches.
+ */
+
+#include "baphomet/gfx/gl/batching/batch.hpp"
+#include "baphomet/gfx/gl/static_buffer.hpp"
+#include "baphomet/gfx/gl/texture_array.hpp"
+
+#include <array>
+
+namespace baphomet::gl {
+
+// Everything an UberBatch held, frozen into its own buffer
+struct StaticGeometry {
+  std::unique_ptr<StaticBuffer<float>> vertices{nullptr};
+  std::unique_ptr<VertexArray> vao{nullptr};
+  GLsizei vertex_count{0};
+
+  std::array<std::shared_ptr<TextureArray>, 2> pages{};
+
+  // Bounding box of the vertices, as recorded
+  float x0{0.0f}, y0{0.0f}, x1{0.0f}, y1{0.0f};
+};
+
+class UberBatch : public Batch {
+public:
+  UberBatch();
+  ~UberBatch() = default;
+
+  // The shader every UberBatch uses, also used to draw StaticGeometry
+  static std::shared_ptr<Shader> make_shader();
+
+  // Copies what has been added so far into a new StaticGeometry
+  std::shared_ptr<StaticGeometry> bake();
+
+  void clear() override;
+
+  // Whether sprites from pages can go in, which holds until two different
+  // texture arrays have been used this frame
+  bool accepts(const std::shared_ptr<TextureArray> &pages) const;
+
+  void add_pixel(
+    float x, float y,
+    float z,
+    std::uint32_t color
+  );
+
+  void add_line(
+    float x0, float y0,
+    float x1, float y1,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void add_tri(
+    float x0, float y0,
+    float x1, float y1,
+    float x2, float y2,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void add_rect(
+    float x, float y,
+    float w, float h,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void add_oval(
+    float x, float y,
+    float x_radius, float y_radius,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  // tx, ty, tw, th are in pixels of the given layer
+  void add_sprite(
+    const std::shared_ptr<TextureArray> &pages,
+    int layer,
+    float x, float y,
+    float w, float h,
+    float tx, float ty,
+    float tw, float th,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void add_lined_tri(
+    float x0, float y0,
+    float x1, float y1,
+    float x2, float y2,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void add_lined_rect(
+    float x, float y,
+    float w, float h,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void add_lined_oval(
+    float x, float y,
+    float x_radius, float y_radius,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle
+  );
+
+  void draw_opaque() override;
+  void draw_alpha(std::span<const DrawRange> ranges) override;
+
+private:
+  // Must match the constants in the fragment shader
+  enum class Mode_ { solid = 0, pages_0 = 1, pages_1 = 2, oval = 3, oval_outline = 4 };
+
+  std::array<std::shared_ptr<TextureArray>, 2> pages_{};
+
+  struct Corner_ {
+    float x, y;
+    float u, v;
+  };
+
+  void init_alpha_() override;
+
+  void add_tri_(const Corner_ &c0, const Corner_ &c1, const Corner_ &c2, float z, std::uint32_t color, Mode_ mode, float layer);
+
+  // Corners in order around the quad, already rotated
+  void add_quad_(const std::array<Corner_, 4> &corners, float z, std::uint32_t color, Mode_ mode, float layer);
+
+  // One pixel wide, running from (x0, y0) to (x1, y1), lengthened (or
+  // shortened, if negative) by the extends at either end
+  void add_line_quad_(float x0, float y0, float x1, float y1, float extend_start, float extend_end, float z, std::uint32_t color);
+
+  void add_ellipse_(
+    float x, float y,
+    float x_radius, float y_radius,
+    float z,
+    std::uint32_t color,
+    float cx, float cy, float angle,
+    Mode_ mode
+  );
+};
+
+} // namespace baphomet::gl
@@ -0,0 +1,90 @@
+#pragma once
+
+/* Every batch stores its vertices (or instance records) in a VecBuffer<float>,
+ * where each attribute takes a whole number of 4 byte slots. Colors are packed
+ * as normalized RGBA8 into a single slot, and half floats two to a slot, so
+ * a VertexLayout describes both the size of a record and its attributes.
+ */
+
+#include "baphomet/gfx/gl/vertex_array.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace baphomet::gl {
+
+class VertexLayout {
+public:
+  VertexLayout() = default;
+
+  VertexLayout &floats(GLint count);
+  VertexLayout &half_floats(GLint count);
+  VertexLayout &color();
+
+  std::size_t slots() const;
+
+  // Attribute indices are assigned in order starting from first_index
+  std::vector<AttrDef> definitions(GLuint first_index = 0, GLuint divisor = 0) const;
+
+private:
+  struct Attr_ {
+    GLint size;
+    AttrType type;
+    bool normalized;
+    std::size_t slots;
+  };
+
+  std::vector<Attr_> attrs_{};
+  std::size_t slots_{0};
+};
+
+/* Rotation of angle radians about (cx, cy). The sin/cos are computed once
+ * per primitive here instead of once per vertex in the shaders.
+ */
+struct Rotation {
+  float cx{0.0f}, cy{0.0f};
+  float s{0.0f}, c{1.0f};
+
+  Rotation(float cx, float cy, float angle);
+
+  void apply(float &x, float &y) const {
+    if (s == 0.0f && c == 1.0f)
+      return;
+
+    float dx = x - cx, dy = y - cy;
+    x = dx * c - dy * s + cx;
+    y = dx * s + dy * c + cy;
+  }
+};
+
+inline std::uint32_t pack_rgba8(int r, int g, int b, int a) {
+  auto clamp = [](int v) { return static_cast<std::uint32_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); };
+  return clamp(r) | (clamp(g) << 8) | (clamp(b) << 16) | (clamp(a) << 24);
+}
+
+inline std::uint32_t rgba8_alpha(std::uint32_t rgba) {
+  return rgba >> 24;
+}
+
+// Reinterprets a packed color as a float so it can be stored in a slot,
+// keeping the bytes in r, g, b, a order in memory
+inline float rgba8_slot(std::uint32_t rgba) {
+  if constexpr (std::endian::native == std::endian::big)
+    rgba = ((rgba & 0x000000ffu) << 24) | ((rgba & 0x0000ff00u) << 8) |
+           ((rgba & 0x00ff0000u) >> 8)  | ((rgba & 0xff000000u) >> 24);
+  return std::bit_cast<float>(rgba);
+}
+
+float half2_slot(float a, float b);
+
+// Writes values into consecutive elements of dst (as returned from
+// VecBuffer::reserve_*), without staging them in a temporary list first
+template<typename T, typename... Vs>
+inline void write_slots(std::span<T> dst, Vs... values) {
+  std::size_t i = 0;
+  ((dst[i++] = static_cast<T>(values)), ...);
+}
+
+} // namespace baphomet::gl
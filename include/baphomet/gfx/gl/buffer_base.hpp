@@ -2,6 +2,8 @@
 
 #include "glad/gl.h"
 
+#include <cstdint>
+
 namespace baphomet::gl {
 
 enum class BufTarget {
@@ -35,6 +37,16 @@ enum class BufUsage {
   none = 0
 };
 
+// Bytes sent to buffers by VecBuffer::sync, and bytes it didn't have to
+// send because the buffer already held them
+struct UploadStats {
+  std::uint64_t bytes_uploaded{0};
+  std::uint64_t bytes_skipped{0};
+};
+
+// Running totals, until reset
+UploadStats &upload_stats();
+
 class BufferBase {
 protected:
   void gen_id_();
@@ -27,6 +27,7 @@ enum class Capability {
   depth_test = GL_DEPTH_TEST,
   scissor_test = GL_SCISSOR_TEST,
   stencil_test = GL_STENCIL_TEST,
+  primitive_restart = GL_PRIMITIVE_RESTART,
 };
 
 enum class BlendFunc {
@@ -0,0 +1,65 @@
+#pragma once
+
+/* The std140 uniform block every batch program declares as
+ *
+ *   layout (std140) uniform Frame {
+ *     mat4 projection;
+ *     mat4 view;
+ *     float z_max;
+ *   };
+ *
+ * and binds to BINDING. It's written once per render target pass, instead
+ * of each batch setting the same uniforms on its own program.
+ *
+ * Each write goes into its own slot of one buffer, which is orphaned at
+ * the start of every frame, so writing never waits on draws still reading
+ * an earlier pass's constants.
+ */
+
+#include "baphomet/gfx/gl/buffer_base.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+
+namespace baphomet::gl {
+
+class FrameBlock : public BufferBase {
+public:
+  static constexpr GLuint BINDING{0};
+
+  FrameBlock();
+  ~FrameBlock() override = default;
+
+  FrameBlock(const FrameBlock &) = delete;
+  FrameBlock &operator=(const FrameBlock &) = delete;
+
+  void begin_frame();
+
+  // Makes these the constants batches see from now on. Writing the same
+  // values as the last write doesn't use up another slot.
+  void write(const glm::mat4 &projection, const glm::mat4 &view, float z_max);
+
+private:
+  struct Std140_ {
+    glm::mat4 projection{1.0f};
+    glm::mat4 view{1.0f};
+    float z_max{0.0f};
+    float pad_[3]{};
+  };
+  static_assert(sizeof(Std140_) == 144, "Frame block must match the std140 layout");
+
+  static constexpr std::size_t INITIAL_SLOTS_{16};
+
+  // Slot size rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  std::size_t stride_{0};
+  std::size_t capacity_{0};
+  std::size_t next_slot_{0};
+
+  Std140_ last_{};
+  bool written_{false};
+
+  void allocate_(std::size_t slots);
+};
+
+} // namespace baphomet::gl
@@ -1,15 +1,58 @@
 #pragma once
 
+#include "baphomet/util/hash.hpp"
+
 #include "glad/gl.h"
 #include "glm/glm.hpp"
+#include "glm/gtc/type_ptr.hpp"
 
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace baphomet::gl {
 
+// A uniform name along with its hash. String literals are hashed at
+// compile time, and strings when they're converted. Only meant to be
+// passed straight to Shader, since it doesn't own the characters.
+class UniformName {
+public:
+  template<std::size_t N>
+  consteval UniformName(const char (&name)[N]) : name_(name), hash_(fnv1a64(name)) {}
+
+  UniformName(const std::string &name) : name_(name.c_str()), hash_(fnv1a64(name_)) {}
+
+  const char *c_str() const { return name_; }
+  std::uint64_t hash() const { return hash_; }
+
+private:
+  const char *name_;
+  std::uint64_t hash_;
+};
+
+// A uniform location looked up once, usually right after linking, which
+// sets its value without any lookups. Invalid handles set nothing, like
+// the by-name setters. Values go to the program currently in use.
+template<typename T>
+class Uniform {
+public:
+  Uniform() = default;
+  explicit Uniform(GLint loc) : loc_(loc) {}
+
+  bool valid() const { return loc_ != -1; }
+  GLint location() const { return loc_; }
+
+  void set(const T &v) const;
+
+private:
+  GLint loc_{-1};
+};
+
 class Shader {
 public:
   GLuint id{0};
@@ -27,63 +70,101 @@ public:
 
   void use();
 
-  void uniform_1f(const std::string &name, float v);
-  void uniform_2f(const std::string &name, glm::vec2 v);
-  void uniform_3f(const std::string &name, glm::vec3 v);
-  void uniform_4f(const std::string &name, glm::vec4 v);
-
-  void uniform_1d(const std::string &name, double v);
-  void uniform_2d(const std::string &name, glm::dvec2 v);
-  void uniform_3d(const std::string &name, glm::dvec3 v);
-  void uniform_4d(const std::string &name, glm::dvec4 v);
-
-  void uniform_1i(const std::string &name, int v);
-  void uniform_2i(const std::string &name, glm::ivec2 v);
-  void uniform_3i(const std::string &name, glm::ivec3 v);
-  void uniform_4i(const std::string &name, glm::ivec4 v);
-
-  void uniform_1ui(const std::string &name, unsigned int v);
-  void uniform_2ui(const std::string &name, glm::uvec2 v);
-  void uniform_3ui(const std::string &name, glm::uvec3 v);
-  void uniform_4ui(const std::string &name, glm::uvec4 v);
-
-  void uniform_1b(const std::string &name, bool v);
-  void uniform_2b(const std::string &name, glm::bvec2 v);
-  void uniform_3b(const std::string &name, glm::bvec3 v);
-  void uniform_4b(const std::string &name, glm::bvec4 v);
-
-  void uniform_mat2f(const std::string &name, glm::mat2 v, bool transpose = false);
-  void uniform_mat3f(const std::string &name, glm::mat3 v, bool transpose = false);
-  void uniform_mat4f(const std::string &name, glm::mat4 v, bool transpose = false);
-
-  void uniform_mat2d(const std::string &name, glm::dmat2 v, bool transpose = false);
-  void uniform_mat3d(const std::string &name, glm::dmat3 v, bool transpose = false);
-  void uniform_mat4d(const std::string &name, glm::dmat4 v, bool transpose = false);
-
-  void uniform_mat2x3f(const std::string &name, glm::mat2x3 v, bool transpose = false);
-  void uniform_mat3x2f(const std::string &name, glm::mat3x2 v, bool transpose = false);
-  void uniform_mat2x4f(const std::string &name, glm::mat2x4 v, bool transpose = false);
-  void uniform_mat4x2f(const std::string &name, glm::mat4x2 v, bool transpose = false);
-  void uniform_mat3x4f(const std::string &name, glm::mat3x4 v, bool transpose = false);
-  void uniform_mat4x3f(const std::string &name, glm::mat4x3 v, bool transpose = false);
-
-  void uniform_mat2x3d(const std::string &name, glm::dmat2x3 v, bool transpose = false);
-  void uniform_mat3x2d(const std::string &name, glm::dmat3x2 v, bool transpose = false);
-  void uniform_mat2x4d(const std::string &name, glm::dmat2x4 v, bool transpose = false);
-  void uniform_mat4x2d(const std::string &name, glm::dmat4x2 v, bool transpose = false);
-  void uniform_mat3x4d(const std::string &name, glm::dmat3x4 v, bool transpose = false);
-  void uniform_mat4x3d(const std::string &name, glm::dmat4x3 v, bool transpose = false);
+  // Resolves a handle to set the uniform with from then on
+  template<typename T>
+  Uniform<T> uniform(UniformName name);
+
+  void uniform_1f(UniformName name, float v);
+  void uniform_2f(UniformName name, glm::vec2 v);
+  void uniform_3f(UniformName name, glm::vec3 v);
+  void uniform_4f(UniformName name, glm::vec4 v);
+
+  void uniform_1d(UniformName name, double v);
+  void uniform_2d(UniformName name, glm::dvec2 v);
+  void uniform_3d(UniformName name, glm::dvec3 v);
+  void uniform_4d(UniformName name, glm::dvec4 v);
+
+  void uniform_1i(UniformName name, int v);
+  void uniform_2i(UniformName name, glm::ivec2 v);
+  void uniform_3i(UniformName name, glm::ivec3 v);
+  void uniform_4i(UniformName name, glm::ivec4 v);
+
+  void uniform_1ui(UniformName name, unsigned int v);
+  void uniform_2ui(UniformName name, glm::uvec2 v);
+  void uniform_3ui(UniformName name, glm::uvec3 v);
+  void uniform_4ui(UniformName name, glm::uvec4 v);
+
+  void uniform_1b(UniformName name, bool v);
+  void uniform_2b(UniformName name, glm::bvec2 v);
+  void uniform_3b(UniformName name, glm::bvec3 v);
+  void uniform_4b(UniformName name, glm::bvec4 v);
+
+  void uniform_mat2f(UniformName name, glm::mat2 v, bool transpose = false);
+  void uniform_mat3f(UniformName name, glm::mat3 v, bool transpose = false);
+  void uniform_mat4f(UniformName name, glm::mat4 v, bool transpose = false);
+
+  void uniform_mat2d(UniformName name, glm::dmat2 v, bool transpose = false);
+  void uniform_mat3d(UniformName name, glm::dmat3 v, bool transpose = false);
+  void uniform_mat4d(UniformName name, glm::dmat4 v, bool transpose = false);
+
+  void uniform_mat2x3f(UniformName name, glm::mat2x3 v, bool transpose = false);
+  void uniform_mat3x2f(UniformName name, glm::mat3x2 v, bool transpose = false);
+  void uniform_mat2x4f(UniformName name, glm::mat2x4 v, bool transpose = false);
+  void uniform_mat4x2f(UniformName name, glm::mat4x2 v, bool transpose = false);
+  void uniform_mat3x4f(UniformName name, glm::mat3x4 v, bool transpose = false);
+  void uniform_mat4x3f(UniformName name, glm::mat4x3 v, bool transpose = false);
+
+  void uniform_mat2x3d(UniformName name, glm::dmat2x3 v, bool transpose = false);
+  void uniform_mat3x2d(UniformName name, glm::dmat3x2 v, bool transpose = false);
+  void uniform_mat2x4d(UniformName name, glm::dmat2x4 v, bool transpose = false);
+  void uniform_mat4x2d(UniformName name, glm::dmat4x2 v, bool transpose = false);
+  void uniform_mat3x4d(UniformName name, glm::dmat3x4 v, bool transpose = false);
+  void uniform_mat4x3d(UniformName name, glm::dmat4x3 v, bool transpose = false);
 
 private:
-  std::unordered_map<std::string, GLint> attrib_locs_{};
-  std::unordered_map<std::string, GLint> uniform_locs_{};
+  // Keyed by UniformName::hash, which is already well mixed
+  struct Identity_ {
+    std::size_t operator()(std::uint64_t v) const { return static_cast<std::size_t>(v); }
+  };
+  std::unordered_map<std::uint64_t, GLint, Identity_> attrib_locs_{};
+  std::unordered_map<std::uint64_t, GLint, Identity_> uniform_locs_{};
 
-  GLint get_attrib_loc_(const std::string &name);
-  GLint get_uniform_loc_(const std::string &name);
+  GLint get_attrib_loc_(UniformName name);
+  GLint get_uniform_loc_(UniformName name);
 
   void del_id_();
 };
 
+template<typename T>
+Uniform<T> Shader::uniform(UniformName name) {
+  return Uniform<T>(get_uniform_loc_(name));
+}
+
+template<typename T>
+void Uniform<T>::set(const T &v) const {
+  if (loc_ == -1)
+    return;
+
+  if constexpr (std::is_same_v<T, float>)             glUniform1f(loc_, v);
+  else if constexpr (std::is_same_v<T, glm::vec2>)    glUniform2fv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::vec3>)    glUniform3fv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::vec4>)    glUniform4fv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, int>)          glUniform1i(loc_, v);
+  else if constexpr (std::is_same_v<T, glm::ivec2>)   glUniform2iv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::ivec3>)   glUniform3iv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::ivec4>)   glUniform4iv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, unsigned int>) glUniform1ui(loc_, v);
+  else if constexpr (std::is_same_v<T, glm::uvec2>)   glUniform2uiv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::uvec3>)   glUniform3uiv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::uvec4>)   glUniform4uiv(loc_, 1, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, bool>)         glUniform1i(loc_, v ? 1 : 0);
+  else if constexpr (std::is_same_v<T, glm::mat2>)    glUniformMatrix2fv(loc_, 1, GL_FALSE, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::mat3>)    glUniformMatrix3fv(loc_, 1, GL_FALSE, glm::value_ptr(v));
+  else if constexpr (std::is_same_v<T, glm::mat4>)    glUniformMatrix4fv(loc_, 1, GL_FALSE, glm::value_ptr(v));
+  else
+    static_assert(sizeof(T) == 0, "No uniform setter for this type");
+}
+
 class ShaderBuilder {
 public:
   ShaderBuilder();
@@ -105,18 +186,44 @@ public:
 
   ShaderBuilder &varyings(const std::vector<std::string> &vs);
 
+  // Binds the uniform block called name to a buffer binding point, once
+  // the program is linked
+  ShaderBuilder &block(const std::string &name, GLuint binding);
+
   std::unique_ptr<Shader> link();
 
+  // Hands out the program already linked from the same sources if one is
+  // still alive, and links a new one otherwise
+  std::shared_ptr<Shader> link_shared();
+
+  // Linked programs are saved as binaries under dir, keyed by their
+  // sources and the driver, and loaded from there on later runs instead of
+  // being compiled. An empty path turns the cache off. Defaults to a
+  // directory in the user's cache directory ($XDG_CACHE_HOME or ~/.cache,
+  // ~/Library/Caches, %LOCALAPPDATA%), and off if there isn't one.
+  static void binary_cache(const std::filesystem::path &dir);
+
 private:
-  GLuint vert_id_{0u};
-  GLuint frag_id_{0u};
-  GLuint program_id_{0u};
+  std::string vert_src_{};
+  std::string frag_src_{};
+  std::vector<std::string> varyings_{};
+  std::vector<std::pair<std::string, GLuint>> blocks_{};
 
   std::string tag_{};
 
+  // Sources, varyings and blocks, hashed together
+  std::uint64_t key_() const;
+
+  GLuint compile_(GLenum type, const std::string &src);
+
+  bool load_binary_(GLuint program_id, const std::filesystem::path &path);
+  void save_binary_(GLuint program_id, const std::filesystem::path &path);
+
+  std::filesystem::path binary_path_(std::uint64_t key) const;
+
   bool check_compile_(GLuint shader_id, GLenum type);
 
-  bool check_link_();
+  bool check_link_(GLuint program_id);
 
   std::string read_file_(const std::string &path);
 };
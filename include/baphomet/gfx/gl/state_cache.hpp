@@ -0,0 +1,121 @@
+#pragma once
+
+/* Mirrors the bits of GL state the engine changes most often: the
+ * program in use, the bound vertex array, array buffer, textures per
+ * unit, draw and read framebuffers, the viewport, blending and the depth
+ * mask. Every change goes through here, and calls that would set what
+ * is already set never reach the driver.
+ *
+ * Anything that changes this state behind the cache's back (raw GL
+ * calls, other libraries) has to call invalidate afterwards. Deleting an
+ * object has to be reported with forget_*, since GL unbinds it on its
+ * own.
+ */
+
+#include "baphomet/gfx/gl/buffer_base.hpp"
+#include "baphomet/gfx/gl/context_enums.hpp"
+#include "baphomet/gfx/gl/framebuffer.hpp"
+
+#include "glad/gl.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace baphomet::gl {
+
+// State changes made, and ones skipped because they were already in effect
+struct StateStats {
+  std::uint64_t issued{0};
+  std::uint64_t filtered{0};
+};
+
+class StateCache {
+public:
+  // Units past this are still bound, just never filtered
+  static constexpr int MAX_TEXTURE_UNITS{32};
+
+  StateCache() = default;
+
+  StateCache(const StateCache &) = delete;
+  StateCache &operator=(const StateCache &) = delete;
+
+  // Forgets everything, so the next change of each kind is always made
+  void invalidate();
+
+  void use_program(GLuint id);
+  void bind_vertex_array(GLuint id);
+
+  // Only the array target is filtered. Element array bindings belong to
+  // the bound vertex array, so binding one first unbinds the vertex
+  // array, leaving whichever one was last drawn with alone.
+  void bind_buffer(BufTarget target, GLuint id);
+
+  void active_texture(int unit);
+
+  // Binds to the active unit, or to unit, which then becomes active.
+  // Only 2D and 2D array textures are filtered.
+  void bind_texture(GLenum target, GLuint id);
+  void bind_texture(int unit, GLenum target, GLuint id);
+
+  void bind_framebuffer(FboTarget target, GLuint id);
+  void bind_framebuffer(GLuint id);
+
+  void viewport(GLint x, GLint y, GLsizei w, GLsizei h);
+
+  void set_enabled(Capability cap, bool enabled);
+  void depth_mask(bool flag);
+
+  void blend_func(BlendFunc src, BlendFunc dst);
+  void blend_func(BlendFunc src_rgb, BlendFunc dst_rgb, BlendFunc src_alpha, BlendFunc dst_alpha);
+
+  void forget_program(GLuint id);
+  void forget_vertex_array(GLuint id);
+  void forget_buffer(GLuint id);
+  void forget_texture(GLuint id);
+  void forget_framebuffer(GLuint id);
+
+  // Running totals, until reset
+  StateStats &stats();
+
+private:
+  struct TextureBindings_ {
+    std::optional<GLuint> tex_2d{};
+    std::optional<GLuint> tex_2d_array{};
+  };
+
+  std::optional<GLuint> program_{};
+  std::optional<GLuint> vertex_array_{};
+  std::optional<GLuint> array_buffer_{};
+
+  std::optional<int> active_unit_{};
+  std::array<TextureBindings_, MAX_TEXTURE_UNITS> textures_{};
+
+  std::optional<GLuint> draw_fbo_{};
+  std::optional<GLuint> read_fbo_{};
+
+  std::optional<std::array<GLint, 4>> viewport_{};
+
+  std::optional<bool> blend_{};
+  std::optional<bool> depth_test_{};
+  std::optional<bool> scissor_test_{};
+  std::optional<bool> stencil_test_{};
+  std::optional<bool> primitive_restart_{};
+  std::optional<bool> depth_mask_{};
+
+  std::optional<std::array<BlendFunc, 4>> blend_func_{};
+
+  StateStats stats_{};
+
+  // Records value as current, returning whether it was already
+  template<typename T>
+  bool set_(std::optional<T> &current, const T &value);
+
+  std::optional<GLuint> *texture_slot_(int unit, GLenum target);
+  std::optional<bool> *capability_slot_(Capability cap);
+};
+
+// The cache for the one GL context the engine draws with
+StateCache &state_cache();
+
+} // namespace baphomet::gl
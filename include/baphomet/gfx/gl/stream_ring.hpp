@@ -0,0 +1,70 @@
+#pragma once
+
+/* A single persistently and coherently mapped array buffer, split into three
+ * regions that are cycled through frame by frame. Every VecBuffer that streams
+ * through the ring sub-allocates its vertices out of the current frame's
+ * region, and a fence is placed at the end of each frame so a region is only
+ * written to again once the GPU is done reading it.
+ *
+ * Requires ARB_buffer_storage (core in 4.4). If a frame needs more space than
+ * a region has, allocations fail for the rest of that frame (VecBuffer falls
+ * back to its own buffer), and the ring grows at the start of the next frame.
+ */
+
+#include "baphomet/gfx/gl/buffer_base.hpp"
+
+#include "glad/gl.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace baphomet::gl {
+
+class StreamRing : public BufferBase {
+public:
+  static bool supported();
+
+  explicit StreamRing(std::size_t region_size);
+  ~StreamRing() override;
+
+  // Copy constructors don't make sense for OpenGL objects
+  StreamRing(const StreamRing &) = delete;
+  StreamRing &operator=(const StreamRing &) = delete;
+
+  // The mapping and fences make moving this more trouble than it's worth
+  StreamRing(StreamRing &&other) noexcept = delete;
+  StreamRing &operator=(StreamRing &&other) noexcept = delete;
+
+  std::uint64_t frame() const;
+  std::size_t region_size() const;
+
+  // Returns where to write bytes, and sets offset to where they will live in
+  // the buffer, aligned to a multiple of align. Returns nullptr if the current
+  // region is out of space.
+  void *alloc(std::size_t bytes, std::size_t align, std::size_t &offset);
+
+  void begin_frame();
+  void end_frame();
+
+private:
+  static constexpr std::size_t REGION_COUNT_{3};
+
+  std::size_t region_size_{0};
+  std::size_t region_{0}, head_{0};
+  std::size_t overflow_{0};
+  std::uint64_t frame_{0};
+
+  std::byte *mapped_{nullptr};
+  std::array<GLsync, REGION_COUNT_> fences_{};
+
+  void create_storage_();
+  void destroy_storage_();
+  void unmap_();
+
+  void wait_all_();
+
+  void wait_(GLsync &fence);
+};
+
+} // namespace baphomet::gl
@@ -0,0 +1,60 @@
+#pragma once
+
+/* A GL_TEXTURE_2D_ARRAY of square pages. TextureAtlas packs loaded textures
+ * into its layers, so sprites from any of them can be drawn together by
+ * SpriteBatch, selecting the layer per instance.
+ *
+ * The array starts out with a few layers and doubles (up to the driver's
+ * limit) when it runs out, copying the existing layers across.
+ */
+
+#include "baphomet/gfx/gl/texture_unit.hpp"
+
+#include "glad/gl.h"
+
+namespace baphomet::gl {
+
+class TextureArray {
+public:
+  explicit TextureArray(GLsizei page_size, bool retro = false);
+
+  ~TextureArray();
+
+  TextureArray(const TextureArray &) = delete;
+  TextureArray &operator=(const TextureArray &) = delete;
+
+  // Batches hold on to these by pointer, so they stay put
+  TextureArray(TextureArray &&other) noexcept = delete;
+  TextureArray &operator=(TextureArray &&other) noexcept = delete;
+
+  GLuint id() const;
+
+  void bind(int unit = 0);
+  void unbind();
+
+  GLsizei page_size() const;
+  GLsizei layers() const;
+
+  // Returns the index of a fresh layer, or -1 if no more are available
+  int add_layer();
+
+  // Copies all of texture_unit into layer, with its top left at (x, y).
+  // The border texels are also copied outwards into the padding texels
+  // around it, which must lie within the page.
+  void write(int layer, GLsizei x, GLsizei y, const TextureUnit &texture_unit, GLsizei padding = 0);
+
+private:
+  static constexpr GLsizei INITIAL_CAPACITY_{4};
+
+  GLuint id_{0};
+  GLsizei page_size_{0};
+  GLsizei layers_{0}, capacity_{0};
+  bool retro_{false};
+
+  // Replaces the storage with one of the given capacity, keeping the used layers
+  void reallocate_(GLsizei capacity);
+
+  void del_id_();
+};
+
+} // namespace baphomet::gl
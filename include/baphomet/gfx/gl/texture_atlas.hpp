@@ -0,0 +1,59 @@
+#pragma once
+
+/* Packs loaded textures into the pages (layers) of a TextureArray with
+ * stb_rect_pack, one texture at a time as they're loaded. Every page keeps
+ * its own packing state, so later textures fill the gaps left by earlier
+ * ones, and a new page is only started once none of the existing ones have
+ * room.
+ */
+
+#include "baphomet/gfx/gl/texture_array.hpp"
+#include "baphomet/gfx/gl/texture_unit.hpp"
+
+#include "glad/gl.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace baphomet::gl {
+
+class TextureAtlas {
+public:
+  // Where a texture ended up, in pixels of its page
+  struct Region {
+    int layer;
+    GLsizei x, y;
+  };
+
+  explicit TextureAtlas(GLsizei page_size, bool retro = false);
+  ~TextureAtlas();
+
+  TextureAtlas(const TextureAtlas &) = delete;
+  TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+  TextureAtlas(TextureAtlas &&other) noexcept = delete;
+  TextureAtlas &operator=(TextureAtlas &&other) noexcept = delete;
+
+  const std::shared_ptr<TextureArray> &pages() const;
+
+  // Returns nothing if the texture is bigger than a page, or a new page
+  // was needed and the array is out of layers
+  std::optional<Region> add(const TextureUnit &texture_unit);
+
+private:
+  // Space left around each texture, filled with copies of its edge texels.
+  // Filtering near an edge then repeats the edge like GL_CLAMP_TO_EDGE
+  // would, instead of blending in a neighbour or transparent black.
+  static constexpr GLsizei PADDING_{1};
+
+  // stb_rect_pack state, kept out of the header
+  struct Packer_;
+
+  std::shared_ptr<TextureArray> pages_{nullptr};
+  std::vector<std::unique_ptr<Packer_>> packers_{};
+
+  std::optional<Region> pack_(int layer, GLsizei w, GLsizei h);
+};
+
+} // namespace baphomet::gl
@@ -12,6 +12,9 @@ public:
   TextureUnit(const std::string &path, bool retro = false);
   TextureUnit(const std::filesystem::path &path, bool retro = false);
 
+  // Empty RGBA8 storage without mipmaps, for pixels that are written later
+  TextureUnit(GLuint width, GLuint height, bool fully_opaque, bool retro = false);
+
   ~TextureUnit();
 
   TextureUnit(const TextureUnit &) = delete;
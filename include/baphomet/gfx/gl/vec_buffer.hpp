@@ -1,12 +1,18 @@
 #pragma once
 
 #include "baphomet/util/enum_bitmask_ops.hpp"
+#include "baphomet/util/hash.hpp"
 
 #include "buffer_base.hpp"
+#include "stream_ring.hpp"
 #include "spdlog/spdlog.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <iterator>
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace baphomet::gl {
@@ -34,11 +40,37 @@ public:
 
   std::size_t size();
 
+  // The live elements, as they are on the CPU side
+  std::span<const T> contents() const;
+
   void add(const std::vector<T> &new_data);
   void add(std::initializer_list<T> new_data);
 
+  // Make room for n elements and return them to be written into directly.
+  // Front-to-back buffers grow at the front, everything else at the back,
+  // and only that end is uploaded on sync, so use the matching one.
+  std::span<T> reserve_front(std::size_t n);
+  std::span<T> reserve_back(std::size_t n);
+
   void sync();
 
+  // Stage the contents into the ring's current region on sync, instead of
+  // this buffer's own storage. Allocations are aligned to whole vertices of
+  // elements_per_vertex elements. If the ring runs out of space for a frame,
+  // this falls back to its own storage for that frame.
+  void stream_through(std::shared_ptr<StreamRing> ring, std::size_t elements_per_vertex);
+
+  // Hash the live contents on sync, and skip the upload if they're the same
+  // as what the buffer already holds (typically last frame's). Fingerprinted
+  // buffers keep to their own storage, since the stream ring's regions
+  // don't survive from one frame to the next.
+  void fingerprint(bool enable);
+
+  // The buffer holding the synced contents, and the offset (in elements) such
+  // that element i lives at gl_offset() + i in it
+  const BufferBase *gl_buffer() const;
+  std::ptrdiff_t gl_offset() const;
+
 private:
   BufTarget target_{BufTarget::none};
   BufUsage usage_{BufUsage::none};
@@ -49,6 +81,28 @@ private:
 
   GLuint gl_bufsize_{0u}, gl_bufpos_{0u};
 
+  std::shared_ptr<StreamRing> ring_{nullptr};
+  std::size_t ring_align_{0};
+  std::uint64_t ring_frame_{0};
+  std::size_t ring_front_{0}, ring_back_{0};
+  std::ptrdiff_t ring_offset_{0};
+  bool in_ring_{false};
+
+  bool fingerprint_{false};
+  std::uint64_t resident_hash_{0};
+  std::size_t resident_front_{0}, resident_back_{0};
+  bool resident_valid_{false};
+
+  bool sync_ring_();
+  void sync_fingerprinted_();
+
+  // Uploads whatever was added since the last sync into our own storage
+  void sync_own_();
+
+  // Reallocates so that n more elements fit at the growing end, copying
+  // only the live contents across
+  void grow_(std::size_t n);
+
   template<typename InputIt>
   void add_(InputIt begin, InputIt end);
 };
@@ -77,6 +131,18 @@ VecBuffer<T>::VecBuffer(VecBuffer<T> &&other) noexcept : BufferBase(std::move(ot
   front_to_back_ = other.front_to_back_;
   gl_bufsize_ = other.gl_bufsize_;
   gl_bufpos_ = other.gl_bufpos_;
+  ring_ = std::move(other.ring_);
+  ring_align_ = other.ring_align_;
+  ring_frame_ = other.ring_frame_;
+  ring_front_ = other.ring_front_;
+  ring_back_ = other.ring_back_;
+  ring_offset_ = other.ring_offset_;
+  in_ring_ = other.in_ring_;
+  fingerprint_ = other.fingerprint_;
+  resident_hash_ = other.resident_hash_;
+  resident_front_ = other.resident_front_;
+  resident_back_ = other.resident_back_;
+  resident_valid_ = other.resident_valid_;
 
   other.target_ = BufTarget::none;
   other.usage_ = BufUsage::none;
@@ -86,6 +152,10 @@ VecBuffer<T>::VecBuffer(VecBuffer<T> &&other) noexcept : BufferBase(std::move(ot
   other.front_to_back_ = false;
   other.gl_bufsize_ = 0;
   other.gl_bufpos_ = 0;
+  other.ring_align_ = 0;
+  other.ring_offset_ = 0;
+  other.in_ring_ = false;
+  other.resident_valid_ = false;
 }
 
 template<typename T>
@@ -101,6 +171,18 @@ VecBuffer<T> &VecBuffer<T>::operator=(VecBuffer<T> &&other) noexcept {
     front_to_back_ = other.front_to_back_;
     gl_bufsize_ = other.gl_bufsize_;
     gl_bufpos_ = other.gl_bufpos_;
+    ring_ = std::move(other.ring_);
+    ring_align_ = other.ring_align_;
+    ring_frame_ = other.ring_frame_;
+    ring_front_ = other.ring_front_;
+    ring_back_ = other.ring_back_;
+    ring_offset_ = other.ring_offset_;
+    in_ring_ = other.in_ring_;
+    fingerprint_ = other.fingerprint_;
+    resident_hash_ = other.resident_hash_;
+    resident_front_ = other.resident_front_;
+    resident_back_ = other.resident_back_;
+    resident_valid_ = other.resident_valid_;
 
     other.target_ = BufTarget::none;
     other.usage_ = BufUsage::none;
@@ -110,6 +192,10 @@ VecBuffer<T> &VecBuffer<T>::operator=(VecBuffer<T> &&other) noexcept {
     other.front_to_back_ = false;
     other.gl_bufsize_ = 0;
     other.gl_bufpos_ = 0;
+    other.ring_align_ = 0;
+    other.ring_offset_ = 0;
+    other.in_ring_ = false;
+    other.resident_valid_ = false;
   }
   return *this;
 }
@@ -138,6 +224,11 @@ std::size_t VecBuffer<T>::size() {
   return back_ - front_;
 }
 
+template<typename T>
+std::span<const T> VecBuffer<T>::contents() const {
+  return {data_.data() + front_, back_ - front_};
+}
+
 template<typename T>
 void VecBuffer<T>::add(const std::vector<T> &new_data) {
   add_(new_data.begin(), new_data.end());
@@ -150,6 +241,59 @@ void VecBuffer<T>::add(std::initializer_list<T> new_data) {
 
 template<typename T>
 void VecBuffer<T>::sync() {
+  if (fingerprint_) {
+    sync_fingerprinted_();
+    return;
+  }
+
+  if (ring_ && sync_ring_())
+    return;
+
+  sync_own_();
+}
+
+template<typename T>
+void VecBuffer<T>::fingerprint(bool enable) {
+  fingerprint_ = enable;
+  resident_valid_ = false;
+}
+
+template<typename T>
+void VecBuffer<T>::sync_fingerprinted_() {
+  bool pending = front_to_back_ ? gl_bufpos_ > front_ : gl_bufpos_ < back_;
+  if (!pending && !in_ring_)
+    return;
+
+  // Leaving the ring, so our own storage needs a full upload
+  if (in_ring_) {
+    in_ring_ = false;
+    ring_offset_ = 0;
+    gl_bufsize_ = 0;
+  }
+
+  auto hash = hash64(data_.data() + front_, sizeof(T) * size());
+
+  if (resident_valid_ && hash == resident_hash_ && front_ == resident_front_ && back_ == resident_back_ &&
+      gl_bufsize_ >= data_.size()) {
+    auto skipped = front_to_back_ ? gl_bufpos_ - front_ : back_ - gl_bufpos_;
+    upload_stats().bytes_skipped += sizeof(T) * skipped;
+
+    gl_bufpos_ = front_to_back_ ? front_ : back_;
+    return;
+  }
+
+  sync_own_();
+
+  resident_hash_ = hash;
+  resident_front_ = front_;
+  resident_back_ = back_;
+  resident_valid_ = true;
+}
+
+template<typename T>
+void VecBuffer<T>::sync_own_() {
+  // Left bound afterwards, so syncing it again or pointing attributes at
+  // it doesn't have to bind it again
   if (gl_bufsize_ < data_.size()) {
     bind(target_);
     glBufferData(
@@ -158,7 +302,7 @@ void VecBuffer<T>::sync() {
         &data_[0],
         unwrap(usage_)
     );
-    unbind(target_);
+    upload_stats().bytes_uploaded += sizeof(T) * data_.size();
 
     gl_bufsize_ = data_.size();
     gl_bufpos_ = front_to_back_ ? front_ : back_;
@@ -172,7 +316,7 @@ void VecBuffer<T>::sync() {
           sizeof(T) * (gl_bufpos_ - front_),
           &data_[0] + front_
       );
-      unbind(target_);
+      upload_stats().bytes_uploaded += sizeof(T) * (gl_bufpos_ - front_);
 
       gl_bufpos_ = front_;
 
@@ -184,7 +328,7 @@ void VecBuffer<T>::sync() {
           sizeof(T) * (back_ - gl_bufpos_),
           &data_[0] + gl_bufpos_
       );
-      unbind(target_);
+      upload_stats().bytes_uploaded += sizeof(T) * (back_ - gl_bufpos_);
 
       gl_bufpos_ = back_;
     }
@@ -192,25 +336,108 @@ void VecBuffer<T>::sync() {
 }
 
 template<typename T>
-template<typename InputIt>
-void VecBuffer<T>::add_(InputIt begin, InputIt end) {
-  std::size_t size = std::distance(begin, end);
+void VecBuffer<T>::stream_through(std::shared_ptr<StreamRing> ring, std::size_t elements_per_vertex) {
+  ring_ = std::move(ring);
+  ring_align_ = sizeof(T) * elements_per_vertex;
+  in_ring_ = false;
+  ring_offset_ = 0;
+}
+
+template<typename T>
+const BufferBase *VecBuffer<T>::gl_buffer() const {
+  if (in_ring_)
+    return ring_.get();
+  return this;
+}
+
+template<typename T>
+std::ptrdiff_t VecBuffer<T>::gl_offset() const {
+  return ring_offset_;
+}
+
+template<typename T>
+bool VecBuffer<T>::sync_ring_() {
+  // Already in this frame's region, unchanged since
+  if (in_ring_ && ring_frame_ == ring_->frame() && ring_front_ == front_ && ring_back_ == back_)
+    return true;
+
+  std::size_t offset;
+  auto dst = ring_->alloc(sizeof(T) * size(), ring_align_, offset);
+  if (!dst) {
+    // Our own storage hasn't been kept up to date, so it needs a full upload
+    if (in_ring_)
+      gl_bufsize_ = 0;
+    in_ring_ = false;
+    ring_offset_ = 0;
+    return false;
+  }
+
+  std::memcpy(dst, data_.data() + front_, sizeof(T) * size());
+  upload_stats().bytes_uploaded += sizeof(T) * size();
+
+  in_ring_ = true;
+  ring_frame_ = ring_->frame();
+  ring_front_ = front_;
+  ring_back_ = back_;
+  ring_offset_ = static_cast<std::ptrdiff_t>(offset / sizeof(T)) - static_cast<std::ptrdiff_t>(front_);
+  return true;
+}
+
+template<typename T>
+std::span<T> VecBuffer<T>::reserve_front(std::size_t n) {
+  if (!front_to_back_) {
+    spdlog::error("VecBuffer ({}) grows back-to-front, reserving at the back instead", id);
+    return reserve_back(n);
+  }
+
+  if (front_ < n)
+    grow_(n);
+
+  front_ -= n;
+  return {data_.data() + front_, n};
+}
+
+template<typename T>
+std::span<T> VecBuffer<T>::reserve_back(std::size_t n) {
   if (front_to_back_) {
-    while (front_ + 1 <= size) {
-      front_ += data_.size();
-      back_ += data_.size();
-      data_.reserve(data_.size() * 2);
-      std::copy(data_.begin(), data_.end(), std::back_inserter(data_));
-    }
-    front_ -= size;
-    std::copy(begin, end, data_.begin() + front_);
+    spdlog::error("VecBuffer ({}) grows front-to-back, reserving at the front instead", id);
+    return reserve_front(n);
+  }
+
+  if (back_ + n > data_.size())
+    grow_(n);
+
+  auto start = back_;
+  back_ += n;
+  return {data_.data() + start, n};
+}
+
+template<typename T>
+void VecBuffer<T>::grow_(std::size_t n) {
+  auto live = size();
+  auto new_size = std::max(data_.size() * 2, live + n);
+
+  std::vector<T> grown(new_size);
+  if (front_to_back_) {
+    std::copy(data_.begin() + front_, data_.begin() + back_, grown.end() - live);
+    front_ = new_size - live;
+    back_ = new_size;
 
   } else {
-    while (back_ + size >= data_.size())
-      data_.resize(data_.size() * 2);
-    std::copy(begin, end, data_.begin() + back_);
-    back_ += size;
+    std::copy(data_.begin() + front_, data_.begin() + back_, grown.begin());
+    front_ = 0;
+    back_ = live;
   }
+
+  data_ = std::move(grown);
+}
+
+template<typename T>
+template<typename InputIt>
+void VecBuffer<T>::add_(InputIt begin, InputIt end) {
+  std::size_t size = std::distance(begin, end);
+  auto dst = front_to_back_ ? reserve_front(size) : reserve_back(size);
+  std::copy(begin, end, dst.begin());
 }
 
 } // namespace baphomet::gl
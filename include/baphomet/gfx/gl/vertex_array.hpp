@@ -46,6 +46,7 @@ struct AttrDef {
   bool normalized;
   GLsizei stride;
   GLsizei offset;
+  GLuint divisor{0};
 };
 
 class VertexArray {
@@ -69,14 +70,39 @@ public:
   void attrib_pointer(const BufferBase *buffer, const std::vector<AttrDef> &definitions);
   void attrib_pointer(const BufferBase *buffer, const AttrDef &definition);
 
+  // Only re-specifies the definitions if they don't already point at buffer,
+  // for vertices that can move between buffers (see StreamRing)
+  void ensure_attrib_pointer(const BufferBase *buffer, const std::vector<AttrDef> &definitions);
+
   void indices(const BufferBase *buffer);
 
+  // Draws leave the vertex array bound, so back to back draws from the
+  // same one only bind it once
   void draw_arrays(DrawMode mode, GLint first, GLsizei count);
 
-  void draw_elements(DrawMode mode, GLsizei count, GLenum type, void *indices = nullptr);
+  // Draws instance_count copies of [first, first + count), starting at base_instance
+  // of any attribute with a non-zero divisor
+  void draw_arrays_instanced(DrawMode mode, GLint first, GLsizei count, GLsizei instance_count, GLuint base_instance = 0);
+
+  void draw_elements(DrawMode mode, GLsizei count, GLenum type, void *indices = nullptr, GLint base_vertex = 0);
+
+  // One call for draw_count separate ranges
+  void multi_draw_arrays(DrawMode mode, const GLint *first, const GLsizei *count, GLsizei draw_count);
+  void multi_draw_elements(DrawMode mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei draw_count, const GLint *base_vertex = nullptr);
 
 private:
-  void setup_enable_definition_(const AttrDef &definition);
+  // Buffer id each attribute index was last pointed at
+  std::vector<GLuint> attrib_buffers_{};
+
+  // Without ARB_base_instance, per-instance attributes have their pointers
+  // offset manually to emulate a base instance
+  const BufferBase *instance_buffer_{nullptr};
+  std::vector<AttrDef> instance_definitions_{};
+  GLuint instance_offset_{0};
+
+  void setup_enable_definition_(const AttrDef &definition, GLsizei extra_offset = 0);
+  void record_definition_(const BufferBase *buffer, const AttrDef &definition);
+  void offset_instance_definitions_(GLuint base_instance);
 
   void gen_id_();
   void del_id_();
@@ -5,20 +5,33 @@
 #include "baphomet/gfx/gl/batching/oval_batch.hpp"
 #include "baphomet/gfx/gl/batching/pixel_batch.hpp"
 #include "baphomet/gfx/gl/batching/rect_batch.hpp"
+#include "baphomet/gfx/gl/batching/sprite_batch.hpp"
+#include "baphomet/gfx/gl/batching/static_layer_batch.hpp"
 #include "baphomet/gfx/gl/batching/texture_batch.hpp"
 #include "baphomet/gfx/gl/batching/tri_batch.hpp"
+#include "baphomet/gfx/gl/batching/uber_batch.hpp"
 #include "baphomet/gfx/color.hpp"
+#include "baphomet/gfx/draw_recorder.hpp"
+#include "baphomet/util/hash.hpp"
+#include "baphomet/util/shapes.hpp"
 
-#include <functional>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
 #include <memory>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace baphomet {
 
 class BatchSet {
 public:
-  BatchSet();
+  // Batches stream their vertices through stream_ring, if given
+  explicit BatchSet(std::shared_ptr<gl::StreamRing> stream_ring = nullptr);
 
   void clear();
 
@@ -36,6 +49,62 @@ public:
   std::size_t oval_vertex_count_alpha() const;
   std::size_t texture_vertex_count_alpha() const;
 
+  // Translucent draws all go through one UberBatch instead, so changing
+  // primitive type no longer splits the alpha pass. Textures that aren't
+  // in an atlas still have their own batches.
+  void unify_alpha(bool unify);
+
+  // Translucent draws that don't overlap each other may be drawn out of
+  // submission order, grouped by batch, so they need fewer segments.
+  // Overlapping draws always keep their relative order. On by default.
+  void reorder_alpha(bool reorder);
+
+  // Batches hash their vertices each frame and skip uploading any that
+  // haven't changed. Off by default, since the hashing isn't free when
+  // everything changes every frame.
+  void fingerprint_uploads(bool enable);
+
+  // Primitives lying entirely outside the rectangle given to cull_to, after
+  // rotation, are dropped before any vertices are made. On by default, with
+  // the bounds unlimited until cull_to is called. Never applies while
+  // recording.
+  void cull(bool enable);
+  void cull_to(float x, float y, float w, float h);
+
+  // The rectangle given to cull_to, unlimited if it never was. Holds
+  // whether or not culling is on, for callers that skip work themselves.
+  Rect cull_bounds() const;
+
+  // How many primitives were culled since the last clear
+  std::size_t culled_count() const;
+
+  // Remembers every primitive added each frame, so that take_damage can
+  // work out which part of the target actually changed since the last
+  // time it was called. Primitives are compared in the order they were
+  // added, by their arguments, so a texture whose pixels change under
+  // the same TextureUnit needs damage_all.
+  void track_damage(bool enable);
+  bool tracking_damage() const;
+
+  // The next take_damage covers the whole target
+  void damage_all();
+
+  // What changed since the last call, padded to whole pixels and clipped
+  // to the cull bounds. Empty if nothing did.
+  Rect take_damage();
+
+  // Everything added from now on goes into the uber batch in order,
+  // opaque or not, to be baked into StaticGeometry with bake_static
+  void record_static(bool record);
+  std::shared_ptr<gl::StaticGeometry> bake_static();
+
+  // Draws geometry baked earlier, as a single translucent primitive
+  void add_static_layer(const std::shared_ptr<const gl::StaticGeometry> &geometry, float x, float y, float scale_x, float scale_y);
+
+  // How many alpha segments (separate batch submissions) the last
+  // draw_alpha needed
+  std::size_t alpha_segment_count() const;
+
 //  void create_texture_batch(const std::string &name, const std::unique_ptr<gl::TextureUnit> &tex_unit);
 
   void add_pixel(float x, float y, const baphomet::RGB &color);
@@ -44,17 +113,29 @@ public:
   void add_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle);
   void add_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle);
   void add_texture(const std::string &name, const std::shared_ptr<gl::TextureUnit> &tex_unit, float x, float y, float w, float h, float tx, float ty, float tw, float th, float cx, float cy, float angle, const baphomet::RGB &color);
+  void add_sprite(const std::string &pages_name, const std::shared_ptr<gl::TextureArray> &pages, int layer, bool fully_opaque, float x, float y, float w, float h, float tx, float ty, float tw, float th, float cx, float cy, float angle, const baphomet::RGB &color);
 
   void add_lined_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle);
   void add_lined_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle);
   void add_lined_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle);
 
-  void draw_opaque(glm::mat4 projection);
-  void draw_alpha(glm::mat4 projection);
+  // Appends what recorders hold, run by run in sort key order (ties keep
+  // the order of recorders, then of runs), with their depths moved past
+  // everything added so far, and clears them. Recorded draws can't be
+  // baked into a static layer, and are dropped while recording one.
+  void merge(std::span<DrawRecorder *const> recorders);
+
+  // The depth everything added so far fits under, for the frame block
+  float z_max() const;
+
+  void draw_opaque();
+  void draw_alpha();
 
 private:
   float z_level{1.0f};
 
+  std::shared_ptr<gl::StreamRing> stream_ring_{nullptr};
+
   std::unique_ptr <gl::PixelBatch> pixels{nullptr};
   std::unique_ptr <gl::LineBatch> lines{nullptr};
   std::unique_ptr <gl::LinedBatch> lined{nullptr};
@@ -62,18 +143,160 @@ private:
   std::unique_ptr <gl::RectBatch> rects{nullptr};
   std::unique_ptr <gl::OvalBatch> ovals{nullptr};
 
+  bool unify_alpha_{false};
+  bool reorder_alpha_{true};
+  bool record_static_{false};
+  bool fingerprint_uploads_{false};
+
+  bool cull_{true};
+  float cull_x0_{-std::numeric_limits<float>::infinity()};
+  float cull_y0_{-std::numeric_limits<float>::infinity()};
+  float cull_x1_{std::numeric_limits<float>::infinity()};
+  float cull_y1_{std::numeric_limits<float>::infinity()};
+  std::size_t culled_count_{0};
+
+  // Which add_* a damage record came from, so different primitives with
+  // the same arguments don't compare equal
+  enum class Prim_ : std::uint8_t {
+    static_layer, pixel, line, tri, rect, oval, texture, sprite,
+    lined_tri, lined_rect, lined_oval
+  };
+
+  bool damage_tracking_{false};
+  bool damage_all_{true};
+  std::unique_ptr <gl::UberBatch> uber_{nullptr};
+  std::unique_ptr <gl::StaticLayerBatch> static_layers_{nullptr};
+
   std::unordered_map <std::string, std::unique_ptr<gl::TextureBatch>> tex_batches_{};
+  std::unordered_map <std::string, std::unique_ptr<gl::SpriteBatch>> sprite_batches_{};
+
+  // Scratch space for merge: (recorder, run) pairs, and the batch each
+  // span of the current run went to, with where its alpha vertices began
+  std::vector<std::pair<DrawRecorder *, std::uint32_t>> merge_runs_{};
+  std::vector<std::pair<gl::Batch *, GLint>> merge_spans_{};
+
+  // Applies the settings every new batch shares
+  void init_batch_(gl::Batch *batch);
 
   gl::BatchType last_batch_type_{gl::BatchType::none};
   std::string last_tex_name_{};
-  std::vector<std::function<void(float, glm::mat4)>> alpha_fns_{};
+
+  // Screen space bounding box, unbounded unless set, so that anything
+  // without bounds is taken to overlap everything
+  struct Bounds_ {
+    float x0{-std::numeric_limits<float>::infinity()};
+    float y0{-std::numeric_limits<float>::infinity()};
+    float x1{std::numeric_limits<float>::infinity()};
+    float y1{std::numeric_limits<float>::infinity()};
+
+    bool overlaps(const Bounds_ &other) const {
+      return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+    }
+  };
+
+  // One segment of the alpha pass, in slots of the batch's alpha buffer.
+  // Texture batches are per texture, so the batch also identifies the
+  // texture to bind.
+  struct AlphaCmd_ {
+    gl::Batch *batch;
+    GLint first;
+    GLsizei count;
+    Bounds_ bounds;
+  };
+
+  std::vector<AlphaCmd_> alpha_cmds_{};
+  std::vector<gl::DrawRange> alpha_ranges_{};
+  std::size_t alpha_segment_count_{0};
+
+  // Past any of these the alpha pass is left in submission order: its
+  // length, the overlap tests made while looking for dependencies, and
+  // the dependencies found
+  static constexpr std::size_t MAX_REORDER_CMDS_{4096};
+  static constexpr std::size_t MAX_REORDER_TESTS_{1 << 17};
+  static constexpr std::size_t MAX_REORDER_EDGES_{1 << 15};
+
+  // Commands are bucketed into a GRID_DIM_ x GRID_DIM_ grid over their
+  // combined extent, so only those sharing a cell are tested for overlap
+  static constexpr std::size_t GRID_DIM_{16};
+
+  // How many of a batch's commands in a cell are tested against the next
+  // command of another batch before depending on the newest outright
+  static constexpr std::size_t SCAN_DEPTH_{8};
+
+  // Scratch space for reordering, kept around between frames
+  std::vector<std::uint32_t> alpha_order_{};
+  std::vector<std::vector<std::pair<gl::Batch *, std::vector<std::uint32_t>>>> grid_cells_{};
+  std::vector<std::uint32_t> alpha_seen_{};
+  std::vector<std::uint32_t> alpha_indegree_{};
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> alpha_edges_{};
+  std::vector<std::uint32_t> alpha_edge_starts_{};
+  std::vector<std::uint32_t> alpha_edge_targets_{};
+  std::unordered_map<gl::Batch *, std::uint32_t> alpha_last_{};
+  std::unordered_map<gl::Batch *, std::vector<std::uint32_t>> alpha_ready_{};
   std::unordered_map<gl::BatchType, GLint> batch_starts_{};
   std::unordered_map<std::string ,GLint> tex_batch_starts_{};
+  std::unordered_map<std::string, GLint> sprite_batch_starts_{};
+
+  // Whether a primitive goes into the uber batch instead of its own
+  bool to_uber_(bool translucent) const;
+
+  // Switches the alpha pass over to the uber batch, creating it if needed
+  gl::UberBatch *uber_alpha_();
 
   void clear_batch_starts_();
   void check_store_alpha_batch_(gl::BatchType current_type);
   void check_store_alpha_batch_(gl::BatchType current_type, const std::string &current_tex_name);
   void store_alpha_batch_();
+  void store_alpha_batch_(const Bounds_ &bounds);
+
+  // Screen space bounds of points rotated by angle degrees about (cx, cy),
+  // padded by a pixel. Unbounded when neither culling nor reordering needs
+  // them.
+  Bounds_ bounds_of_(std::initializer_list<glm::vec2> points, float cx, float cy, float angle) const;
+
+  // Counts it, if so
+  bool culled_(const Bounds_ &bounds);
+
+  struct DamageRecord_ {
+    std::uint64_t hash;
+    Bounds_ bounds;
+  };
+
+  // This frame's primitives, and those of the last take_damage
+  std::vector<DamageRecord_> damage_current_{};
+  std::vector<DamageRecord_> damage_previous_{};
+
+  template <typename... Ts>
+  void track_damage_(const Bounds_ &bounds, Prim_ prim, const Ts &...values);
+
+  // With reordering on, every translucent primitive closes its own
+  // segment, so it keeps its own bounds
+  void close_alpha_primitive_(const Bounds_ &bounds);
+
+  // Fills alpha_order_ with the order to draw alpha_cmds_ in
+  void order_alpha_cmds_();
+
+  // Extends the previous command instead, if it ends where this one begins
+  void record_alpha_cmd_(gl::Batch *batch, GLint first, GLsizei count, const Bounds_ &bounds);
+
+  // The batch a recorded span goes into, creating it if needed
+  gl::Batch *batch_for_(const DrawRecorder::Span_ &span);
+
+  gl::Batch *last_alpha_batch_();
+  GLint &last_alpha_start_();
 };
 
+template <typename... Ts>
+void BatchSet::track_damage_(const Bounds_ &bounds, Prim_ prim, const Ts &...values) {
+  static_assert((std::is_trivially_copyable_v<Ts> && ...));
+
+  if (!damage_tracking_ || record_static_)
+    return;
+
+  auto hash = hash64(&prim, sizeof(prim));
+  ((hash = hash64(&values, sizeof(values), hash)), ...);
+
+  damage_current_.push_back({hash, bounds});
+}
+
 } // namespace baphomet
@@ -0,0 +1,56 @@
+#pragma once
+
+/* Puts every render target's texture on the window, in order, after all of
+ * them have been drawn. Up to MAX_LAYERS_ targets are bound to texture units
+ * at once and composited with a single draw, each quad carrying the index of
+ * its unit. Targets marked opaque are copied with glBlitFramebuffer instead,
+ * which only has to wait on the targets below it that it actually overlaps.
+ */
+
+#include "baphomet/gfx/gl/shader.hpp"
+#include "baphomet/gfx/gl/vec_buffer.hpp"
+#include "baphomet/gfx/gl/vertex_array.hpp"
+#include "baphomet/gfx/render_target.hpp"
+
+#include "glm/glm.hpp"
+
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace baphomet {
+
+class Compositor {
+public:
+  Compositor();
+  ~Compositor() = default;
+
+  // Draws onto the default framebuffer, which must be bound
+  void draw(
+      std::span<const std::shared_ptr<RenderTarget>> targets,
+      GLsizei window_width, GLsizei window_height,
+      glm::mat4 projection
+  );
+
+  // Draw calls plus blits the last draw needed
+  std::size_t submission_count() const;
+
+private:
+  // The minimum number of fragment shader texture units GL 3.3 guarantees
+  static constexpr int MAX_LAYERS_{16};
+
+  std::unique_ptr<gl::Shader> shader_{nullptr};
+  gl::Uniform<glm::mat4> projection_{};
+  std::unique_ptr<gl::VertexArray> vao_{nullptr};
+  std::unique_ptr<gl::VecBuffer<float>> vbo_{nullptr};
+
+  // Targets waiting to go out together in the next draw
+  std::vector<const RenderTarget *> pending_{};
+
+  std::size_t submission_count_{0};
+
+  void flush_(glm::mat4 projection);
+  void blit_(const RenderTarget &target, GLsizei window_height);
+};
+
+} // namespace baphomet
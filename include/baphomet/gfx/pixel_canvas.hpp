@@ -0,0 +1,96 @@
+#pragma once
+
+/* A CPU side RGBA8 image that's written into directly and drawn as a single
+ * textured quad with GfxMgr::draw_pixel_canvas. Made for plotting whole
+ * fields of pixels, like cellular automata or noise, where going through
+ * GfxMgr::pixel would mean one vertex per pixel.
+ *
+ * Writes only touch memory and widen the range of dirty rows. The dirty
+ * rows are streamed to the texture through one of two alternating pixel
+ * buffers the next time the canvas is drawn, and nothing is uploaded when
+ * no rows changed. Because of that, drawing a canvas more than once in a
+ * frame shows the contents it had at the last of those draws.
+ *
+ * Rows start at the top, and pixels are packed the same way as
+ * gl::pack_rgba8, so whole rows can be filled at once through row().
+ */
+
+#include "baphomet/gfx/gl/batching/vertex_layout.hpp"
+#include "baphomet/gfx/gl/static_buffer.hpp"
+#include "baphomet/gfx/gl/texture_unit.hpp"
+#include "baphomet/gfx/color.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace baphomet {
+
+class PixelCanvas {
+  friend class GfxMgr;
+
+public:
+  PixelCanvas(const std::string &name, int width, int height, bool opaque, bool retro);
+
+  int w() const;
+  int h() const;
+
+  // Pixels outside the canvas are ignored
+  void set(int x, int y, const baphomet::RGB &color);
+  baphomet::RGB get(int x, int y) const;
+
+  void fill(const baphomet::RGB &color);
+  void fill_rect(int x, int y, int w, int h, const baphomet::RGB &color);
+
+  // Direct access, which marks everything handed out as dirty
+  std::span<std::uint32_t> row(int y);
+  std::span<std::uint32_t> pixels();
+
+  // For writes made through a span that was handed out earlier
+  void mark_dirty(int y0, int y1);
+  void mark_dirty();
+
+private:
+  std::string name_{};
+  int width_{0}, height_{0};
+
+  std::vector<std::uint32_t> pixels_{};
+
+  // Half open range of rows changed since the last upload
+  int dirty_y0_{0}, dirty_y1_{0};
+
+  std::shared_ptr<gl::TextureUnit> tex_unit_{nullptr};
+
+  std::array<std::unique_ptr<gl::StaticBuffer<std::uint32_t>>, 2> pbos_{};
+  std::size_t next_pbo_{0};
+
+  void dirty_rows_(int y0, int y1);
+
+  // Sends the dirty rows to the texture, returns whether anything was sent
+  bool upload_();
+};
+
+// Defined here so that per pixel loops in user code can inline it
+inline void PixelCanvas::set(int x, int y, const baphomet::RGB &color) {
+  if (x < 0 || y < 0 || x >= width_ || y >= height_)
+    return;
+
+  pixels_[y * width_ + x] = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  dirty_rows_(y, y + 1);
+}
+
+inline void PixelCanvas::dirty_rows_(int y0, int y1) {
+  if (dirty_y0_ >= dirty_y1_) {
+    dirty_y0_ = y0;
+    dirty_y1_ = y1;
+    return;
+  }
+
+  dirty_y0_ = y0 < dirty_y0_ ? y0 : dirty_y0_;
+  dirty_y1_ = y1 > dirty_y1_ ? y1 : dirty_y1_;
+}
+
+} // namespace baphomet
@@ -1,23 +1,30 @@
 #pragma once
 
+#include "baphomet/gfx/gl/context_enums.hpp"
 #include "baphomet/gfx/gl/framebuffer.hpp"
 #include "baphomet/gfx/internal/batch_set.hpp"
+#include "baphomet/gfx/camera.hpp"
+#include "baphomet/gfx/color.hpp"
+#include "baphomet/util/time/time.hpp"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
 #include <string>
+#include <vector>
 
 namespace baphomet {
 
 class RenderTarget {
+  friend class Compositor;
   friend class GfxMgr;
 
 public:
   RenderTarget(
       const std::string &tag,
       std::uint64_t weight,
-      float x, float y, float w, float h
+      float x, float y, float w, float h,
+      std::shared_ptr<gl::StreamRing> stream_ring = nullptr
   );
   ~RenderTarget() = default;
 
@@ -35,6 +42,46 @@ public:
   void resize(float x, float y, float w, float h);
   void resize(float w, float h);
 
+  // Without cameras, everything is drawn once, one world unit to a pixel.
+  // With them, it's drawn once through each camera in the order they were
+  // added, and primitives are culled against what any of them can see.
+  std::size_t add_camera(const Camera &camera);
+  void set_camera(std::size_t i, const Camera &camera);
+  const Camera &camera(std::size_t i) const;
+  std::size_t camera_count() const;
+  void clear_cameras();
+
+  // Promises that everything drawn covers the whole target opaquely, so it
+  // can be copied onto the window instead of blended
+  void opaque(bool opaque);
+  bool opaque() const;
+
+  // A cached render target keeps what was last drawn to it and is composited
+  // from that, skipping its draw pass (and clears), until it's invalidated or
+  // refresh_interval has passed since it was last drawn. A zero interval
+  // means it's only redrawn when invalidated.
+  void cache(Duration refresh_interval = Duration::zero());
+  void uncache();
+  bool cached() const;
+
+  // Redraws all of it next frame, whether cached, damage tracked or both
+  void invalidate();
+
+  // Whether what's drawn to this render target this frame will be shown.
+  // Always true unless it's cached; check it to skip building things that
+  // would only be thrown away.
+  bool refreshing() const;
+
+  // Only the part of the target that changed since it was last drawn is
+  // redrawn, with its draw pass (and any clear made while it's bound)
+  // scissored to that region. Only drawing that goes through the batches
+  // is tracked; call invalidate() after anything else changes it, such
+  // as the pixels of a texture it draws.
+  void track_damage(bool enable);
+
+  // The region redrawn last time it was drawn, in target pixels
+  Rect damage() const;
+
 private:
   std::string tag_;
   std::uint64_t weight_{0};
@@ -43,13 +90,36 @@ private:
   std::unique_ptr<gl::Framebuffer> fbo_{nullptr};
   glm::mat4 projection_{1.0f};
 
+  std::vector<Camera> cameras_{};
+
+  bool opaque_{false};
+
+  bool cached_{false};
+  Duration refresh_interval_{Duration::zero()};
+  Timestamp last_refresh_{};
+  bool dirty_{true};
+  bool refreshing_{true};
+
+  Rect damage_{};
+
+  // With damage tracking, clears wait for the draw pass, when the region
+  // to scissor them to is known
+  struct {
+    bool pending{false};
+    baphomet::RGB color{};
+    gl::ClearMask mask{gl::ClearMask::color};
+  } deferred_clear_{};
+
   std::unique_ptr<BatchSet> batches_{nullptr};
 
-  std::unique_ptr<gl::Shader> shader_{nullptr};
-  std::unique_ptr<gl::VertexArray> vao_{nullptr};
-  std::unique_ptr<gl::VecBuffer<float>> vbo_{nullptr};
+  // Decides whether this frame redraws it, and marks it clean once it has
+  void begin_frame_();
+  void end_frame_();
+
+  void defer_clear_(const baphomet::RGB &color, gl::ClearMask mask);
 
-  void draw_(glm::mat4 window_projection);
+  // Culls to the target, or to everything the cameras can see
+  void update_cull_bounds_();
 };
 
 } // namespace baphomet
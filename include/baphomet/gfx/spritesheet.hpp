@@ -10,12 +10,16 @@
 namespace baphomet {
 
 class Spritesheet {
+  friend class DrawRecorder;
+  friend class Tilemap;
+
 public:
   Spritesheet(
       TexRenderFunc render_func,
       const std::string &name,
       std::unordered_map<std::string, glm::vec4> mappings,
-      float tile_w, float tile_h
+      float tile_w, float tile_h,
+      TextureSource source = {}
   );
 
   float tile_w() const;
@@ -54,11 +58,17 @@ private:
   std::unordered_map<std::string, glm::vec4> mappings_{};
 
   float tile_w_{0}, tile_h_{0};
+
+  TextureSource source_{};
+
+  // Whether the pixels were packed into a texture atlas, which is what
+  // lets the sprites be part of a static layer
+  bool atlased_{false};
 };
 
 class SpritesheetBuilder {
 public:
-  SpritesheetBuilder(TexRenderFunc render_func, const std::string &name);
+  SpritesheetBuilder(TexRenderFunc render_func, const std::string &name, TextureSource source = {});
 
   SpritesheetBuilder &load_ini(const std::string &path);
 
@@ -91,6 +101,8 @@ private:
 
   bool tiled_{false};
   float tile_w_{0}, tile_h_{0};
+
+  TextureSource source_{};
 };
 
 } // namespace baphomet
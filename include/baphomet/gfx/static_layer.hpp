@@ -0,0 +1,33 @@
+#pragma once
+
+/* Drawing recorded once, between GfxMgr::begin_static_layer and
+ * end_static_layer, and drawn again every frame after that with
+ * GfxMgr::draw_static_layer, without redoing any of the vertex work or
+ * uploads. Good for fixed backdrops, grids and parallax backgrounds.
+ *
+ * The recording stays as it is until invalidate() is called, after which
+ * valid() is false until the layer is recorded again.
+ */
+
+#include "baphomet/gfx/internal/batch_set.hpp"
+
+#include <memory>
+
+namespace baphomet {
+
+class StaticLayer {
+  friend class GfxMgr;
+
+public:
+  StaticLayer() = default;
+
+  bool valid() const;
+
+  void invalidate();
+
+private:
+  std::unique_ptr<BatchSet> recorder_{nullptr};
+  std::shared_ptr<const gl::StaticGeometry> geometry_{nullptr};
+};
+
+} // namespace baphomet
@@ -14,14 +14,30 @@ using TexRenderFunc = std::function<void(
     const baphomet::RGB &
 )>;
 
+// Where a texture's pixels ended up: a texture unit of its own, or a
+// region of an atlas page. Enough to draw it without going through
+// GfxMgr, which is what DrawRecorder does.
+struct TextureSource {
+  std::string batch_name{};
+  std::shared_ptr<gl::TextureUnit> unit{nullptr};
+
+  std::shared_ptr<gl::TextureArray> pages{nullptr};
+  int layer{0};
+  float x{0.0f}, y{0.0f};
+
+  bool fully_opaque{true};
+};
+
 class Texture {
+  friend class DrawRecorder;
   friend class ParticleSystem;
 
 public:
   Texture(
       TexRenderFunc render_func,
       const std::string &name,
-      GLuint width, GLuint height
+      GLuint width, GLuint height,
+      TextureSource source = {}
   );
 
   GLuint w() const;
@@ -65,6 +81,7 @@ public:
 protected:
   std::string name_{};
   GLuint width_{0}, height_{0};
+  TextureSource source_{};
 
   TexRenderFunc render_func_;
 };
@@ -0,0 +1,92 @@
+#pragma once
+
+/* A grid of tiles taken from a tiled Spritesheet, drawn with
+ * GfxMgr::draw_tilemap. Tiles are stored as indices into the sprites
+ * added with add_tile, so drawing never looks a sprite up by name.
+ *
+ * The grid is split into CHUNK_SIZE x CHUNK_SIZE chunks, and only chunks
+ * overlapping the current render target (or its cameras) are drawn. When
+ * the spritesheet lives in a texture atlas, each chunk is baked into a
+ * static layer the first time it's drawn, and baked again only after one
+ * of its tiles changes, so a drawn chunk costs one static layer draw no
+ * matter how many tiles it holds. Without an atlas the tiles of visible
+ * chunks are drawn one by one every frame.
+ */
+
+#include "baphomet/gfx/spritesheet.hpp"
+#include "baphomet/gfx/static_layer.hpp"
+#include "baphomet/gfx/texture.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace baphomet {
+
+class Tilemap {
+  friend class GfxMgr;
+
+public:
+  static constexpr int EMPTY{-1};
+  static constexpr int CHUNK_SIZE{32};
+
+  Tilemap(std::unique_ptr<Spritesheet> &sheet, int cols, int rows);
+
+  int cols() const;
+  int rows() const;
+
+  float tile_w() const;
+  float tile_h() const;
+
+  // Makes a sprite from the spritesheet usable as a tile, returning the
+  // index to place it with. Sprites larger than a tile hang over the
+  // tiles to their right and below.
+  int add_tile(const std::string &sprite_name);
+
+  // Tiles outside the map are ignored, and read back as EMPTY
+  void set(int col, int row, int tile);
+  int get(int col, int row) const;
+
+  void fill(int tile);
+
+  // Every chunk is baked again on its next draw
+  void invalidate();
+
+private:
+  struct Chunk_ {
+    std::vector<std::int32_t> tiles{};
+    std::size_t filled{0};
+
+    std::shared_ptr<StaticLayer> layer{nullptr};
+    bool dirty{true};
+  };
+
+  TexRenderFunc render_func_;
+  std::unordered_map<std::string, glm::vec4> sprites_{};
+  bool atlased_{false};
+
+  // Mappings of the sprites added with add_tile, by tile index
+  std::vector<glm::vec4> tiles_{};
+
+  int cols_{0}, rows_{0};
+  int chunk_cols_{0}, chunk_rows_{0};
+  float tile_w_{0}, tile_h_{0};
+
+  // How far the largest tile sprites reach past their tile, to the right
+  // and below, so chunks above and left of the view still get drawn
+  float overhang_w_{0}, overhang_h_{0};
+
+  std::vector<Chunk_> chunks_{};
+
+  Chunk_ &chunk_at_(int col, int row);
+  const Chunk_ &chunk_at_(int col, int row) const;
+
+  // Draws the tiles of one chunk, its top left corner at (x, y)
+  void draw_chunk_(const Chunk_ &chunk, float x, float y, float scale_x, float scale_y);
+};
+
+} // namespace baphomet
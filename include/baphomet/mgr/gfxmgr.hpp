@@ -3,11 +3,19 @@
 #include "baphomet/app/internal/resource_loader.hpp"
 #include "baphomet/gfx/font/cp437.hpp"
 #include "baphomet/gfx/gl/context_enums.hpp"
+#include "baphomet/gfx/gl/state_cache.hpp"
+#include "baphomet/gfx/gl/stream_ring.hpp"
+#include "baphomet/gfx/gl/texture_atlas.hpp"
 #include "baphomet/gfx/internal/batch_set.hpp"
+#include "baphomet/gfx/internal/compositor.hpp"
 #include "baphomet/gfx/color.hpp"
+#include "baphomet/gfx/draw_recorder.hpp"
 #include "baphomet/gfx/particle_system.hpp"
+#include "baphomet/gfx/pixel_canvas.hpp"
 #include "baphomet/gfx/render_target.hpp"
 #include "baphomet/gfx/spritesheet.hpp"
+#include "baphomet/gfx/static_layer.hpp"
+#include "baphomet/gfx/tilemap.hpp"
 #include "baphomet/gfx/texture.hpp"
 #include "baphomet/util/time/time.hpp"
 #include "baphomet/util/shapes.hpp"
@@ -15,7 +23,10 @@
 #include "glad/gl.h"
 #include "glm/glm.hpp"
 
+#include <array>
+#include <filesystem>
 #include <memory>
+#include <span>
 #include <stack>
 #include <string>
 #include <unordered_map>
@@ -132,6 +143,12 @@ public:
    * TEXTURES
    */
 
+  // Textures loaded after this are packed into shared atlas pages (one set
+  // per filtering mode) and drawn from a single batch, so mixing them
+  // doesn't break up batches. Textures that don't fit in a page are
+  // loaded on their own as before.
+  void use_texture_atlas(GLsizei page_size = 2048);
+
   std::unique_ptr<Texture> load_texture(const std::string &path, bool retro = false);
 
   SpritesheetBuilder load_spritesheet(const std::string &path, bool retro = false);
@@ -147,25 +164,141 @@ public:
   std::shared_ptr<RenderTarget> make_render_target(float x, float y, float w, float h, std::uint64_t weight);
   std::shared_ptr<RenderTarget> make_render_target(float x, float y, float w, float h);
 
+  // Translucent draws in every render target (including ones made later)
+  // go through a single batch, so they're submitted in one ordered draw
+  // however primitive types are interleaved
+  void unify_alpha_batches(bool unify = true);
+
+  // Lets translucent draws that don't overlap be regrouped by batch. On by
+  // default; turning it off draws them strictly in submission order.
+  void reorder_alpha_draws(bool reorder);
+
+  // Batches skip re-uploading vertices that hash the same as what they
+  // uploaded last frame. Worth it for scenes that are mostly unchanged
+  // from frame to frame; off by default.
+  void fingerprint_uploads(bool enable = true);
+
+  // Bytes uploaded to and skipped by vertex buffers during the last frame
+  const gl::UploadStats &upload_stats() const;
+
+  // GL state changes made and skipped as redundant during the last frame
+  const gl::StateStats &state_stats() const;
+
+  // Where linked shader programs are cached as binaries between runs, see
+  // gl::ShaderBuilder::binary_cache. An empty path turns caching off.
+  void shader_binary_cache(const std::filesystem::path &dir);
+
+  // Skips primitives that land entirely outside their render target. On by
+  // default.
+  void cull_offscreen(bool cull);
+
+  // How many primitives were culled across all render targets last frame
+  std::size_t culled_count() const;
+
   void push_render_target(std::shared_ptr<RenderTarget> &render_target);
   void pop_render_target(std::size_t count = 1);
 
+  /****************
+   * STATIC LAYERS
+   */
+
+  std::shared_ptr<StaticLayer> make_static_layer();
+
+  // Everything drawn between these is recorded into layer, replacing what
+  // it held, instead of being drawn to the current render target
+  void begin_static_layer(const std::shared_ptr<StaticLayer> &layer);
+  void end_static_layer();
+
+  // Draws the recording offset by (x, y) and scaled, at the current point
+  // in the draw order
+  void draw_static_layer(const std::shared_ptr<StaticLayer> &layer, float x, float y, float scale_x, float scale_y);
+  void draw_static_layer(const std::shared_ptr<StaticLayer> &layer, float x, float y);
+  void draw_static_layer(const std::shared_ptr<StaticLayer> &layer);
+
+  /*****************
+   * PIXEL CANVASES
+   */
+
+  // Canvases start out fully transparent. An opaque canvas is drawn with
+  // the opaque batches, so it has to stay opaque everywhere.
+  std::shared_ptr<PixelCanvas> make_pixel_canvas(int width, int height, bool opaque = false, bool retro = true);
+
+  // Sends any rows written since the last draw, then draws the canvas as
+  // one quad stretched to (w, h)
+  void draw_pixel_canvas(const std::shared_ptr<PixelCanvas> &canvas, float x, float y, float w, float h);
+  void draw_pixel_canvas(const std::shared_ptr<PixelCanvas> &canvas, float x, float y);
+  void draw_pixel_canvas(const std::shared_ptr<PixelCanvas> &canvas);
+
+  /***********
+   * TILEMAPS
+   */
+
+  std::shared_ptr<Tilemap> make_tilemap(std::unique_ptr<Spritesheet> &sheet, int cols, int rows);
+
+  // Draws the chunks that overlap the current render target, with the top
+  // left corner of the map at (x, y), baking any that changed first
+  void draw_tilemap(const std::shared_ptr<Tilemap> &tilemap, float x, float y, float scale_x, float scale_y);
+  void draw_tilemap(const std::shared_ptr<Tilemap> &tilemap, float x, float y);
+  void draw_tilemap(const std::shared_ptr<Tilemap> &tilemap);
+
+  /************
+   * RECORDERS
+   */
+
+  // A recorder culling to the current render target's view, and keeping
+  // damage records if the target tracks damage. Call from the main thread,
+  // then hand it to whichever thread fills it.
+  DrawRecorder make_recorder(std::uint64_t sort_key = 0);
+
+  // Draws what the recorders hold into the current render target, at the
+  // current point in the draw order, then clears them. Call from the main
+  // thread once the threads filling them are done.
+  void merge_recorders(std::span<DrawRecorder *const> recorders);
+  void merge_recorder(DrawRecorder &recorder);
+
 private:
   std::unique_ptr<ResourceLoader> resource_loader{nullptr};
 
   std::vector<std::shared_ptr<RenderTarget>> render_targets_{};
   std::uint64_t next_render_target_weight_{1};
+  bool unify_alpha_batches_{false};
+  bool reorder_alpha_draws_{true};
+  bool fingerprint_uploads_{false};
+  gl::UploadStats last_upload_stats_{};
+  gl::StateStats last_state_stats_{};
+  bool cull_offscreen_{true};
+  std::size_t last_culled_count_{0};
+
+  // Shared by every render target's batches, if the context supports it
+  static constexpr std::size_t STREAM_RING_REGION_SIZE_{4 * 1024 * 1024};
+  std::shared_ptr<gl::StreamRing> stream_ring_{nullptr};
+
+  std::unique_ptr<Compositor> compositor_{nullptr};
+  std::unique_ptr<gl::FrameBlock> frame_block_{nullptr};
 
   std::stack<std::shared_ptr<RenderTarget>> render_stack_{};
 
+  std::shared_ptr<StaticLayer> recording_layer_{nullptr};
+
+  // Where drawing currently goes: the layer being recorded, if any,
+  // otherwise the render target on top of the stack
+  BatchSet *active_batches_();
+
   std::vector<std::shared_ptr<ParticleSystem>> particle_systems_{};
 
+  // Indexed by retro
+  GLsizei atlas_page_size_{0};
+  std::array<std::unique_ptr<gl::TextureAtlas>, 2> atlases_{};
+
   void update_(Duration dt);
 
   /*****************
    * OPENGL CONTROL
    */
 
+  // Clears whatever is bound, cached or not
+  void clear_(const baphomet::RGB &color, gl::ClearMask mask);
+
   void enable_(gl::Capability cap);
   void disable_(gl::Capability cap);
 
@@ -184,6 +317,9 @@ private:
    * TEXTURES
    */
 
+  // source, when given, is set to where the texture's pixels ended up
+  TexRenderFunc texture_render_func_(const std::string &name, bool retro, TextureSource *source = nullptr);
+
   void render_texture_(
       const std::string &name,
       const std::shared_ptr<gl::TextureUnit> &tex_unit,
@@ -193,6 +329,16 @@ private:
       const baphomet::RGB &color
   );
 
+  void render_sprite_(
+      const std::string &pages_name,
+      const std::shared_ptr<gl::TextureArray> &pages,
+      int layer, bool fully_opaque,
+      float x, float y, float w, float h,
+      float tx, float ty, float tw, float th,
+      float cx, float cy, float angle,
+      const baphomet::RGB &color
+  );
+
   /*****************
    * RENDER TARGETS
    */
@@ -205,6 +351,12 @@ private:
       glm::mat4 projection
   );
 
+  // Both passes of batches, as seen through projection
+  void draw_batches_(BatchSet &batches, const glm::mat4 &projection, const glm::mat4 &view);
+
+  // rect is in the target's pixels, top down
+  void scissor_(GLsizei target_height, const Rect &rect);
+
   void resize_builtin_render_targets_(int width, int height);
 };
 
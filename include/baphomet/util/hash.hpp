@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace baphomet {
+
+// Fast, non-cryptographic 64-bit hash of size bytes at data, for telling
+// whether a block of memory has changed
+std::uint64_t hash64(const void *data, std::size_t size, std::uint64_t seed = 0);
+
+// FNV-1a over a null-terminated string, usable at compile time, for
+// hashing short names such as shader uniforms
+constexpr std::uint64_t fnv1a64(const char *str) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (; *str; ++str) {
+    hash ^= static_cast<unsigned char>(*str);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+} // namespace baphomet
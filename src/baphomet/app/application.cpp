@@ -5,6 +5,8 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include <utility>
+
 namespace baphomet {
 
 Application::Application() : Endpoint() {}
@@ -27,6 +29,7 @@ void Application::draw() {}
 
 void Application::set_overlay_enabled(bool enabled) {
   overlay_.enabled = enabled;
+  overlay_.render_target->invalidate();
 }
 
 void Application::unsticky(const std::string &label) {
@@ -69,7 +72,8 @@ void Application::imgui_endframe_() {
   gfx->clear(baphomet::rgba(0x00000000));
 
   ImGui::Render();
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  if (imgui_state_.render_target->refreshing())
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
   gfx->pop_render_target();
 
@@ -101,8 +105,16 @@ void Application::start_frame_() {
 }
 
 void Application::end_frame_() {
-  if (overlay_.enabled)
-    draw_overlay_();
+  if (overlay_.enabled) {
+    overlay_.pending_dt += frame_counter_.dt();
+    if (overlay_.render_target->refreshing())
+      draw_overlay_();
+  } else if (overlay_.render_target->refreshing()) {
+    // Cached, so it has to be cleared explicitly to stop showing
+    gfx->push_render_target(overlay_.render_target);
+    gfx->clear(baphomet::rgba(0x00000000));
+    gfx->pop_render_target();
+  }
 
   imgui_endframe_();
 
@@ -138,7 +150,8 @@ void Application::draw_overlay_() {
 }
 
 void Application::draw_debug_log_() {
-  Duration dt = frame_counter_.dt();
+  // Everything since the overlay was last drawn, since it's cached
+  Duration dt = std::exchange(overlay_.pending_dt, Duration::zero());
 
   glm::vec2 base_pos{1.0f, window->h() - 1};
 
@@ -195,6 +208,7 @@ void Application::draw_overlay_skip_line_(glm::vec2 &base_pos) {
 void Application::debug_log_(fmt::string_view format, fmt::format_args args) {
   auto msg = fmt::vformat(format, args);
   overlay_.log.lines.push_front(msg);
+  overlay_.render_target->invalidate();
 }
 
 /******************
@@ -256,6 +270,7 @@ void Application::init_gl_(glm::ivec2 glversion) {
   imgui_state_.render_target = gfx->make_render_target(0, 0, window->w(), window->h(), std::numeric_limits<std::uint64_t>::max());
 
   overlay_.render_target = gfx->make_render_target(0, 0, window->w(), window->h(), std::numeric_limits<std::uint64_t>::max());
+  overlay_.render_target->cache(sec(OVERLAY_REFRESH_INTERVAL_));
   overlay_.font = gfx->load_cp437(
       ResourceLoader::resolve_resource_path("fonts/1px_7x9.png"),
       7, 9,
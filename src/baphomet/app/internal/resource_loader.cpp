@@ -18,6 +18,10 @@ const std::shared_ptr<gl::TextureUnit> &ResourceLoader::get_texture_unit(const s
   return texture_units_[name];
 }
 
+void ResourceLoader::unload_texture_unit(const std::string &name) {
+  texture_units_.erase(name);
+}
+
 const std::filesystem::path &ResourceLoader::resource_path_() {
   const static std::filesystem::path RESOURCE_PATH =
       std::filesystem::path(__FILE__)
@@ -0,0 +1,80 @@
+#include "baphomet/gfx/camera.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <limits>
+
+namespace baphomet {
+
+Camera::Camera(float x, float y, float w, float h) {
+  viewport(x, y, w, h);
+}
+
+Camera &Camera::viewport(float x, float y, float w, float h) {
+  viewport_ = {x, y, w, h};
+  center_ = {w / 2.0f, h / 2.0f};
+  return *this;
+}
+
+Rect Camera::viewport() const {
+  return viewport_;
+}
+
+Camera &Camera::center(float x, float y) {
+  center_ = {x, y};
+  return *this;
+}
+
+Point Camera::center() const {
+  return center_;
+}
+
+Camera &Camera::zoom(float zoom) {
+  zoom_ = zoom;
+  return *this;
+}
+
+float Camera::zoom() const {
+  return zoom_;
+}
+
+Camera &Camera::angle(float angle) {
+  angle_ = angle;
+  return *this;
+}
+
+float Camera::angle() const {
+  return angle_;
+}
+
+glm::mat4 Camera::projection() const {
+  return glm::ortho(0.0f, viewport_.w, viewport_.h, 0.0f, 0.0f, 1.0f) * view();
+}
+
+Rect Camera::visible() const {
+  auto inv = glm::inverse(view());
+
+  glm::vec2 lo{std::numeric_limits<float>::max()};
+  glm::vec2 hi{std::numeric_limits<float>::lowest()};
+  for (auto corner : {
+      glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+      glm::vec4(viewport_.w, 0.0f, 0.0f, 1.0f),
+      glm::vec4(viewport_.w, viewport_.h, 0.0f, 1.0f),
+      glm::vec4(0.0f, viewport_.h, 0.0f, 1.0f)
+  }) {
+    auto p = glm::vec2(inv * corner);
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+
+  return {lo.x, lo.y, hi.x - lo.x, hi.y - lo.y};
+}
+
+glm::mat4 Camera::view() const {
+  auto m = glm::translate(glm::mat4(1.0f), glm::vec3(viewport_.w / 2.0f, viewport_.h / 2.0f, 0.0f));
+  m = glm::rotate(m, glm::radians(-angle_), glm::vec3(0.0f, 0.0f, 1.0f));
+  m = glm::scale(m, glm::vec3(zoom_, zoom_, 1.0f));
+  return glm::translate(m, glm::vec3(-center_.x, -center_.y, 0.0f));
+}
+
+} // namespace baphomet
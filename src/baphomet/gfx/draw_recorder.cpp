@@ -0,0 +1,590 @@
+#include "baphomet/gfx/draw_recorder.hpp"
+
+#include "baphomet/gfx/gl/batching/line_batch.hpp"
+#include "baphomet/gfx/gl/batching/lined_batch.hpp"
+#include "baphomet/gfx/gl/batching/oval_batch.hpp"
+#include "baphomet/gfx/gl/batching/pixel_batch.hpp"
+#include "baphomet/gfx/gl/batching/rect_batch.hpp"
+#include "baphomet/gfx/gl/batching/sprite_batch.hpp"
+#include "baphomet/gfx/gl/batching/texture_batch.hpp"
+#include "baphomet/gfx/gl/batching/tri_batch.hpp"
+#include "baphomet/gfx/spritesheet.hpp"
+#include "baphomet/gfx/texture.hpp"
+#include "baphomet/util/hash.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace baphomet {
+
+DrawRecorder::DrawRecorder(std::uint64_t sort_key) : sort_key_(sort_key) {}
+
+void DrawRecorder::sort_key(std::uint64_t key) {
+  sort_key_ = key;
+}
+
+std::uint64_t DrawRecorder::sort_key() const {
+  return sort_key_;
+}
+
+void DrawRecorder::cull_to(float x, float y, float w, float h) {
+  cull_ = {x, y, x + w, y + h};
+}
+
+void DrawRecorder::track_damage(bool enable) {
+  track_damage_ = enable;
+}
+
+void DrawRecorder::clear() {
+  for (std::size_t i = 0; i < run_count_; ++i) {
+    auto &run = runs_[i];
+
+    // Spans left over from before that went unused since are dropped, the
+    // rest keep their storage
+    std::erase_if(run.spans, [](const Span_ &s) {
+      return s.opaque.empty() && s.alpha.empty();
+    });
+    for (auto &span : run.spans) {
+      span.opaque.clear();
+      span.alpha.clear();
+      span.opaque_indices.clear();
+      span.alpha_indices.clear();
+    }
+
+    run.alpha_cmds.clear();
+    run.damage.clear();
+    run.z_count = 0.0f;
+  }
+
+  run_count_ = 0;
+  last_span_ = 0;
+  culled_count_ = 0;
+}
+
+bool DrawRecorder::empty() const {
+  return size() == 0;
+}
+
+std::size_t DrawRecorder::size() const {
+  std::size_t size{0};
+  for (std::size_t i = 0; i < run_count_; ++i)
+    size += static_cast<std::size_t>(runs_[i].z_count);
+  return size;
+}
+
+std::size_t DrawRecorder::culled_count() const {
+  return culled_count_;
+}
+
+/*************
+ * PRIMITIVES
+ */
+
+void DrawRecorder::pixel(float x, float y, const baphomet::RGB &color) {
+  auto bounds = bounds_of_({x, y, x + 1.0f, y + 1.0f}, 0.0f, 0.0f, 0.0f);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::pixel, x, y, color);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::pixel);
+  gl::PixelBatch::write(
+      grow_(translucent ? span.alpha : span.opaque, gl::PixelBatch::SLOTS),
+      x + 0.5f, y + 0.5f,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a)
+  );
+  close_(run, span, translucent, gl::PixelBatch::SLOTS, bounds);
+}
+
+void DrawRecorder::pixel(Point p, const baphomet::RGB &color) {
+  pixel(p.x, p.y, color);
+}
+
+void DrawRecorder::line(float x0, float y0, float x1, float y1, const baphomet::RGB &color, float cx, float cy, float angle) {
+  auto bounds = bounds_of_({x0, y0, x1, y1}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::line, x0, y0, x1, y1, color, cx, cy, angle);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::line);
+  gl::LineBatch::write(
+      grow_(translucent ? span.alpha : span.opaque, gl::LineBatch::SLOTS),
+      x0 + 0.5f, y0 + 0.5f,
+      x1 + 0.5f, y1 + 0.5f,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a),
+      cx, cy, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::LineBatch::SLOTS, bounds);
+}
+
+void DrawRecorder::line(float x0, float y0, float x1, float y1, const baphomet::RGB &color) {
+  line(x0, y0, x1, y1, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::line(Line l, const baphomet::RGB &color) {
+  line(l.x0, l.y0, l.x1, l.y1, color, 0.0f, 0.0f, 0.0f);
+}
+
+// ********** FILLED ***********
+
+void DrawRecorder::fill_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle) {
+  auto bounds = bounds_of_({x0, y0, x1, y1, x2, y2}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::fill_tri, x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::tri);
+  gl::TriBatch::write(
+      grow_(translucent ? span.alpha : span.opaque, gl::TriBatch::SLOTS),
+      x0, y0,
+      x1, y1,
+      x2, y2,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a),
+      cx, cy, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::TriBatch::SLOTS, bounds);
+}
+
+void DrawRecorder::fill_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color) {
+  fill_tri(x0, y0, x1, y1, x2, y2, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::fill_tri(Tri t, const baphomet::RGB &color) {
+  fill_tri(t.x0, t.y0, t.x1, t.y1, t.x2, t.y2, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::fill_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle) {
+  auto bounds = bounds_of_({x, y, x + w, y, x + w, y + h, x, y + h}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::fill_rect, x, y, w, h, color, cx, cy, angle);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::rect);
+  gl::RectBatch::write(
+      grow_(translucent ? span.alpha : span.opaque, gl::RectBatch::SLOTS),
+      x, y,
+      w, h,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a),
+      cx, cy, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::RectBatch::SLOTS, bounds);
+}
+
+void DrawRecorder::fill_rect(float x, float y, float w, float h, const baphomet::RGB &color, float angle) {
+  fill_rect(x, y, w, h, color, x + w / 2.0f, y + h / 2.0f, angle);
+}
+
+void DrawRecorder::fill_rect(float x, float y, float w, float h, const baphomet::RGB &color) {
+  fill_rect(x, y, w, h, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::fill_rect(Rect r, const baphomet::RGB &color) {
+  fill_rect(r.x, r.y, r.w, r.h, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::fill_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle) {
+  auto bounds = bounds_of_({
+      x - x_radius, y - y_radius, x + x_radius, y - y_radius,
+      x + x_radius, y + y_radius, x - x_radius, y + y_radius
+  }, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::fill_oval, x, y, x_radius, y_radius, color, cx, cy, angle);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::oval);
+  gl::OvalBatch::write(
+      grow_(translucent ? span.alpha : span.opaque, gl::OvalBatch::SLOTS),
+      x + 0.5f, y + 0.5f,
+      x_radius + 0.5f, y_radius + 0.5f,
+      0.0f,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a),
+      cx + 0.5f, cy + 0.5f, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::OvalBatch::SLOTS, bounds);
+}
+
+void DrawRecorder::fill_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color) {
+  fill_oval(x, y, x_radius, y_radius, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::fill_oval(Oval o, const baphomet::RGB &color) {
+  fill_oval(o.x, o.y, o.rad_x, o.rad_y, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::fill_circle(float x, float y, float radius, const baphomet::RGB &color) {
+  fill_oval(x, y, radius, radius, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::fill_circle(Circle c, const baphomet::RGB &color) {
+  fill_oval(c.x, c.y, c.rad, c.rad, color, 0.0f, 0.0f, 0.0f);
+}
+
+// ********** LINED ***********
+
+void DrawRecorder::draw_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle) {
+  auto bounds = bounds_of_({x0, y0, x1, y1, x2, y2}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::draw_tri, x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::lined);
+  auto &vertices = translucent ? span.alpha : span.opaque;
+  auto base = static_cast<unsigned int>(vertices.size() / gl::LinedBatch::VERTEX_SLOTS);
+  gl::LinedBatch::write_tri(
+      grow_(vertices, gl::LinedBatch::TRI_SLOTS),
+      grow_(translucent ? span.alpha_indices : span.opaque_indices, gl::LinedBatch::TRI_INDICES),
+      base,
+      x0 + 0.5f, y0 + 0.5f,
+      x1 + 0.5f, y1 + 0.5f,
+      x2 + 0.5f, y2 + 0.5f,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a),
+      cx, cy, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::LinedBatch::TRI_INDICES, bounds);
+}
+
+void DrawRecorder::draw_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color) {
+  draw_tri(x0, y0, x1, y1, x2, y2, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::draw_tri(Tri t, const baphomet::RGB &color) {
+  draw_tri(t.x0, t.y0, t.x1, t.y1, t.x2, t.y2, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::draw_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle) {
+  auto bounds = bounds_of_({x, y, x + w, y, x + w, y + h, x, y + h}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::draw_rect, x, y, w, h, color, cx, cy, angle);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::lined);
+  auto &vertices = translucent ? span.alpha : span.opaque;
+  auto base = static_cast<unsigned int>(vertices.size() / gl::LinedBatch::VERTEX_SLOTS);
+  gl::LinedBatch::write_rect(
+      grow_(vertices, gl::LinedBatch::RECT_SLOTS),
+      grow_(translucent ? span.alpha_indices : span.opaque_indices, gl::LinedBatch::RECT_INDICES),
+      base,
+      x + 0.5f, y + 0.5f,
+      w - 1, h - 1,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a),
+      cx, cy, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::LinedBatch::RECT_INDICES, bounds);
+}
+
+void DrawRecorder::draw_rect(float x, float y, float w, float h, const baphomet::RGB &color, float angle) {
+  draw_rect(x, y, w, h, color, x + w / 2.0f, y + h / 2.0f, angle);
+}
+
+void DrawRecorder::draw_rect(float x, float y, float w, float h, const baphomet::RGB &color) {
+  draw_rect(x, y, w, h, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::draw_rect(Rect r, const baphomet::RGB &color) {
+  draw_rect(r.x, r.y, r.w, r.h, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::draw_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle) {
+  auto bounds = bounds_of_({
+      x - x_radius, y - y_radius, x + x_radius, y - y_radius,
+      x + x_radius, y + y_radius, x - x_radius, y + y_radius
+  }, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  track_damage_values_(run, bounds, Kind_::draw_oval, x, y, x_radius, y_radius, color, cx, cy, angle);
+
+  bool translucent = color.a < 255;
+  auto &span = span_(run, gl::BatchType::oval);
+  gl::OvalBatch::write(
+      grow_(translucent ? span.alpha : span.opaque, gl::OvalBatch::SLOTS),
+      x + 0.5f, y + 0.5f,
+      x_radius, y_radius,
+      1.0f,
+      run.z_count,
+      gl::pack_rgba8(color.r, color.g, color.b, color.a),
+      cx + 0.5f, cy + 0.5f, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::OvalBatch::SLOTS, bounds);
+}
+
+void DrawRecorder::draw_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color) {
+  draw_oval(x, y, x_radius, y_radius, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::draw_oval(Oval o, const baphomet::RGB &color) {
+  draw_oval(o.x, o.y, o.rad_x, o.rad_y, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::draw_circle(float x, float y, float radius, const baphomet::RGB &color) {
+  draw_oval(x, y, radius, radius, color, 0.0f, 0.0f, 0.0f);
+}
+
+void DrawRecorder::draw_circle(Circle c, const baphomet::RGB &color) {
+  draw_oval(c.x, c.y, c.rad, c.rad, color, 0.0f, 0.0f, 0.0f);
+}
+
+// ********** TEXTURED ***********
+
+void DrawRecorder::texture(
+    const Texture &tex,
+    float x, float y, float w, float h,
+    float tx, float ty, float tw, float th,
+    float cx, float cy, float angle,
+    const baphomet::RGB &color
+) {
+  texture_(tex.source_, x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
+}
+
+void DrawRecorder::texture(
+    const Texture &tex,
+    float x, float y, float w, float h,
+    const baphomet::RGB &color
+) {
+  texture(tex, x, y, w, h, 0.0f, 0.0f, tex.width_, tex.height_, 0.0f, 0.0f, 0.0f, color);
+}
+
+void DrawRecorder::texture(
+    const Texture &tex,
+    float x, float y,
+    const baphomet::RGB &color
+) {
+  texture(tex, x, y, tex.width_, tex.height_, 0.0f, 0.0f, tex.width_, tex.height_, 0.0f, 0.0f, 0.0f, color);
+}
+
+void DrawRecorder::sprite(
+    const Spritesheet &sheet,
+    const std::string &name,
+    float x, float y, float w, float h,
+    float cx, float cy, float angle,
+    const baphomet::RGB &color
+) {
+  auto it = sheet.mappings_.find(name);
+  if (it == sheet.mappings_.end())
+    return;
+
+  const auto &m = it->second;
+  texture_(sheet.source_, x, y, w, h, m.x, m.y, m.z, m.w, cx, cy, angle, color);
+}
+
+void DrawRecorder::sprite(
+    const Spritesheet &sheet,
+    const std::string &name,
+    float x, float y, float w, float h,
+    const baphomet::RGB &color
+) {
+  sprite(sheet, name, x, y, w, h, 0.0f, 0.0f, 0.0f, color);
+}
+
+void DrawRecorder::sprite(
+    const Spritesheet &sheet,
+    const std::string &name,
+    float x, float y,
+    const baphomet::RGB &color
+) {
+  auto it = sheet.mappings_.find(name);
+  if (it == sheet.mappings_.end())
+    return;
+
+  const auto &m = it->second;
+  texture_(sheet.source_, x, y, m.z, m.w, m.x, m.y, m.z, m.w, 0.0f, 0.0f, 0.0f, color);
+}
+
+/**********
+ * HELPERS
+ */
+
+DrawRecorder::Bounds_ DrawRecorder::bounds_of_(std::initializer_list<float> points, float cx, float cy, float angle) const {
+  Bounds_ bounds{
+      std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+      std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()
+  };
+
+  auto extend = [&](float x, float y) {
+    bounds.x0 = std::min(bounds.x0, x);
+    bounds.y0 = std::min(bounds.y0, y);
+    bounds.x1 = std::max(bounds.x1, x);
+    bounds.y1 = std::max(bounds.y1, y);
+  };
+
+  if (angle == 0.0f)
+    for (auto p = points.begin(); p != points.end(); p += 2)
+      extend(p[0], p[1]);
+  else {
+    gl::Rotation rot(cx, cy, glm::radians(angle));
+    for (auto p = points.begin(); p != points.end(); p += 2) {
+      float x = p[0], y = p[1];
+      rot.apply(x, y);
+      extend(x, y);
+    }
+  }
+
+  // Lines, outlines and antialiased edges reach a little past the points
+  bounds.x0 -= 1.0f;
+  bounds.y0 -= 1.0f;
+  bounds.x1 += 1.0f;
+  bounds.y1 += 1.0f;
+
+  return bounds;
+}
+
+bool DrawRecorder::culled_(const Bounds_ &bounds) {
+  // NaNs compare false, so they're kept
+  if (bounds.x1 <= cull_.x0 || bounds.y1 <= cull_.y0 || bounds.x0 >= cull_.x1 || bounds.y0 >= cull_.y1) {
+    culled_count_++;
+    return true;
+  }
+  return false;
+}
+
+DrawRecorder::Run_ &DrawRecorder::run_() {
+  if (run_count_ == 0 || runs_[run_count_ - 1].key != sort_key_) {
+    if (run_count_ == runs_.size())
+      runs_.emplace_back();
+    runs_[run_count_++].key = sort_key_;
+    last_span_ = 0;
+  }
+  return runs_[run_count_ - 1];
+}
+
+DrawRecorder::Span_ &DrawRecorder::span_(Run_ &run, gl::BatchType type, const std::string &name) {
+  auto matches = [&](const Span_ &s) { return s.type == type && s.name == name; };
+
+  // Draws of one kind usually come in a row
+  if (last_span_ < run.spans.size() && matches(run.spans[last_span_]))
+    return run.spans[last_span_];
+
+  auto it = std::find_if(run.spans.begin(), run.spans.end(), matches);
+  if (it == run.spans.end()) {
+    it = run.spans.emplace(run.spans.end());
+    it->type = type;
+    it->name = name;
+  }
+
+  last_span_ = static_cast<std::size_t>(it - run.spans.begin());
+  return *it;
+}
+
+template <typename T>
+std::span<T> DrawRecorder::grow_(std::vector<T> &v, std::size_t n) {
+  auto size = v.size();
+  v.resize(size + n);
+  return std::span<T>(v).subspan(size);
+}
+
+template <typename... Ts>
+void DrawRecorder::track_damage_values_(Run_ &run, const Bounds_ &bounds, Kind_ kind, const Ts &...values) {
+  static_assert((std::is_trivially_copyable_v<Ts> && ...));
+
+  if (!track_damage_)
+    return;
+
+  auto hash = hash64(&kind, sizeof(kind));
+  ((hash = hash64(&values, sizeof(values), hash)), ...);
+
+  run.damage.push_back({hash, bounds});
+}
+
+void DrawRecorder::close_(Run_ &run, const Span_ &span, bool translucent, std::size_t count, const Bounds_ &bounds) {
+  if (translucent) {
+    auto end = span.type == gl::BatchType::lined ? span.alpha_indices.size() : span.alpha.size();
+    run.alpha_cmds.push_back({
+        static_cast<std::uint32_t>(&span - run.spans.data()),
+        static_cast<std::uint32_t>(end - count),
+        static_cast<std::uint32_t>(count),
+        bounds
+    });
+  }
+
+  run.z_count++;
+}
+
+void DrawRecorder::texture_(
+    const TextureSource &source,
+    float x, float y, float w, float h,
+    float tx, float ty, float tw, float th,
+    float cx, float cy, float angle,
+    const baphomet::RGB &color
+) {
+  if (!source.unit && !source.pages)
+    return;
+
+  auto bounds = bounds_of_({x, y, x + w, y, x + w, y + h, x, y + h}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+
+  auto &run = run_();
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  bool translucent = color.a < 255 || !source.fully_opaque;
+
+  if (source.unit) {
+    track_damage_values_(run, bounds, Kind_::texture, source.unit.get(), x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
+
+    auto &span = span_(run, gl::BatchType::texture, source.batch_name);
+    if (!span.unit)
+      span.unit = source.unit;
+
+    auto slots = gl::TextureBatch::slots(*source.unit);
+    gl::TextureBatch::write(
+        grow_(translucent ? span.alpha : span.opaque, slots),
+        *source.unit,
+        x, y, w, h,
+        tx, ty, tw, th,
+        run.z_count,
+        packed,
+        cx, cy, glm::radians(angle)
+    );
+    close_(run, span, translucent, slots, bounds);
+    return;
+  }
+
+  // Mappings stay relative to the original texture, and are moved to
+  // where it was packed here, as GfxMgr does
+  track_damage_values_(run, bounds, Kind_::sprite, source.pages.get(), source.layer, x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
+
+  auto &span = span_(run, gl::BatchType::sprite, source.batch_name);
+  if (!span.pages)
+    span.pages = source.pages;
+
+  gl::SpriteBatch::write(
+      grow_(translucent ? span.alpha : span.opaque, gl::SpriteBatch::SLOTS),
+      *source.pages,
+      source.layer,
+      x, y, w, h,
+      tx + source.x, ty + source.y, tw, th,
+      run.z_count,
+      packed,
+      cx, cy, glm::radians(angle)
+  );
+  close_(run, span, translucent, gl::SpriteBatch::SLOTS, bounds);
+}
+
+} // namespace baphomet
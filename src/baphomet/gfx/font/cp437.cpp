@@ -6,8 +6,9 @@ CP437::CP437(
     TexRenderFunc render_func,
     const std::string &name,
     GLuint width, GLuint height,
-    GLuint char_w, GLuint char_h
-) : Texture(render_func, name, width, height), char_w_(char_w), char_h_(char_h) {}
+    GLuint char_w, GLuint char_h,
+    TextureSource source
+) : Texture(render_func, name, width, height, std::move(source)), char_w_(char_w), char_h_(char_h) {}
 
 GLuint CP437::char_w() const {
   return char_w_;
@@ -1,9 +1,13 @@
 #include "baphomet/gfx/gl/batching/batch.hpp"
 
+#include <algorithm>
+
 namespace baphomet::gl {
 
-Batch::Batch(std::size_t floats_per_vertex, BatchType type)
-    : type(type), floats_per_vertex_(floats_per_vertex) {}
+Batch::Batch(VertexLayout layout, BatchType type)
+    : type(type), layout_(std::move(layout)) {
+  floats_per_vertex_ = layout_.slots();
+}
 
 bool Batch::empty_opaque() {
   return !opaque_vertices_ || opaque_vertices_->size() == 0;
@@ -34,4 +38,114 @@ void Batch::clear() {
   if (alpha_vertices_)  alpha_vertices_->clear();
 }
 
+void Batch::append_opaque(std::span<const float> vertices, float z_offset) {
+  if (vertices.empty())
+    return;
+  if (!opaque_vertices_)
+    init_opaque_();
+
+  // The buffer grows at the front, one primitive at a time, so they go in
+  // back to front
+  auto dst = opaque_vertices_->reserve_front(vertices.size());
+  auto prim_size = floats_per_vertex_ * prim_vertices_;
+  for (std::size_t i = 0; i < vertices.size(); i += prim_size)
+    copy_rebased_(
+        vertices.subspan(vertices.size() - i - prim_size, prim_size),
+        dst.subspan(i, prim_size),
+        z_offset
+    );
+}
+
+void Batch::append_alpha(std::span<const float> vertices, float z_offset) {
+  if (vertices.empty())
+    return;
+  if (!alpha_vertices_)
+    init_alpha_();
+
+  copy_rebased_(vertices, alpha_vertices_->reserve_back(vertices.size()), z_offset);
+}
+
+void Batch::stream_through(std::shared_ptr<StreamRing> ring) {
+  stream_ring_ = std::move(ring);
+  if (!stream_ring_)
+    return;
+
+  if (opaque_vertices_) opaque_vertices_->stream_through(stream_ring_, floats_per_vertex_);
+  if (alpha_vertices_)  alpha_vertices_->stream_through(stream_ring_, floats_per_vertex_);
+}
+
+void Batch::fingerprint_uploads(bool enable) {
+  fingerprint_ = enable;
+
+  if (opaque_vertices_) opaque_vertices_->fingerprint(enable);
+  if (alpha_vertices_)  alpha_vertices_->fingerprint(enable);
+}
+
+std::unique_ptr<VecBuffer<float>> Batch::make_vertices_(std::size_t initial_size, bool front_to_back) {
+  auto vertices = std::make_unique<VecBuffer<float>>(
+      initial_size, front_to_back, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
+
+  if (stream_ring_)
+    vertices->stream_through(stream_ring_, floats_per_vertex_);
+  vertices->fingerprint(fingerprint_);
+
+  return vertices;
+}
+
+void Batch::init_opaque_() {
+  opaque_vertices_ = make_vertices_(floats_per_vertex_ * prim_vertices_, true);
+  opaque_vao_ = std::make_unique<VertexArray>();
+  opaque_vao_->attrib_pointer(opaque_vertices_.get(), layout_.definitions());
+}
+
+void Batch::init_alpha_() {
+  alpha_vertices_ = make_vertices_(floats_per_vertex_ * prim_vertices_, false);
+  alpha_vao_ = std::make_unique<VertexArray>();
+  alpha_vao_->attrib_pointer(alpha_vertices_.get(), layout_.definitions());
+}
+
+void Batch::copy_rebased_(std::span<const float> src, std::span<float> dst, float z_offset) const {
+  std::copy(src.begin(), src.end(), dst.begin());
+  for (std::size_t i = z_slot_; i < dst.size(); i += floats_per_vertex_)
+    dst[i] += z_offset;
+}
+
+GLint Batch::sync_vertices_(VecBuffer<float> *vertices, VertexArray *vao, const std::vector<AttrDef> &definitions) {
+  vertices->sync();
+  vao->ensure_attrib_pointer(vertices->gl_buffer(), definitions);
+
+  return static_cast<GLint>(vertices->gl_offset() / static_cast<std::ptrdiff_t>(floats_per_vertex_));
+}
+
+void Batch::use_shader_() {
+  shader_->use();
+}
+
+void Batch::draw_alpha_arrays_(DrawMode mode, std::span<const DrawRange> ranges) {
+  if (empty_alpha() || ranges.empty())
+    return;
+
+  auto base = sync_vertices_(alpha_vertices_.get(), alpha_vao_.get(), layout_.definitions());
+  auto fpv = static_cast<GLint>(floats_per_vertex_);
+
+  if (ranges.size() == 1) {
+    alpha_vao_->draw_arrays(mode, base + ranges[0].first / fpv, ranges[0].count / fpv);
+    return;
+  }
+
+  multi_firsts_.clear();
+  multi_counts_.clear();
+  for (const auto &r : ranges) {
+    multi_firsts_.emplace_back(base + r.first / fpv);
+    multi_counts_.emplace_back(r.count / fpv);
+  }
+
+  alpha_vao_->multi_draw_arrays(
+      mode,
+      multi_firsts_.data(),
+      multi_counts_.data(),
+      static_cast<GLsizei>(ranges.size())
+  );
+}
+
 } // namespace baphomet::gl
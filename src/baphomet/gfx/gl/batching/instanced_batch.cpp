@@ -0,0 +1,74 @@
+#include "baphomet/gfx/gl/batching/instanced_batch.hpp"
+
+namespace baphomet::gl {
+
+InstancedBatch::InstancedBatch(VertexLayout instance_layout, BatchType type, const std::vector<float> &mesh)
+    : Batch(std::move(instance_layout), type) {
+  // Every record follows the rect (or position and size) with its z
+  z_slot_ = 4;
+
+  mesh_ = std::make_unique<StaticBuffer<float>>(mesh, gl::BufTarget::array, gl::BufUsage::static_draw);
+  mesh_vertex_count_ = static_cast<GLsizei>(mesh.size() / 2);
+
+  instance_definitions_ = layout_.definitions(1, 1);
+}
+
+std::size_t InstancedBatch::vertex_count_opaque() {
+  return (size_opaque() / floats_per_vertex_) * mesh_vertex_count_;
+}
+
+std::size_t InstancedBatch::vertex_count_alpha() {
+  return (size_alpha() / floats_per_vertex_) * mesh_vertex_count_;
+}
+
+void InstancedBatch::draw_opaque() {
+  if (!empty_opaque()) {
+    auto base = sync_vertices_(opaque_vertices_.get(), opaque_vao_.get(), instance_definitions_);
+
+    use_shader_();
+
+    opaque_vao_->draw_arrays_instanced(
+      DrawMode::triangles,
+      0, mesh_vertex_count_,
+      opaque_vertices_->size() / floats_per_vertex_,
+      base + opaque_vertices_->front() / floats_per_vertex_
+    );
+  }
+}
+
+void InstancedBatch::draw_alpha(std::span<const DrawRange> ranges) {
+  if (!empty_alpha()) {
+    auto base = sync_vertices_(alpha_vertices_.get(), alpha_vao_.get(), instance_definitions_);
+
+    use_shader_();
+
+    // Each range is its own set of instances, but state is only set up once
+    for (const auto &r : ranges)
+      alpha_vao_->draw_arrays_instanced(
+        DrawMode::triangles,
+        0, mesh_vertex_count_,
+        r.count / floats_per_vertex_,
+        base + r.first / floats_per_vertex_
+      );
+  }
+}
+
+void InstancedBatch::init_opaque_() {
+  opaque_vertices_ = make_vertices_(floats_per_vertex_ * 16, true);
+  init_vao_(opaque_vao_, opaque_vertices_.get());
+}
+
+void InstancedBatch::init_alpha_() {
+  alpha_vertices_ = make_vertices_(floats_per_vertex_ * 16, false);
+  init_vao_(alpha_vao_, alpha_vertices_.get());
+}
+
+void InstancedBatch::init_vao_(std::unique_ptr<VertexArray> &vao, const VecBuffer<float> *instances) {
+  vao = std::make_unique<VertexArray>();
+  vao->attrib_pointer(mesh_.get(), {
+    {0, 2, gl::AttrType::float_t, false, sizeof(float) * 2, 0}
+  });
+  vao->attrib_pointer(instances, instance_definitions_);
+}
+
+} // namespace baphomet::gl
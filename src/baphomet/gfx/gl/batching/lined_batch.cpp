@@ -1,36 +1,27 @@
 #include "baphomet/gfx/gl/batching/lined_batch.hpp"
 
+#include "baphomet/gfx/gl/state_cache.hpp"
+
 namespace baphomet::gl {
 
-LinedBatch::LinedBatch() : Batch(10, BatchType::lined) {
+LinedBatch::LinedBatch() : Batch(VertexLayout().floats(3).color(), BatchType::lined) {
   shader_ = ShaderBuilder("LineBatch")
       .vert_from_src(R"glsl(
 #version 330 core
 layout (location = 0) in vec3 in_pos;
 layout (location = 1) in vec4 in_color;
-layout (location = 2) in vec3 in_trans;
 
 out vec4 out_color;
 
-uniform float z_max;
-uniform mat4 projection;
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  float z_max;
+};
 
 void main() {
-  float c = cos(in_trans.z);
-  float s = sin(in_trans.z);
-  float x = in_trans.x;
-  float y = in_trans.y;
-  float m30 = -x * c + y * s + x;
-  float m31 = -x * s - y * c + y;
-  mat4 trans = mat4(
-    vec4(c,   s,   0.0, 0.0),
-    vec4(-s,  c,   0.0, 0.0),
-    vec4(0.0, 0.0, 1.0, 0.0),
-    vec4(m30, m31, 0.0, 1.0)
-  );
-
   float z = -(z_max - in_pos.z) / (z_max + 1.0);
-  gl_Position = projection * trans * vec4(in_pos.xy, z, 1.0);
+  gl_Position = projection * vec4(in_pos.xy, z, 1.0);
   out_color = in_color;
 }
     )glsl")
@@ -44,7 +35,8 @@ void main() {
   FragColor = vec4(out_color.xyz * out_color.a, out_color.a);
 }
     )glsl")
-      .link();
+      .block("Frame", FrameBlock::BINDING)
+      .link_shared();
 }
 
 void LinedBatch::clear() {
@@ -53,44 +45,57 @@ void LinedBatch::clear() {
   if (alpha_indices_)  alpha_indices_->clear();
 }
 
+void LinedBatch::fingerprint_uploads(bool enable) {
+  Batch::fingerprint_uploads(enable);
+  if (opaque_indices_) opaque_indices_->fingerprint(enable);
+  if (alpha_indices_)  alpha_indices_->fingerprint(enable);
+}
+
 void LinedBatch::add_tri(
     float x0, float y0,
     float x1, float y1,
     float x2, float y2,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
-  if (a < 1.0f)
-    add_tri_alpha_(x0, y0, x1, y1, x2, y2, z, r, g, b, a, cx, cy, angle);
+  if (rgba8_alpha(color) < 255)
+    add_tri_alpha_(x0, y0, x1, y1, x2, y2, z, color, cx, cy, angle);
   else
-    add_tri_opaque_(x0, y0, x1, y1, x2, y2, z, r, g, b, a, cx, cy, angle);
+    add_tri_opaque_(x0, y0, x1, y1, x2, y2, z, color, cx, cy, angle);
 }
 
 void LinedBatch::add_rect(
     float x, float y,
     float w, float h,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
-  if (a < 1.0f)
-    add_rect_alpha_(x, y, w, h, z, r, g, b, a, cx, cy, angle);
+  if (rgba8_alpha(color) < 255)
+    add_rect_alpha_(x, y, w, h, z, color, cx, cy, angle);
   else
-    add_rect_opaque_(x, y, w, h, z, r, g, b, a, cx, cy, angle);
+    add_rect_opaque_(x, y, w, h, z, color, cx, cy, angle);
 }
 
-void LinedBatch::add_oval(
-    float x, float y,
-    float x_radius, float y_radius,
-    float z,
-    float r, float g, float b, float a,
-    float cx, float cy, float angle
-) {
-  if (a < 1.0f)
-    add_oval_alpha_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle);
-  else
-    add_oval_opaque_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle);
+void LinedBatch::append_opaque(std::span<const float> vertices, std::span<const unsigned int> indices, float z_offset) {
+  if (vertices.empty())
+    return;
+  check_initialize_opaque_();
+
+  auto base = static_cast<unsigned int>(opaque_vertices_->size() / floats_per_vertex_);
+  copy_rebased_(vertices, opaque_vertices_->reserve_back(vertices.size()), z_offset);
+  copy_indices_(indices, opaque_indices_->reserve_front(indices.size()), base);
+}
+
+void LinedBatch::append_alpha(std::span<const float> vertices, std::span<const unsigned int> indices, float z_offset) {
+  if (vertices.empty())
+    return;
+  check_initialize_alpha_();
+
+  auto base = static_cast<unsigned int>(alpha_vertices_->size() / floats_per_vertex_);
+  copy_rebased_(vertices, alpha_vertices_->reserve_back(vertices.size()), z_offset);
+  copy_indices_(indices, alpha_indices_->reserve_back(indices.size()), base);
 }
 
 std::size_t LinedBatch::size_opaque() {
@@ -109,65 +114,80 @@ std::size_t LinedBatch::vertex_count_alpha() {
   return size_alpha();
 }
 
-void LinedBatch::draw_opaque(float z_max, glm::mat4 projection) {
+void LinedBatch::draw_opaque() {
   if (!empty_opaque()) {
-    opaque_vertices_->sync();
+    auto base = sync_vertices_(opaque_vertices_.get(), opaque_vao_.get(), layout_.definitions());
     opaque_indices_->sync();
 
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
+    use_shader_();
 
-    glEnable(GL_PRIMITIVE_RESTART);
-    glPrimitiveRestartIndex(65565);
+    state_cache().set_enabled(Capability::primitive_restart, true);
+    glPrimitiveRestartIndex(RESTART_INDEX);
 
     opaque_vao_->draw_elements(
         DrawMode::line_loop,
         opaque_indices_->size(),
         GL_UNSIGNED_INT,
-        reinterpret_cast<void *>(opaque_indices_->front() * sizeof(unsigned int))
+        reinterpret_cast<void *>(opaque_indices_->front() * sizeof(unsigned int)),
+        base
     );
 
-    glDisable(GL_PRIMITIVE_RESTART);
+    state_cache().set_enabled(Capability::primitive_restart, false);
   }
 }
 
-void LinedBatch::draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) {
-  if (!empty_alpha()) {
-    alpha_vertices_->sync();
+void LinedBatch::draw_alpha(std::span<const DrawRange> ranges) {
+  if (!empty_alpha() && !ranges.empty()) {
+    auto base = sync_vertices_(alpha_vertices_.get(), alpha_vao_.get(), layout_.definitions());
     alpha_indices_->sync();
 
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
-
-    glEnable(GL_PRIMITIVE_RESTART);
-    glPrimitiveRestartIndex(65565);
-
-    alpha_vao_->draw_elements(
-        DrawMode::line_loop,
-        count,
-        GL_UNSIGNED_INT,
-        reinterpret_cast<void *>(first * sizeof(unsigned int))
-    );
-
-    glDisable(GL_PRIMITIVE_RESTART);
+    use_shader_();
+
+    state_cache().set_enabled(Capability::primitive_restart, true);
+    glPrimitiveRestartIndex(RESTART_INDEX);
+
+    if (ranges.size() == 1)
+      alpha_vao_->draw_elements(
+          DrawMode::line_loop,
+          ranges[0].count,
+          GL_UNSIGNED_INT,
+          reinterpret_cast<void *>(ranges[0].first * sizeof(unsigned int)),
+          base
+      );
+
+    else {
+      multi_counts_.clear();
+      multi_offsets_.clear();
+      multi_base_vertices_.clear();
+      for (const auto &r : ranges) {
+        multi_counts_.emplace_back(r.count);
+        multi_offsets_.emplace_back(reinterpret_cast<const void *>(r.first * sizeof(unsigned int)));
+        multi_base_vertices_.emplace_back(base);
+      }
+
+      alpha_vao_->multi_draw_elements(
+          DrawMode::line_loop,
+          multi_counts_.data(),
+          GL_UNSIGNED_INT,
+          multi_offsets_.data(),
+          static_cast<GLsizei>(ranges.size()),
+          multi_base_vertices_.data()
+      );
+    }
+
+    state_cache().set_enabled(Capability::primitive_restart, false);
   }
 }
 
 void LinedBatch::check_initialize_opaque_() {
   if (!opaque_vertices_) {
-    opaque_vertices_ = std::make_unique<VecBuffer<float>>(
-        floats_per_vertex_ * 2, false, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
+    opaque_vertices_ = make_vertices_(floats_per_vertex_ * 2, false);
     opaque_indices_ = std::make_unique<VecBuffer<unsigned int>>(
         1, true, gl::BufTarget::element_array, gl::BufUsage::dynamic_draw);
+    opaque_indices_->fingerprint(fingerprint_);
 
     opaque_vao_ = std::make_unique<VertexArray>();
-    opaque_vao_->attrib_pointer(opaque_vertices_.get(), {
-        {0, 3, gl::AttrType::float_t, false, sizeof(float) * 10, 0},
-        {1, 4, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 3},
-        {2, 3, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 7}
-    });
+    opaque_vao_->attrib_pointer(opaque_vertices_.get(), layout_.definitions());
 
     opaque_vao_->indices(opaque_indices_.get());
   }
@@ -175,17 +195,13 @@ void LinedBatch::check_initialize_opaque_() {
 
 void LinedBatch::check_initialize_alpha_() {
   if (!alpha_vertices_) {
-    alpha_vertices_ = std::make_unique<VecBuffer<float>>(
-        floats_per_vertex_ * 2, false, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
+    alpha_vertices_ = make_vertices_(floats_per_vertex_ * 2, false);
     alpha_indices_ = std::make_unique<VecBuffer<unsigned int>>(
         1, false, gl::BufTarget::element_array, gl::BufUsage::dynamic_draw);
+    alpha_indices_->fingerprint(fingerprint_);
 
     alpha_vao_ = std::make_unique<VertexArray>();
-    alpha_vao_->attrib_pointer(alpha_vertices_.get(), {
-        {0, 3, gl::AttrType::float_t, false, sizeof(float) * 10, 0},
-        {1, 4, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 3},
-        {2, 3, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 7}
-    });
+    alpha_vao_->attrib_pointer(alpha_vertices_.get(), layout_.definitions());
 
     alpha_vao_->indices(alpha_indices_.get());
   }
@@ -196,19 +212,16 @@ void LinedBatch::add_tri_opaque_(
     float x1, float y1,
     float x2, float y2,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
   check_initialize_opaque_();
 
   unsigned int base = opaque_vertices_->size() / floats_per_vertex_;
-  opaque_indices_->add({base, base + 1, base + 2, 65565});
-
-  opaque_vertices_->add({
-      x0, y0, z, r, g, b, a, cx, cy, angle,
-      x1, y1, z, r, g, b, a, cx, cy, angle,
-      x2, y2, z, r, g, b, a, cx, cy, angle
-  });
+  write_tri(
+      opaque_vertices_->reserve_back(TRI_SLOTS), opaque_indices_->reserve_front(TRI_INDICES), base,
+      x0, y0, x1, y1, x2, y2, z, color, cx, cy, angle
+  );
 }
 
 void LinedBatch::add_tri_alpha_(
@@ -216,222 +229,111 @@ void LinedBatch::add_tri_alpha_(
     float x1, float y1,
     float x2, float y2,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
   check_initialize_alpha_();
 
   unsigned int base = alpha_vertices_->size() / floats_per_vertex_;
-  alpha_indices_->add({base, base + 1, base + 2, 65565});
-
-  alpha_vertices_->add({
-      x0, y0, z, r, g, b, a, cx, cy, angle,
-      x1, y1, z, r, g, b, a, cx, cy, angle,
-      x2, y2, z, r, g, b, a, cx, cy, angle
-  });
+  write_tri(
+      alpha_vertices_->reserve_back(TRI_SLOTS), alpha_indices_->reserve_back(TRI_INDICES), base,
+      x0, y0, x1, y1, x2, y2, z, color, cx, cy, angle
+  );
 }
 
 void LinedBatch::add_rect_opaque_(
     float x, float y,
     float w, float h,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
   check_initialize_opaque_();
 
   unsigned int base = opaque_vertices_->size() / floats_per_vertex_;
-  opaque_indices_->add({base, base + 1, base + 2, base + 3, 65565});
-
-  opaque_vertices_->add({
-      x,     y,     z, r, g, b, a, cx, cy, angle,
-      x + w, y,     z, r, g, b, a, cx, cy, angle,
-      x + w, y + h, z, r, g, b, a, cx, cy, angle,
-      x,     y + h, z, r, g, b, a, cx, cy, angle
-  });
+  write_rect(
+      opaque_vertices_->reserve_back(RECT_SLOTS), opaque_indices_->reserve_front(RECT_INDICES), base,
+      x, y, w, h, z, color, cx, cy, angle
+  );
 }
 
 void LinedBatch::add_rect_alpha_(
     float x, float y,
     float w, float h,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
   check_initialize_alpha_();
 
   unsigned int base = alpha_vertices_->size() / floats_per_vertex_;
-  alpha_indices_->add({base, base + 1, base + 2, base + 3, 65565});
-
-  alpha_vertices_->add({
-      x,     y,     z, r, g, b, a, cx, cy, angle,
-      x + w, y,     z, r, g, b, a, cx, cy, angle,
-      x + w, y + h, z, r, g, b, a, cx, cy, angle,
-      x,     y + h, z, r, g, b, a, cx, cy, angle
-  });
-}
-
-void push_vertex(
-    std::vector<float> &vertices,
-    std::vector<unsigned int> &indices,
-    unsigned int &base,
-    float x, float y, float z,
-    float r, float g, float b, float a,
-    float cx, float cy, float angle
-) {
-  vertices.insert(vertices.end(), {x, y, z, r, g, b, a, cx, cy, angle});
-  indices.push_back(base);
-  base++;
+  write_rect(
+      alpha_vertices_->reserve_back(RECT_SLOTS), alpha_indices_->reserve_back(RECT_INDICES), base,
+      x, y, w, h, z, color, cx, cy, angle
+  );
 }
 
-void LinedBatch::add_oval_opaque_(
-    float x, float y,
-    float x_radius, float y_radius,
+void LinedBatch::write_tri(
+    std::span<float> dst,
+    std::span<unsigned int> dst_indices,
+    unsigned int base,
+    float x0, float y0,
+    float x1, float y1,
+    float x2, float y2,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
-  check_initialize_opaque_();
-
-  std::vector<float> vertices{};
-  std::vector<unsigned int> indices{};
-  unsigned int base = opaque_vertices_->size() / floats_per_vertex_;
-
-  static float
-      a0 = 0.0f,
-      a1 = glm::radians(90.0f),
-      a2 = glm::radians(180.0f),
-      a3 = glm::radians(270.0f),
-      a4 = glm::radians(360.0f);
-
-  float
-      x0 = x + x_radius * std::cos(a0),
-      y0 = y + y_radius * std::sin(a0),
-      x1 = x + x_radius * std::cos(a1),
-      y1 = y + y_radius * std::sin(a1),
-      x2 = x + x_radius * std::cos(a2),
-      y2 = y + y_radius * std::sin(a2),
-      x3 = x + x_radius * std::cos(a3),
-      y3 = y + y_radius * std::sin(a3);
-
-  push_vertex(vertices, indices, base, x0, y0, z, r, g, b, a, cx, cy, angle);
-  add_oval_opaque_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x1, y1, a1);
-
-  push_vertex(vertices, indices, base, x1, y1, z, r, g, b, a, cx, cy, angle);
-  add_oval_opaque_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x1, y1, a1, x2, y2, a2);
-
-  push_vertex(vertices, indices, base, x2, y2, z, r, g, b, a, cx, cy, angle);
-  add_oval_opaque_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x2, y2, a2, x3, y3, a3);
-
-  push_vertex(vertices, indices, base, x3, y3, z, r, g, b, a, cx, cy, angle);
-  add_oval_opaque_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x3, y3, a3, x0, y0, a4);
-
-  indices.push_back(65565);
-  opaque_indices_->add(indices);
-  opaque_vertices_->add(vertices);
-}
-
-void LinedBatch::add_oval_opaque_recurse_(
-    std::vector<float> &vertices,
-    std::vector<unsigned int> &indices,
-    unsigned int &base,
-    float x, float y,
-    float x_radius, float y_radius,
-    float z,
-    float r, float g, float b, float a,
-    float cx, float cy, float angle,
-    float x0, float y0, float a0,
-    float x1, float y1, float a1
-) {
-  float a2 = (a0 + a1) / 2.0f;
-  float
-      x2 = x + x_radius * std::cos(a2),
-      y2 = y + y_radius * std::sin(a2);
-
-  float dist_sq =
-      ((((x0 + x1) / 2.0f) - x2) * (((x0 + x1) / 2.0f) - x2)) +
-      ((((y0 + y1) / 2.0f) - y2) * (((y0 + y1) / 2.0f) - y2));
-  if (dist_sq > 2.0f) {
-    add_oval_opaque_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x2, y2, a2);
-    push_vertex(vertices, indices, base, x2, y2, z, r, g, b, a, cx, cy, angle);
-    add_oval_opaque_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x2, y2, a2, x1, y1, a1);
-  } else
-    push_vertex(vertices, indices, base, x2, y2, z, r, g, b, a, cx, cy, angle);
+  write_slots(dst_indices, base, base + 1, base + 2, RESTART_INDEX);
+
+  Rotation rot(cx, cy, angle);
+  rot.apply(x0, y0);
+  rot.apply(x1, y1);
+  rot.apply(x2, y2);
+
+  float c = rgba8_slot(color);
+  write_slots(dst,
+      x0, y0, z, c,
+      x1, y1, z, c,
+      x2, y2, z, c
+  );
 }
 
-void LinedBatch::add_oval_alpha_(
+void LinedBatch::write_rect(
+    std::span<float> dst,
+    std::span<unsigned int> dst_indices,
+    unsigned int base,
     float x, float y,
-    float x_radius, float y_radius,
+    float w, float h,
     float z,
-    float r, float g, float b, float a,
+    std::uint32_t color,
     float cx, float cy, float angle
 ) {
-  check_initialize_alpha_();
-
-  std::vector<float> vertices{};
-  std::vector<unsigned int> indices{};
-  unsigned int base = alpha_vertices_->size() / floats_per_vertex_;
-
-  static float
-      a0 = 0.0f,
-      a1 = glm::radians(90.0f),
-      a2 = glm::radians(180.0f),
-      a3 = glm::radians(270.0f),
-      a4 = glm::radians(360.0f);
+  write_slots(dst_indices, base, base + 1, base + 2, base + 3, RESTART_INDEX);
 
+  Rotation rot(cx, cy, angle);
   float
-      x0 = x + x_radius * std::cos(a0),
-      y0 = y + y_radius * std::sin(a0),
-      x1 = x + x_radius * std::cos(a1),
-      y1 = y + y_radius * std::sin(a1),
-      x2 = x + x_radius * std::cos(a2),
-      y2 = y + y_radius * std::sin(a2),
-      x3 = x + x_radius * std::cos(a3),
-      y3 = y + y_radius * std::sin(a3);
-
-  push_vertex(vertices, indices, base, x0, y0, z, r, g, b, a, cx, cy, angle);
-  add_oval_alpha_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x1, y1, a1);
-
-  push_vertex(vertices, indices, base, x1, y1, z, r, g, b, a, cx, cy, angle);
-  add_oval_alpha_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x1, y1, a1, x2, y2, a2);
-
-  push_vertex(vertices, indices, base, x2, y2, z, r, g, b, a, cx, cy, angle);
-  add_oval_alpha_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x2, y2, a2, x3, y3, a3);
-
-  push_vertex(vertices, indices, base, x3, y3, z, r, g, b, a, cx, cy, angle);
-  add_oval_alpha_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x3, y3, a3, x0, y0, a4);
-
-  indices.push_back(65565);
-  alpha_indices_->add(indices);
-  alpha_vertices_->add(vertices);
+      x0 = x,     y0 = y,
+      x1 = x + w, y1 = y,
+      x2 = x + w, y2 = y + h,
+      x3 = x,     y3 = y + h;
+  rot.apply(x0, y0);
+  rot.apply(x1, y1);
+  rot.apply(x2, y2);
+  rot.apply(x3, y3);
+
+  float c = rgba8_slot(color);
+  write_slots(dst,
+      x0, y0, z, c,
+      x1, y1, z, c,
+      x2, y2, z, c,
+      x3, y3, z, c
+  );
 }
 
-void LinedBatch::add_oval_alpha_recurse_(
-    std::vector<float> &vertices,
-    std::vector<unsigned int> &indices,
-    unsigned int &base,
-    float x, float y,
-    float x_radius, float y_radius,
-    float z,
-    float r, float g, float b, float a,
-    float cx, float cy, float angle,
-    float x0, float y0, float a0,
-    float x1, float y1, float a1
-) {
-  float a2 = (a0 + a1) / 2.0f;
-  float
-      x2 = x + x_radius * std::cos(a2),
-      y2 = y + y_radius * std::sin(a2);
-
-  float dist_sq =
-      ((((x0 + x1) / 2.0f) - x2) * (((x0 + x1) / 2.0f) - x2)) +
-      ((((y0 + y1) / 2.0f) - y2) * (((y0 + y1) / 2.0f) - y2));
-  if (dist_sq > 2.0f) {
-    add_oval_alpha_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x2, y2, a2);
-    push_vertex(vertices, indices, base, x2, y2, z, r, g, b, a, cx, cy, angle);
-    add_oval_alpha_recurse_(vertices, indices, base, x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x2, y2, a2, x1, y1, a1);
-  } else
-    push_vertex(vertices, indices, base, x2, y2, z, r, g, b, a, cx, cy, angle);
+void LinedBatch::copy_indices_(std::span<const unsigned int> src, std::span<unsigned int> dst, unsigned int base) {
+  for (std::size_t i = 0; i < src.size(); ++i)
+    dst[i] = src[i] == RESTART_INDEX ? RESTART_INDEX : src[i] + base;
 }
 
 } // namespace baphomet::gl
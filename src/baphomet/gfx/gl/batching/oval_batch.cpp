@@ -2,256 +2,183 @@
 
 namespace baphomet::gl {
 
-OvalBatch::OvalBatch() : Batch(10, BatchType::oval) {
+OvalBatch::OvalBatch() : InstancedBatch(
+  VertexLayout().floats(4).floats(1).color().floats(4).floats(1),
+  BatchType::oval, {
+    -1.0f, -1.0f,
+     1.0f, -1.0f,
+     1.0f,  1.0f,
+    -1.0f, -1.0f,
+     1.0f,  1.0f,
+    -1.0f,  1.0f
+  }
+) {
   shader_ = ShaderBuilder("OvalBatch")
             .vert_from_src(R"glsl(
 #version 330 core
-layout (location = 0) in vec3 in_pos;
-layout (location = 1) in vec4 in_color;
-layout (location = 2) in vec3 in_trans;
+layout (location = 0) in vec2 in_corner;
+layout (location = 1) in vec4 in_oval;
+layout (location = 2) in float in_z;
+layout (location = 3) in vec4 in_color;
+layout (location = 4) in vec4 in_rot;
+layout (location = 5) in float in_line_width;
 
 out vec4 out_color;
+out vec2 out_local;
+flat out vec2 out_radii;
+flat out float out_line_width;
 
-uniform float z_max;
-uniform mat4 projection;
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  float z_max;
+};
 
 void main() {
-  float c = cos(in_trans.z);
-  float s = sin(in_trans.z);
-  float x = in_trans.x;
-  float y = in_trans.y;
-  float m30 = -x * c + y * s + x;
-  float m31 = -x * s - y * c + y;
-  mat4 trans = mat4(
-    vec4(c,   s,   0.0, 0.0),
-    vec4(-s,  c,   0.0, 0.0),
-    vec4(0.0, 0.0, 1.0, 0.0),
-    vec4(m30, m31, 0.0, 1.0)
-  );
+  // Enough margin around the oval for the antialiased edge and half the
+  // outline width
+  vec2 local = in_corner * (in_oval.zw + 1.0 + 0.5 * in_line_width);
+
+  vec2 d = in_oval.xy + local - in_rot.xy;
+  vec2 pos = vec2(d.x * in_rot.w - d.y * in_rot.z, d.x * in_rot.z + d.y * in_rot.w) + in_rot.xy;
+
+  float z = -(z_max - in_z) / (z_max + 1.0);
+  gl_Position = projection * vec4(pos, z, 1.0);
 
-  float z = -(z_max - in_pos.z) / (z_max + 1.0);
-  gl_Position = projection * trans * vec4(in_pos.xy, z, 1.0);
   out_color = in_color;
+  out_local = local;
+  out_radii = max(in_oval.zw, vec2(0.5));
+  out_line_width = in_line_width;
 }
     )glsl")
             .frag_from_src(R"glsl(
 #version 330 core
 in vec4 out_color;
+in vec2 out_local;
+flat in vec2 out_radii;
+flat in float out_line_width;
 
 out vec4 FragColor;
 
+uniform bool opaque;
+
 void main() {
-  FragColor = vec4(out_color.xyz * out_color.a, out_color.a);
+  // |q| is 1 on the edge. Dividing by the gradient of |q| turns it into
+  // a distance in pixels, which is exact for circles and close enough
+  // for ellipses near their edge.
+  vec2 q = out_local / out_radii;
+  float len = length(q);
+  vec2 dir = len > 1e-6 ? q / len : vec2(1.0, 0.0);
+  float dist = (len - 1.0) / length(dir / out_radii);
+
+  float coverage = out_line_width > 0.0
+      ? clamp(0.5 * out_line_width + 0.5 - abs(dist), 0.0, 1.0)
+      : clamp(0.5 - dist, 0.0, 1.0);
+
+  if (opaque) {
+    if (coverage < 0.5)
+      discard;
+    coverage = 1.0;
+  } else if (coverage <= 0.0)
+    discard;
+
+  FragColor = vec4(out_color.xyz * out_color.a, out_color.a) * coverage;
 }
     )glsl")
-            .link();
+            .block("Frame", FrameBlock::BINDING)
+            .link_shared();
+
+  opaque_ = shader_->uniform<bool>("opaque");
 }
 
 void OvalBatch::add(
   float x, float y,
   float x_radius, float y_radius,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (a < 1.0f)
-    add_alpha_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle);
+  if (rgba8_alpha(color) < 255)
+    add_alpha_(x, y, x_radius, y_radius, 0.0f, z, color, cx, cy, angle);
   else
-    add_opaque_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle);
+    add_opaque_(x, y, x_radius, y_radius, 0.0f, z, color, cx, cy, angle);
 }
 
-void OvalBatch::draw_opaque(float z_max, glm::mat4 projection) {
-  if (!empty_opaque()) {
-    opaque_vertices_->sync();
+void OvalBatch::add_outline(
+  float x, float y,
+  float x_radius, float y_radius,
+  float line_width,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  if (rgba8_alpha(color) < 255)
+    add_alpha_(x, y, x_radius, y_radius, line_width, z, color, cx, cy, angle);
+  else
+    add_opaque_(x, y, x_radius, y_radius, line_width, z, color, cx, cy, angle);
+}
 
+void OvalBatch::draw_opaque() {
+  if (!empty_opaque()) {
     shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
-
-    opaque_vao_->draw_arrays(
-      DrawMode::triangles,
-      opaque_vertices_->front() / floats_per_vertex_,
-      opaque_vertices_->size() / floats_per_vertex_
-    );
+    opaque_.set(true);
+    InstancedBatch::draw_opaque();
   }
 }
 
-void OvalBatch::draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) {
+void OvalBatch::draw_alpha(std::span<const DrawRange> ranges) {
   if (!empty_alpha()) {
-    alpha_vertices_->sync();
-
     shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
-
-    alpha_vao_->draw_arrays(
-      DrawMode::triangles,
-      first / floats_per_vertex_,
-      count / floats_per_vertex_
-    );
+    opaque_.set(false);
+    InstancedBatch::draw_alpha(ranges);
   }
 }
 
 void OvalBatch::add_opaque_(
   float x, float y,
   float x_radius, float y_radius,
+  float line_width,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (!opaque_vertices_) {
-    opaque_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_ * 12, true, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
-
-    opaque_vao_ = std::make_unique<VertexArray>();
-    opaque_vao_->attrib_pointer(opaque_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 10, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 3},
-      {2, 3, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 7}
-    });
-  }
-
-  static float
-    a0 = 0.0f,
-    a1 = glm::radians(90.0f),
-    a2 = glm::radians(180.0f),
-    a3 = glm::radians(270.0f),
-    a4 = glm::radians(360.0f);
-
-  float
-    x0 = x + x_radius * std::cos(a0),
-    y0 = y + y_radius * std::sin(a0),
-    x1 = x + x_radius * std::cos(a1),
-    y1 = y + y_radius * std::sin(a1),
-    x2 = x + x_radius * std::cos(a2),
-    y2 = y + y_radius * std::sin(a2),
-    x3 = x + x_radius * std::cos(a3),
-    y3 = y + y_radius * std::sin(a3);
+  if (!opaque_vertices_)
+    init_opaque_();
 
-  opaque_vertices_->add({
-    x0, y0, z, r, g, b, a, cx, cy, angle,
-    x1, y1, z, r, g, b, a, cx, cy, angle,
-    x2, y2, z, r, g, b, a, cx, cy, angle,
-
-    x0, y0, z, r, g, b, a, cx, cy, angle,
-    x2, y2, z, r, g, b, a, cx, cy, angle,
-    x3, y3, z, r, g, b, a, cx, cy, angle
-  });
-
-  add_opaque_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x1, y1, a1);
-  add_opaque_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x1, y1, a1, x2, y2, a2);
-  add_opaque_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x2, y2, a2, x3, y3, a3);
-  add_opaque_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x3, y3, a3, x0, y0, a4);
-}
-
-void OvalBatch::add_opaque_recurse_(
-  float x, float y,
-  float x_radius, float y_radius,
-  float z,
-  float r, float g, float b, float a,
-  float cx, float cy, float angle,
-  float x0, float y0, float a0,
-  float x1, float y1, float a1
-) {
-  float a2 = (a0 + a1) / 2.0f;
-  float
-    x2 = x + x_radius * std::cos(a2),
-    y2 = y + y_radius * std::sin(a2);
-
-  opaque_vertices_->add({
-    x0, y0, z, r, g, b, a, cx, cy, angle,
-    x2, y2, z, r, g, b, a, cx, cy, angle,
-    x1, y1, z, r, g, b, a, cx, cy, angle
-  });
-
-  float dist_sq =
-    ((((x0 + x1) / 2.0f) - x2) * (((x0 + x1) / 2.0f) - x2)) +
-    ((((y0 + y1) / 2.0f) - y2) * (((y0 + y1) / 2.0f) - y2));
-  if (dist_sq > 2.0f) {
-    add_opaque_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x2, y2, a2);
-    add_opaque_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x1, y1, a1, x2, y2, a2);
-  }
+  write(opaque_vertices_->reserve_front(SLOTS), x, y, x_radius, y_radius, line_width, z, color, cx, cy, angle);
 }
 
 void OvalBatch::add_alpha_(
   float x, float y,
   float x_radius, float y_radius,
+  float line_width,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (!alpha_vertices_) {
-    alpha_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_ * 12, false, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
+  if (!alpha_vertices_)
+    init_alpha_();
 
-    alpha_vao_ = std::make_unique<VertexArray>();
-    alpha_vao_->attrib_pointer(alpha_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 10, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 3},
-      {2, 3, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 7}
-    });
-  }
-
-  static float
-    a0 = 0.0f,
-    a1 = glm::radians(90.0f),
-    a2 = glm::radians(180.0f),
-    a3 = glm::radians(270.0f),
-    a4 = glm::radians(360.0f);
-
-  float
-    x0 = x + x_radius * std::cos(a0),
-    y0 = y + y_radius * std::sin(a0),
-    x1 = x + x_radius * std::cos(a1),
-    y1 = y + y_radius * std::sin(a1),
-    x2 = x + x_radius * std::cos(a2),
-    y2 = y + y_radius * std::sin(a2),
-    x3 = x + x_radius * std::cos(a3),
-    y3 = y + y_radius * std::sin(a3);
-
-  alpha_vertices_->add({
-    x0, y0, z, r, g, b, a, cx, cy, angle,
-    x1, y1, z, r, g, b, a, cx, cy, angle,
-    x2, y2, z, r, g, b, a, cx, cy, angle,
-
-    x0, y0, z, r, g, b, a, cx, cy, angle,
-    x2, y2, z, r, g, b, a, cx, cy, angle,
-    x3, y3, z, r, g, b, a, cx, cy, angle
-  });
-
-  add_alpha_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x1, y1, a1);
-  add_alpha_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x1, y1, a1, x2, y2, a2);
-  add_alpha_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x2, y2, a2, x3, y3, a3);
-  add_alpha_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x3, y3, a3, x0, y0, a4);
+  write(alpha_vertices_->reserve_back(SLOTS), x, y, x_radius, y_radius, line_width, z, color, cx, cy, angle);
 }
 
-void OvalBatch::add_alpha_recurse_(
+void OvalBatch::write(
+  std::span<float> dst,
   float x, float y,
   float x_radius, float y_radius,
+  float line_width,
   float z,
-  float r, float g, float b, float a,
-  float cx, float cy, float angle,
-  float x0, float y0, float a0,
-  float x1, float y1, float a1
+  std::uint32_t color,
+  float cx, float cy, float angle
 ) {
-  float a2 = (a0 + a1) / 2.0f;
-  float
-    x2 = x + x_radius * std::cos(a2),
-    y2 = y + y_radius * std::sin(a2);
-
-  alpha_vertices_->add({
-    x0, y0, z, r, g, b, a, cx, cy, angle,
-    x2, y2, z, r, g, b, a, cx, cy, angle,
-    x1, y1, z, r, g, b, a, cx, cy, angle
-  });
-
-  float dist_sq =
-    ((((x0 + x1) / 2.0f) - x2) * (((x0 + x1) / 2.0f) - x2)) +
-    ((((y0 + y1) / 2.0f) - y2) * (((y0 + y1) / 2.0f) - y2));
-  if (dist_sq > 2.0f) {
-    add_alpha_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x0, y0, a0, x2, y2, a2);
-    add_alpha_recurse_(x, y, x_radius, y_radius, z, r, g, b, a, cx, cy, angle, x1, y1, a1, x2, y2, a2);
-  }
+  Rotation rot(cx, cy, angle);
+  write_slots(dst,
+    x, y, x_radius, y_radius,
+    z,
+    rgba8_slot(color),
+    rot.cx, rot.cy, rot.s, rot.c,
+    line_width
+  );
 }
 
 } // namespace baphomet::gl
@@ -2,7 +2,7 @@
 
 namespace baphomet::gl {
 
-PixelBatch::PixelBatch() : Batch(7, BatchType::pixel) {
+PixelBatch::PixelBatch() : Batch(VertexLayout().floats(3).color(), BatchType::pixel) {
   shader_ = ShaderBuilder("PixelBatch")
             .vert_from_src(R"glsl(
 #version 330 core
@@ -11,8 +11,11 @@ layout (location = 1) in vec4 in_color;
 
 out vec4 out_color;
 
-uniform float z_max;
-uniform mat4 projection;
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  float z_max;
+};
 
 void main() {
   float z = -(z_max - in_pos.z) / (z_max + 1.0);
@@ -30,88 +33,71 @@ void main() {
   FragColor = vec4(out_color.xyz * out_color.a, out_color.a);
 }
     )glsl")
-            .link();
+            .block("Frame", FrameBlock::BINDING)
+            .link_shared();
 }
 
 void PixelBatch::add(
   float x, float y,
   float z,
-  float r, float g, float b, float a
+  std::uint32_t color
 ) {
-  if (a < 1.0f)
-    add_alpha_(x, y, z, r, g, b, a);
+  if (rgba8_alpha(color) < 255)
+    add_alpha_(x, y, z, color);
   else
-    add_opaque_(x, y, z, r, g, b, a);
+    add_opaque_(x, y, z, color);
 }
 
-void PixelBatch::draw_opaque(float z_max, glm::mat4 projection) {
+void PixelBatch::draw_opaque() {
   if (!empty_opaque()) {
-    opaque_vertices_->sync();
+    auto base = sync_vertices_(opaque_vertices_.get(), opaque_vao_.get(), layout_.definitions());
 
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
+    use_shader_();
 
     opaque_vao_->draw_arrays(
       DrawMode::points,
-      opaque_vertices_->front() / floats_per_vertex_,
+      base + opaque_vertices_->front() / floats_per_vertex_,
       opaque_vertices_->size() / floats_per_vertex_
     );
   }
 }
 
-void PixelBatch::draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) {
+void PixelBatch::draw_alpha(std::span<const DrawRange> ranges) {
   if (!empty_alpha()) {
-    alpha_vertices_->sync();
-
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
-
-    alpha_vao_->draw_arrays(
-      DrawMode::points,
-      first / floats_per_vertex_,
-      count / floats_per_vertex_
-    );
+    use_shader_();
+    draw_alpha_arrays_(DrawMode::points, ranges);
   }
 }
 
 void PixelBatch::add_opaque_(
   float x, float y,
   float z,
-  float r, float g, float b, float a
+  std::uint32_t color
 ) {
-  if (!opaque_vertices_) {
-    opaque_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_, true, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
-
-    opaque_vao_ = std::make_unique<VertexArray>();
-    opaque_vao_->attrib_pointer(opaque_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 7, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 7, sizeof(float) * 3}
-    });
-  }
+  if (!opaque_vertices_)
+    init_opaque_();
 
-  opaque_vertices_->add({x, y, z, r, g, b, a});
+  write(opaque_vertices_->reserve_front(SLOTS), x, y, z, color);
 }
 
 void PixelBatch::add_alpha_(
   float x, float y,
   float z,
-  float r, float g, float b, float a
+  std::uint32_t color
 ) {
-  if (!alpha_vertices_) {
-    alpha_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_, false, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
-
-    alpha_vao_ = std::make_unique<VertexArray>();
-    alpha_vao_->attrib_pointer(alpha_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 7, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 7, sizeof(float) * 3}
-    });
-  }
+  if (!alpha_vertices_)
+    init_alpha_();
 
-  alpha_vertices_->add({x, y, z, r, g, b, a});
+  write(alpha_vertices_->reserve_back(SLOTS), x, y, z, color);
+}
+
+void PixelBatch::write(
+  std::span<float> dst,
+  float x, float y,
+  float z,
+  std::uint32_t color
+) {
+  write_slots(dst, x, y, z, rgba8_slot(color));
 }
 
 } // namespace baphomet::gl
@@ -2,35 +2,39 @@
 
 namespace baphomet::gl {
 
-RectBatch::RectBatch() : Batch(10, BatchType::rect) {
+RectBatch::RectBatch() : InstancedBatch(
+  VertexLayout().floats(4).floats(1).color().floats(4),
+  BatchType::rect, {
+    0.0f, 0.0f,
+    1.0f, 0.0f,
+    1.0f, 1.0f,
+    0.0f, 0.0f,
+    1.0f, 1.0f,
+    0.0f, 1.0f
+  }) {
   shader_ = ShaderBuilder("RectBatch")
             .vert_from_src(R"glsl(
 #version 330 core
-layout (location = 0) in vec3 in_pos;
-layout (location = 1) in vec4 in_color;
-layout (location = 2) in vec3 in_trans;
+layout (location = 0) in vec2 in_corner;
+layout (location = 1) in vec4 in_rect;
+layout (location = 2) in float in_z;
+layout (location = 3) in vec4 in_color;
+layout (location = 4) in vec4 in_rot;
 
 out vec4 out_color;
 
-uniform float z_max;
-uniform mat4 projection;
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  float z_max;
+};
 
 void main() {
-  float c = cos(in_trans.z);
-  float s = sin(in_trans.z);
-  float x = in_trans.x;
-  float y = in_trans.y;
-  float m30 = -x * c + y * s + x;
-  float m31 = -x * s - y * c + y;
-  mat4 trans = mat4(
-    vec4(c,   s,   0.0, 0.0),
-    vec4(-s,  c,   0.0, 0.0),
-    vec4(0.0, 0.0, 1.0, 0.0),
-    vec4(m30, m31, 0.0, 1.0)
-  );
+  vec2 d = in_rect.xy + in_corner * in_rect.zw - in_rot.xy;
+  vec2 pos = vec2(d.x * in_rot.w - d.y * in_rot.z, d.x * in_rot.z + d.y * in_rot.w) + in_rot.xy;
 
-  float z = -(z_max - in_pos.z) / (z_max + 1.0);
-  gl_Position = projection * trans * vec4(in_pos.xy, z, 1.0);
+  float z = -(z_max - in_z) / (z_max + 1.0);
+  gl_Position = projection * vec4(pos, z, 1.0);
   out_color = in_color;
 }
     )glsl")
@@ -44,110 +48,64 @@ void main() {
   FragColor = vec4(out_color.xyz * out_color.a, out_color.a);
 }
     )glsl")
-            .link();
+            .block("Frame", FrameBlock::BINDING)
+            .link_shared();
 }
 
 void RectBatch::add(
   float x, float y,
   float w, float h,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (a < 1.0f)
-    add_alpha_(x, y, w, h, z, r, g, b, a, cx, cy, angle);
+  if (rgba8_alpha(color) < 255)
+    add_alpha_(x, y, w, h, z, color, cx, cy, angle);
   else
-    add_opaque_(x, y, w, h, z, r, g, b, a, cx, cy, angle);
-}
-
-void RectBatch::draw_opaque(float z_max, glm::mat4 projection) {
-  if (!empty_opaque()) {
-    opaque_vertices_->sync();
-
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
-
-    opaque_vao_->draw_arrays(
-      DrawMode::triangles,
-      opaque_vertices_->front() / floats_per_vertex_,
-      opaque_vertices_->size() / floats_per_vertex_
-    );
-  }
-}
-
-void RectBatch::draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) {
-  if (!empty_alpha()) {
-    alpha_vertices_->sync();
-
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
-
-    alpha_vao_->draw_arrays(
-      DrawMode::triangles,
-      first / floats_per_vertex_,
-      count / floats_per_vertex_
-    );
-  }
+    add_opaque_(x, y, w, h, z, color, cx, cy, angle);
 }
 
 void RectBatch::add_opaque_(
   float x, float y,
   float w, float h,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (!opaque_vertices_) {
-    opaque_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_ * 6, true, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
+  if (!opaque_vertices_)
+    init_opaque_();
 
-    opaque_vao_ = std::make_unique<VertexArray>();
-    opaque_vao_->attrib_pointer(opaque_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 10, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 3},
-      {2, 3, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 7}
-    });
-  }
-
-  opaque_vertices_->add({
-    x,     y,     z, r, g, b, a, cx, cy, angle,
-    x + w, y,     z, r, g, b, a, cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, cx, cy, angle,
-    x,     y,     z, r, g, b, a, cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, cx, cy, angle,
-    x,     y + h, z, r, g, b, a, cx, cy, angle
-  });
+  write(opaque_vertices_->reserve_front(SLOTS), x, y, w, h, z, color, cx, cy, angle);
 }
 
 void RectBatch::add_alpha_(
   float x, float y,
   float w, float h,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (!alpha_vertices_) {
-    alpha_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_ * 6, false, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
+  if (!alpha_vertices_)
+    init_alpha_();
 
-    alpha_vao_ = std::make_unique<VertexArray>();
-    alpha_vao_->attrib_pointer(alpha_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 10, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 3},
-      {2, 3, gl::AttrType::float_t, false, sizeof(float) * 10, sizeof(float) * 7}
-    });
-  }
+  write(alpha_vertices_->reserve_back(SLOTS), x, y, w, h, z, color, cx, cy, angle);
+}
 
-  alpha_vertices_->add({
-    x,     y,     z, r, g, b, a, cx, cy, angle,
-    x + w, y,     z, r, g, b, a, cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, cx, cy, angle,
-    x,     y,     z, r, g, b, a, cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, cx, cy, angle,
-    x,     y + h, z, r, g, b, a, cx, cy, angle
-  });
+void RectBatch::write(
+  std::span<float> dst,
+  float x, float y,
+  float w, float h,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  Rotation rot(cx, cy, angle);
+  write_slots(dst,
+    x, y, w, h,
+    z,
+    rgba8_slot(color),
+    rot.cx, rot.cy, rot.s, rot.c
+  );
 }
 
 } // namespace baphomet::gl
@@ -0,0 +1,154 @@
+#include "baphomet/gfx/gl/batching/sprite_batch.hpp"
+
+namespace baphomet::gl {
+
+SpriteBatch::SpriteBatch(std::shared_ptr<TextureArray> pages)
+    : InstancedBatch(
+        VertexLayout().floats(4).floats(1).color().floats(4).floats(1).floats(4),
+        BatchType::sprite, {
+          0.0f, 0.0f,
+          1.0f, 0.0f,
+          1.0f, 1.0f,
+          0.0f, 0.0f,
+          1.0f, 1.0f,
+          0.0f, 1.0f
+        }), pages_(std::move(pages)) {
+
+  shader_ = ShaderBuilder("SpriteBatch")
+            .vert_from_src(R"glsl(
+#version 330 core
+layout (location = 0) in vec2 in_corner;
+layout (location = 1) in vec4 in_rect;
+layout (location = 2) in float in_z;
+layout (location = 3) in vec4 in_color;
+layout (location = 4) in vec4 in_tex_rect;
+layout (location = 5) in float in_layer;
+layout (location = 6) in vec4 in_rot;
+
+out vec4 out_color;
+out vec3 out_tex_coords;
+
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  float z_max;
+};
+
+void main() {
+  vec2 d = in_rect.xy + in_corner * in_rect.zw - in_rot.xy;
+  vec2 pos = vec2(d.x * in_rot.w - d.y * in_rot.z, d.x * in_rot.z + d.y * in_rot.w) + in_rot.xy;
+
+  float z = -(z_max - in_z) / (z_max + 1.0);
+  gl_Position = projection * vec4(pos, z, 1.0);
+
+  out_color = in_color;
+  out_tex_coords = vec3(in_tex_rect.xy + in_corner * in_tex_rect.zw, in_layer);
+}
+    )glsl")
+            .frag_from_src(R"glsl(
+#version 330 core
+in vec4 out_color;
+in vec3 out_tex_coords;
+
+out vec4 FragColor;
+
+uniform sampler2DArray tex;
+
+void main() {
+  FragColor = vec4(out_color.xyz * out_color.a, out_color.a) * texture(tex, out_tex_coords);
+}
+    )glsl")
+            .block("Frame", FrameBlock::BINDING)
+            .link_shared();
+
+}
+
+void SpriteBatch::add(
+  int layer,
+  bool fully_opaque,
+  float x, float y,
+  float w, float h,
+  float tx, float ty,
+  float tw, float th,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  if (rgba8_alpha(color) < 255 || !fully_opaque)
+    add_alpha_(layer, x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
+  else
+    add_opaque_(layer, x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
+}
+
+void SpriteBatch::draw_opaque() {
+  if (!empty_opaque()) {
+    pages_->bind();
+    InstancedBatch::draw_opaque();
+  }
+}
+
+void SpriteBatch::draw_alpha(std::span<const DrawRange> ranges) {
+  if (!empty_alpha()) {
+    pages_->bind();
+    InstancedBatch::draw_alpha(ranges);
+  }
+}
+
+void SpriteBatch::add_opaque_(
+  int layer,
+  float x, float y,
+  float w, float h,
+  float tx, float ty,
+  float tw, float th,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  if (!opaque_vertices_)
+    init_opaque_();
+
+  write(opaque_vertices_->reserve_front(SLOTS), *pages_, layer, x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
+}
+
+void SpriteBatch::add_alpha_(
+  int layer,
+  float x, float y,
+  float w, float h,
+  float tx, float ty,
+  float tw, float th,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  if (!alpha_vertices_)
+    init_alpha_();
+
+  write(alpha_vertices_->reserve_back(SLOTS), *pages_, layer, x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
+}
+
+void SpriteBatch::write(
+  std::span<float> dst,
+  const TextureArray &pages,
+  int layer,
+  float x, float y,
+  float w, float h,
+  float tx, float ty,
+  float tw, float th,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  Rotation rot(cx, cy, angle);
+
+  float px_unit = 1.0f / pages.page_size();
+  write_slots(dst,
+    x, y, w, h,
+    z,
+    rgba8_slot(color),
+    px_unit * tx, px_unit * ty, px_unit * tw, px_unit * th,
+    static_cast<float>(layer),
+    rot.cx, rot.cy, rot.s, rot.c
+  );
+}
+
+} // namespace baphomet::gl
@@ -0,0 +1,75 @@
+#include "baphomet/gfx/gl/batching/static_layer_batch.hpp"
+
+#include "baphomet/gfx/gl/state_cache.hpp"
+
+namespace baphomet::gl {
+
+StaticLayerBatch::StaticLayerBatch() : Batch(VertexLayout().floats(3).color().floats(4), BatchType::static_layer) {
+  shader_ = UberBatch::make_shader();
+
+  transform_ = shader_->uniform<glm::vec4>("transform");
+  z_base_ = shader_->uniform<float>("z_base");
+}
+
+void StaticLayerBatch::clear() {
+  draws_.clear();
+}
+
+void StaticLayerBatch::add(
+  std::shared_ptr<const StaticGeometry> geometry,
+  float x, float y,
+  float scale_x, float scale_y,
+  float z
+) {
+  draws_.push_back({std::move(geometry), x, y, scale_x, scale_y, z});
+}
+
+std::size_t StaticLayerBatch::size_opaque() {
+  return 0;
+}
+
+std::size_t StaticLayerBatch::size_alpha() {
+  return draws_.size();
+}
+
+std::size_t StaticLayerBatch::vertex_count_opaque() {
+  return 0;
+}
+
+std::size_t StaticLayerBatch::vertex_count_alpha() {
+  std::size_t vertex_count{0};
+  for (const auto &d : draws_)
+    vertex_count += d.geometry->vertex_count;
+  return vertex_count;
+}
+
+void StaticLayerBatch::draw_opaque() {}
+
+void StaticLayerBatch::draw_alpha(std::span<const DrawRange> ranges) {
+  if (draws_.empty())
+    return;
+
+  use_shader_();
+
+  for (const auto &r : ranges)
+    for (auto i = r.first; i < r.first + r.count; ++i) {
+      const auto &d = draws_[i];
+      if (d.geometry->vertex_count == 0)
+        continue;
+
+      if (d.geometry->pages[1]) d.geometry->pages[1]->bind(1);
+      if (d.geometry->pages[0]) d.geometry->pages[0]->bind(0);
+      state_cache().active_texture(0);
+
+      transform_.set({d.x, d.y, d.scale_x, d.scale_y});
+      z_base_.set(d.z);
+
+      d.geometry->vao->draw_arrays(DrawMode::triangles, 0, d.geometry->vertex_count);
+    }
+
+  // The program is shared with UberBatch, which expects no transform
+  transform_.set({0.0f, 0.0f, 1.0f, 1.0f});
+  z_base_.set(0.0f);
+}
+
+} // namespace baphomet::gl
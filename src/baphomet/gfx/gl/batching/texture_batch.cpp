@@ -3,41 +3,43 @@
 namespace baphomet::gl {
 
 TextureBatch::TextureBatch(const std::shared_ptr<gl::TextureUnit> &texture_unit)
-    : Batch(12, BatchType::texture), texture_unit_(texture_unit) {
+    : InstancedBatch(instance_layout_(*texture_unit), BatchType::texture, {
+        0.0f, 0.0f,
+        1.0f, 0.0f,
+        1.0f, 1.0f,
+        0.0f, 0.0f,
+        1.0f, 1.0f,
+        0.0f, 1.0f
+      }), texture_unit_(texture_unit) {
 
   shader_ = ShaderBuilder("TextureBatch")
             .vert_from_src(R"glsl(
 #version 330 core
-layout (location = 0) in vec3 in_pos;
-layout (location = 1) in vec4 in_color;
-layout (location = 2) in vec2 in_tex_coords;
-layout (location = 3) in vec3 in_trans;
+layout (location = 0) in vec2 in_corner;
+layout (location = 1) in vec4 in_rect;
+layout (location = 2) in float in_z;
+layout (location = 3) in vec4 in_color;
+layout (location = 4) in vec4 in_tex_rect;
+layout (location = 5) in vec4 in_rot;
 
 out vec4 out_color;
 out vec2 out_tex_coords;
 
-uniform float z_max;
-uniform mat4 projection;
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  float z_max;
+};
 
 void main() {
-  float c = cos(in_trans.z);
-  float s = sin(in_trans.z);
-  float x = in_trans.x;
-  float y = in_trans.y;
-  float m30 = -x * c + y * s + x;
-  float m31 = -x * s - y * c + y;
-  mat4 trans = mat4(
-    vec4(c,   s,   0.0, 0.0),
-    vec4(-s,  c,   0.0, 0.0),
-    vec4(0.0, 0.0, 1.0, 0.0),
-    vec4(m30, m31, 0.0, 1.0)
-  );
-
-  float z = -(z_max - in_pos.z) / (z_max + 1.0);
-  gl_Position = projection * trans * vec4(in_pos.xy, z, 1.0);
+  vec2 d = in_rect.xy + in_corner * in_rect.zw - in_rot.xy;
+  vec2 pos = vec2(d.x * in_rot.w - d.y * in_rot.z, d.x * in_rot.z + d.y * in_rot.w) + in_rot.xy;
+
+  float z = -(z_max - in_z) / (z_max + 1.0);
+  gl_Position = projection * vec4(pos, z, 1.0);
 
   out_color = in_color;
-  out_tex_coords = in_tex_coords;
+  out_tex_coords = in_tex_rect.xy + in_corner * in_tex_rect.zw;
 }
     )glsl")
             .frag_from_src(R"glsl(
@@ -53,10 +55,9 @@ void main() {
   FragColor = vec4(out_color.xyz * out_color.a, out_color.a) * texture(tex, out_tex_coords);
 }
     )glsl")
-            .link();
+            .block("Frame", FrameBlock::BINDING)
+            .link_shared();
 
-  x_px_unit_ = 1.0f / texture_unit_->width();
-  y_px_unit_ = 1.0f / texture_unit_->height();
 }
 
 bool TextureBatch::fully_opaque() {
@@ -69,46 +70,26 @@ void TextureBatch::add(
   float tx, float ty,
   float tw, float th,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (a < 1.0f || !fully_opaque())
-    add_alpha_(x, y, w, h, tx, ty, tw, th, z, r, g, b, a, cx, cy, angle);
+  if (rgba8_alpha(color) < 255 || !fully_opaque())
+    add_alpha_(x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
   else
-    add_opaque_(x, y, w, h, tx, ty, tw, th, z, r, g, b, a, cx, cy, angle);
+    add_opaque_(x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
 }
 
-void TextureBatch::draw_opaque(float z_max, glm::mat4 projection) {
+void TextureBatch::draw_opaque() {
   if (!empty_opaque()) {
-    opaque_vertices_->sync();
-
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
     texture_unit_->bind();
-
-    opaque_vao_->draw_arrays(
-      DrawMode::triangles,
-      opaque_vertices_->front() / floats_per_vertex_,
-      opaque_vertices_->size() / floats_per_vertex_
-    );
+    InstancedBatch::draw_opaque();
   }
 }
 
-void TextureBatch::draw_alpha(float z_max, glm::mat4 projection, GLint first, GLsizei count) {
+void TextureBatch::draw_alpha(std::span<const DrawRange> ranges) {
   if (!empty_alpha()) {
-    alpha_vertices_->sync();
-
-    shader_->use();
-    shader_->uniform_1f("z_max", z_max);
-    shader_->uniform_mat4f("projection", projection);
     texture_unit_->bind();
-
-    alpha_vao_->draw_arrays(
-      DrawMode::triangles,
-      first / floats_per_vertex_,
-      count / floats_per_vertex_
-    );
+    InstancedBatch::draw_alpha(ranges);
   }
 }
 
@@ -118,30 +99,13 @@ void TextureBatch::add_opaque_(
   float tx, float ty,
   float tw, float th,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (!opaque_vertices_) {
-    opaque_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_ * 6, true, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
-
-    opaque_vao_ = std::make_unique<VertexArray>();
-    opaque_vao_->attrib_pointer(opaque_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 12, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 3},
-      {2, 2, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 7},
-      {3, 3, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 9}
-    });
-  }
+  if (!opaque_vertices_)
+    init_opaque_();
 
-  opaque_vertices_->add({
-    x,     y,     z, r, g, b, a, x_px_unit_ * tx,        y_px_unit_ * ty,        cx, cy, angle,
-    x + w, y,     z, r, g, b, a, x_px_unit_ * (tx + tw), y_px_unit_ * ty,        cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, x_px_unit_ * (tx + tw), y_px_unit_ * (ty + th), cx, cy, angle,
-    x,     y,     z, r, g, b, a, x_px_unit_ * tx,        y_px_unit_ * ty,        cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, x_px_unit_ * (tx + tw), y_px_unit_ * (ty + th), cx, cy, angle,
-    x,     y + h, z, r, g, b, a, x_px_unit_ * tx,        y_px_unit_ * (ty + th), cx, cy, angle
-  });
+  write(opaque_vertices_->reserve_front(floats_per_vertex_), *texture_unit_, x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
 }
 
 void TextureBatch::add_alpha_(
@@ -150,30 +114,66 @@ void TextureBatch::add_alpha_(
   float tx, float ty,
   float tw, float th,
   float z,
-  float r, float g, float b, float a,
+  std::uint32_t color,
   float cx, float cy, float angle
 ) {
-  if (!alpha_vertices_) {
-    alpha_vertices_ = std::make_unique<VecBuffer<float>>(
-      floats_per_vertex_ * 6, false, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
-
-    alpha_vao_ = std::make_unique<VertexArray>();
-    alpha_vao_->attrib_pointer(alpha_vertices_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 12, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 3},
-      {2, 2, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 7},
-      {3, 3, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 9}
-    });
-  }
+  if (!alpha_vertices_)
+    init_alpha_();
+
+  write(alpha_vertices_->reserve_back(floats_per_vertex_), *texture_unit_, x, y, w, h, tx, ty, tw, th, z, color, cx, cy, angle);
+}
+
+std::size_t TextureBatch::slots(const TextureUnit &texture_unit) {
+  return instance_layout_(texture_unit).slots();
+}
+
+void TextureBatch::write(
+  std::span<float> dst,
+  const TextureUnit &texture_unit,
+  float x, float y,
+  float w, float h,
+  float tx, float ty,
+  float tw, float th,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  Rotation rot(cx, cy, angle);
+
+  float x_px_unit = 1.0f / texture_unit.width(), y_px_unit = 1.0f / texture_unit.height();
+  float u = x_px_unit * tx, v = y_px_unit * ty;
+  float uw = x_px_unit * tw, vh = y_px_unit * th;
+
+  if (half_uvs_exact_(texture_unit))
+    write_slots(dst,
+      x, y, w, h,
+      z,
+      rgba8_slot(color),
+      half2_slot(u, v), half2_slot(uw, vh),
+      rot.cx, rot.cy, rot.s, rot.c
+    );
+  else
+    write_slots(dst,
+      x, y, w, h,
+      z,
+      rgba8_slot(color),
+      u, v, uw, vh,
+      rot.cx, rot.cy, rot.s, rot.c
+    );
+}
+
+VertexLayout TextureBatch::instance_layout_(const TextureUnit &texture_unit) {
+  auto layout = VertexLayout().floats(4).floats(1).color();
+  if (half_uvs_exact_(texture_unit))
+    layout.half_floats(4);
+  else
+    layout.floats(4);
+  return layout.floats(4);
+}
 
-  alpha_vertices_->add({
-    x,     y,     z, r, g, b, a, x_px_unit_ * tx,        y_px_unit_ * ty,        cx, cy, angle,
-    x + w, y,     z, r, g, b, a, x_px_unit_ * (tx + tw), y_px_unit_ * ty,        cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, x_px_unit_ * (tx + tw), y_px_unit_ * (ty + th), cx, cy, angle,
-    x,     y,     z, r, g, b, a, x_px_unit_ * tx,        y_px_unit_ * ty,        cx, cy, angle,
-    x + w, y + h, z, r, g, b, a, x_px_unit_ * (tx + tw), y_px_unit_ * (ty + th), cx, cy, angle,
-    x,     y + h, z, r, g, b, a, x_px_unit_ * tx,        y_px_unit_ * (ty + th), cx, cy, angle
-  });
+bool TextureBatch::half_uvs_exact_(const TextureUnit &texture_unit) {
+  auto exact = [](GLuint v) { return v > 0 && v <= 2048 && (v & (v - 1)) == 0; };
+  return exact(texture_unit.width()) && exact(texture_unit.height());
 }
 
 } // namespace baphomet::gl
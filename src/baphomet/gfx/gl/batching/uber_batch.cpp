@@ -0,0 +1,410 @@
+#include "baphomet/gfx/gl/batching/uber_batch.hpp"
+
+#include "baphomet/gfx/gl/state_cache.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace baphomet::gl {
+
+UberBatch::UberBatch() : Batch(VertexLayout().floats(3).color().floats(4), BatchType::uber) {
+  shader_ = make_shader();
+}
+
+std::shared_ptr<Shader> UberBatch::make_shader() {
+  auto shader = ShaderBuilder("UberBatch")
+            .vert_from_src(R"glsl(
+#version 330 core
+layout (location = 0) in vec3 in_pos;
+layout (location = 1) in vec4 in_color;
+layout (location = 2) in vec4 in_uv_mode;
+
+out vec4 out_color;
+out vec2 out_uv;
+flat out int out_mode;
+flat out float out_layer;
+
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  float z_max;
+};
+
+// Offset (xy) and scale (zw), and a z added to every vertex, for static layers
+uniform vec4 transform;
+uniform float z_base;
+
+void main() {
+  vec2 pos = in_pos.xy * transform.zw + transform.xy;
+
+  float z = -(z_max - (in_pos.z + z_base)) / (z_max + 1.0);
+  gl_Position = projection * vec4(pos, z, 1.0);
+
+  out_color = in_color;
+  out_uv = in_uv_mode.xy;
+  out_mode = int(in_uv_mode.z + 0.5);
+  out_layer = in_uv_mode.w;
+}
+    )glsl")
+            .frag_from_src(R"glsl(
+#version 330 core
+in vec4 out_color;
+in vec2 out_uv;
+flat in int out_mode;
+flat in float out_layer;
+
+out vec4 FragColor;
+
+uniform sampler2DArray pages_0;
+uniform sampler2DArray pages_1;
+
+void main() {
+  // Derivatives have to be taken outside of the branches below
+  float d = length(out_uv);
+  float aa = max(fwidth(d), 1e-5);
+
+  vec4 color = vec4(out_color.xyz * out_color.a, out_color.a);
+
+  if (out_mode == 1)
+    color *= textureLod(pages_0, vec3(out_uv, out_layer), 0.0);
+  else if (out_mode == 2)
+    color *= textureLod(pages_1, vec3(out_uv, out_layer), 0.0);
+  else if (out_mode == 3)
+    color *= clamp((1.0 - d) / aa + 0.5, 0.0, 1.0);
+  else if (out_mode == 4)
+    color *= clamp(1.0 - abs(d - 1.0) / aa, 0.0, 1.0);
+
+  FragColor = color;
+}
+    )glsl")
+            .block("Frame", FrameBlock::BINDING)
+            .link_shared();
+
+  shader->use();
+  shader->uniform_1i("pages_0", 0);
+  shader->uniform_1i("pages_1", 1);
+  shader->uniform_4f("transform", {0.0f, 0.0f, 1.0f, 1.0f});
+  shader->uniform_1f("z_base", 0.0f);
+
+  return shader;
+}
+
+void UberBatch::clear() {
+  Batch::clear();
+  pages_ = {};
+}
+
+bool UberBatch::accepts(const std::shared_ptr<TextureArray> &pages) const {
+  return pages_[0] == pages || pages_[1] == pages || !pages_[0] || !pages_[1];
+}
+
+void UberBatch::add_pixel(
+  float x, float y,
+  float z,
+  std::uint32_t color
+) {
+  add_quad_({{
+    {x - 0.5f, y - 0.5f, 0.0f, 0.0f},
+    {x + 0.5f, y - 0.5f, 0.0f, 0.0f},
+    {x + 0.5f, y + 0.5f, 0.0f, 0.0f},
+    {x - 0.5f, y + 0.5f, 0.0f, 0.0f}
+  }}, z, color, Mode_::solid, 0.0f);
+}
+
+void UberBatch::add_line(
+  float x0, float y0,
+  float x1, float y1,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  Rotation rot(cx, cy, angle);
+  rot.apply(x0, y0);
+  rot.apply(x1, y1);
+
+  add_line_quad_(x0, y0, x1, y1, 0.5f, 0.5f, z, color);
+}
+
+void UberBatch::add_tri(
+  float x0, float y0,
+  float x1, float y1,
+  float x2, float y2,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  Rotation rot(cx, cy, angle);
+  rot.apply(x0, y0);
+  rot.apply(x1, y1);
+  rot.apply(x2, y2);
+
+  add_tri_({x0, y0, 0.0f, 0.0f}, {x1, y1, 0.0f, 0.0f}, {x2, y2, 0.0f, 0.0f}, z, color, Mode_::solid, 0.0f);
+}
+
+void UberBatch::add_rect(
+  float x, float y,
+  float w, float h,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  std::array<Corner_, 4> corners{{
+    {x,     y,     0.0f, 0.0f},
+    {x + w, y,     0.0f, 0.0f},
+    {x + w, y + h, 0.0f, 0.0f},
+    {x,     y + h, 0.0f, 0.0f}
+  }};
+
+  Rotation rot(cx, cy, angle);
+  for (auto &c : corners)
+    rot.apply(c.x, c.y);
+
+  add_quad_(corners, z, color, Mode_::solid, 0.0f);
+}
+
+void UberBatch::add_oval(
+  float x, float y,
+  float x_radius, float y_radius,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  add_ellipse_(x, y, x_radius, y_radius, z, color, cx, cy, angle, Mode_::oval);
+}
+
+void UberBatch::add_sprite(
+  const std::shared_ptr<TextureArray> &pages,
+  int layer,
+  float x, float y,
+  float w, float h,
+  float tx, float ty,
+  float tw, float th,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  std::size_t slot = 0;
+  if (pages_[0] && pages_[0] != pages)
+    slot = 1;
+
+  if (pages_[slot] && pages_[slot] != pages) {
+    spdlog::error("UberBatch can only draw from two texture arrays at once");
+    return;
+  }
+  pages_[slot] = pages;
+
+  auto px_unit = 1.0f / pages->page_size();
+  auto u0 = px_unit * tx, v0 = px_unit * ty;
+  auto u1 = px_unit * (tx + tw), v1 = px_unit * (ty + th);
+
+  std::array<Corner_, 4> corners{{
+    {x,     y,     u0, v0},
+    {x + w, y,     u1, v0},
+    {x + w, y + h, u1, v1},
+    {x,     y + h, u0, v1}
+  }};
+
+  Rotation rot(cx, cy, angle);
+  for (auto &c : corners)
+    rot.apply(c.x, c.y);
+
+  add_quad_(corners, z, color, slot == 0 ? Mode_::pages_0 : Mode_::pages_1, static_cast<float>(layer));
+}
+
+void UberBatch::add_lined_tri(
+  float x0, float y0,
+  float x1, float y1,
+  float x2, float y2,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  Rotation rot(cx, cy, angle);
+  rot.apply(x0, y0);
+  rot.apply(x1, y1);
+  rot.apply(x2, y2);
+
+  // Each edge covers its starting corner but not its ending one, so
+  // corners aren't blended twice
+  add_line_quad_(x0, y0, x1, y1, 0.5f, -0.5f, z, color);
+  add_line_quad_(x1, y1, x2, y2, 0.5f, -0.5f, z, color);
+  add_line_quad_(x2, y2, x0, y0, 0.5f, -0.5f, z, color);
+}
+
+void UberBatch::add_lined_rect(
+  float x, float y,
+  float w, float h,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  std::array<Corner_, 4> corners{{
+    {x,     y,     0.0f, 0.0f},
+    {x + w, y,     0.0f, 0.0f},
+    {x + w, y + h, 0.0f, 0.0f},
+    {x,     y + h, 0.0f, 0.0f}
+  }};
+
+  Rotation rot(cx, cy, angle);
+  for (auto &c : corners)
+    rot.apply(c.x, c.y);
+
+  for (std::size_t i = 0; i < corners.size(); ++i) {
+    const auto &a = corners[i];
+    const auto &b = corners[(i + 1) % corners.size()];
+    add_line_quad_(a.x, a.y, b.x, b.y, 0.5f, -0.5f, z, color);
+  }
+}
+
+void UberBatch::add_lined_oval(
+  float x, float y,
+  float x_radius, float y_radius,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle
+) {
+  add_ellipse_(x, y, x_radius, y_radius, z, color, cx, cy, angle, Mode_::oval_outline);
+}
+
+std::shared_ptr<StaticGeometry> UberBatch::bake() {
+  auto geometry = std::make_shared<StaticGeometry>();
+  geometry->pages = pages_;
+
+  if (empty_alpha())
+    return geometry;
+
+  auto contents = alpha_vertices_->contents();
+  std::vector<float> vertices(contents.begin(), contents.end());
+
+  geometry->x0 = geometry->y0 = std::numeric_limits<float>::max();
+  geometry->x1 = geometry->y1 = std::numeric_limits<float>::lowest();
+  for (std::size_t i = 0; i < vertices.size(); i += floats_per_vertex_) {
+    geometry->x0 = std::min(geometry->x0, vertices[i]);
+    geometry->y0 = std::min(geometry->y0, vertices[i + 1]);
+    geometry->x1 = std::max(geometry->x1, vertices[i]);
+    geometry->y1 = std::max(geometry->y1, vertices[i + 1]);
+
+    // The whole layer takes the z of wherever it's drawn
+    vertices[i + 2] = 0.0f;
+  }
+
+  geometry->vertex_count = static_cast<GLsizei>(vertices.size() / floats_per_vertex_);
+  geometry->vertices = std::make_unique<StaticBuffer<float>>(vertices, gl::BufTarget::array, gl::BufUsage::static_draw);
+
+  geometry->vao = std::make_unique<VertexArray>();
+  geometry->vao->attrib_pointer(geometry->vertices.get(), layout_.definitions());
+
+  return geometry;
+}
+
+void UberBatch::draw_opaque() {}
+
+void UberBatch::draw_alpha(std::span<const DrawRange> ranges) {
+  if (!empty_alpha()) {
+    if (pages_[1]) pages_[1]->bind(1);
+    if (pages_[0]) pages_[0]->bind(0);
+    state_cache().active_texture(0);
+
+    use_shader_();
+    draw_alpha_arrays_(DrawMode::triangles, ranges);
+  }
+}
+
+void UberBatch::init_alpha_() {
+  alpha_vertices_ = make_vertices_(floats_per_vertex_ * 6, false);
+
+  alpha_vao_ = std::make_unique<VertexArray>();
+  alpha_vao_->attrib_pointer(alpha_vertices_.get(), layout_.definitions());
+}
+
+void UberBatch::add_tri_(const Corner_ &c0, const Corner_ &c1, const Corner_ &c2, float z, std::uint32_t color, Mode_ mode, float layer) {
+  if (!alpha_vertices_)
+    init_alpha_();
+
+  auto m = static_cast<float>(mode);
+  auto c = rgba8_slot(color);
+  write_slots(alpha_vertices_->reserve_back(floats_per_vertex_ * 3),
+    c0.x, c0.y, z, c, c0.u, c0.v, m, layer,
+    c1.x, c1.y, z, c, c1.u, c1.v, m, layer,
+    c2.x, c2.y, z, c, c2.u, c2.v, m, layer
+  );
+}
+
+void UberBatch::add_quad_(const std::array<Corner_, 4> &corners, float z, std::uint32_t color, Mode_ mode, float layer) {
+  if (!alpha_vertices_)
+    init_alpha_();
+
+  const auto &[c0, c1, c2, c3] = corners;
+  auto m = static_cast<float>(mode);
+  auto c = rgba8_slot(color);
+  write_slots(alpha_vertices_->reserve_back(floats_per_vertex_ * 6),
+    c0.x, c0.y, z, c, c0.u, c0.v, m, layer,
+    c1.x, c1.y, z, c, c1.u, c1.v, m, layer,
+    c2.x, c2.y, z, c, c2.u, c2.v, m, layer,
+    c0.x, c0.y, z, c, c0.u, c0.v, m, layer,
+    c2.x, c2.y, z, c, c2.u, c2.v, m, layer,
+    c3.x, c3.y, z, c, c3.u, c3.v, m, layer
+  );
+}
+
+void UberBatch::add_line_quad_(float x0, float y0, float x1, float y1, float extend_start, float extend_end, float z, std::uint32_t color) {
+  auto dx = x1 - x0, dy = y1 - y0;
+  auto len = std::sqrt(dx * dx + dy * dy);
+  if (len < 1e-4f) {
+    if (extend_end > 0.0f)
+      add_pixel(x0, y0, z, color);
+    return;
+  }
+  dx /= len;
+  dy /= len;
+
+  x0 -= dx * extend_start;
+  y0 -= dy * extend_start;
+  x1 += dx * extend_end;
+  y1 += dy * extend_end;
+
+  // Half a pixel either side of the line
+  auto nx = -dy * 0.5f, ny = dx * 0.5f;
+
+  add_quad_({{
+    {x0 + nx, y0 + ny, 0.0f, 0.0f},
+    {x1 + nx, y1 + ny, 0.0f, 0.0f},
+    {x1 - nx, y1 - ny, 0.0f, 0.0f},
+    {x0 - nx, y0 - ny, 0.0f, 0.0f}
+  }}, z, color, Mode_::solid, 0.0f);
+}
+
+void UberBatch::add_ellipse_(
+  float x, float y,
+  float x_radius, float y_radius,
+  float z,
+  std::uint32_t color,
+  float cx, float cy, float angle,
+  Mode_ mode
+) {
+  x_radius = std::max(x_radius, 0.5f);
+  y_radius = std::max(y_radius, 0.5f);
+
+  // A pixel of margin for the antialiased edge; uv is the position relative
+  // to the radii, so the edge is wherever its length is 1
+  auto hw = x_radius + 1.0f, hh = y_radius + 1.0f;
+  auto u = hw / x_radius, v = hh / y_radius;
+
+  std::array<Corner_, 4> corners{{
+    {x - hw, y - hh, -u, -v},
+    {x + hw, y - hh,  u, -v},
+    {x + hw, y + hh,  u,  v},
+    {x - hw, y + hh, -u,  v}
+  }};
+
+  Rotation rot(cx, cy, angle);
+  for (auto &c : corners)
+    rot.apply(c.x, c.y);
+
+  add_quad_(corners, z, color, mode, 0.0f);
+}
+
+} // namespace baphomet::gl
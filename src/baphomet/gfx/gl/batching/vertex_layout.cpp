@@ -0,0 +1,61 @@
+#include "baphomet/gfx/gl/batching/vertex_layout.hpp"
+
+#include "glm/gtc/packing.hpp"
+
+#include <cmath>
+
+namespace baphomet::gl {
+
+VertexLayout &VertexLayout::floats(GLint count) {
+  attrs_.emplace_back(Attr_{count, AttrType::float_t, false, static_cast<std::size_t>(count)});
+  slots_ += count;
+  return *this;
+}
+
+VertexLayout &VertexLayout::half_floats(GLint count) {
+  auto slots = static_cast<std::size_t>((count + 1) / 2);
+  attrs_.emplace_back(Attr_{count, AttrType::hfloat_t, false, slots});
+  slots_ += slots;
+  return *this;
+}
+
+VertexLayout &VertexLayout::color() {
+  attrs_.emplace_back(Attr_{4, AttrType::ubyte_t, true, 1});
+  slots_ += 1;
+  return *this;
+}
+
+std::size_t VertexLayout::slots() const {
+  return slots_;
+}
+
+std::vector<AttrDef> VertexLayout::definitions(GLuint first_index, GLuint divisor) const {
+  std::vector<AttrDef> defs{};
+  defs.reserve(attrs_.size());
+
+  auto stride = static_cast<GLsizei>(sizeof(float) * slots_);
+  GLsizei offset = 0;
+  GLuint index = first_index;
+  for (const auto &a : attrs_) {
+    defs.emplace_back(AttrDef{index++, a.size, a.type, a.normalized, stride, offset, divisor});
+    offset += static_cast<GLsizei>(sizeof(float) * a.slots);
+  }
+
+  return defs;
+}
+
+Rotation::Rotation(float cx, float cy, float angle) : cx(cx), cy(cy) {
+  if (angle != 0.0f) {
+    s = std::sin(angle);
+    c = std::cos(angle);
+  }
+}
+
+float half2_slot(float a, float b) {
+  std::uint32_t packed = glm::packHalf2x16({a, b});
+  if constexpr (std::endian::native == std::endian::big)
+    packed = (packed << 16) | (packed >> 16);
+  return std::bit_cast<float>(packed);
+}
+
+} // namespace baphomet::gl
@@ -1,11 +1,17 @@
 #include "baphomet/gfx/gl/buffer_base.hpp"
 
+#include "baphomet/gfx/gl/state_cache.hpp"
 #include "baphomet/util/enum_bitmask_ops.hpp"
 
 #include "spdlog/spdlog.h"
 
 namespace baphomet::gl {
 
+UploadStats &upload_stats() {
+  static UploadStats stats{};
+  return stats;
+}
+
 BufferBase::~BufferBase() {
   del_id_();
 }
@@ -24,11 +30,11 @@ BufferBase &BufferBase::operator=(BufferBase &&other) noexcept {
 }
 
 void BufferBase::bind(BufTarget target) const {
-  glBindBuffer(unwrap(target), id);
+  state_cache().bind_buffer(target, id);
 }
 
 void BufferBase::unbind(BufTarget target) const {
-  glBindBuffer(unwrap(target), 0);
+  state_cache().bind_buffer(target, 0);
 }
 
 void BufferBase::gen_id_() {
@@ -39,6 +45,7 @@ void BufferBase::gen_id_() {
 void BufferBase::del_id_() {
   if (id != 0) {
     glDeleteBuffers(1, &id);
+    state_cache().forget_buffer(id);
     spdlog::trace("Deleted buffer ({})", id);
   }
 }
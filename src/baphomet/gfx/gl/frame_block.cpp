@@ -0,0 +1,60 @@
+#include "baphomet/gfx/gl/frame_block.hpp"
+
+#include "spdlog/spdlog.h"
+
+namespace baphomet::gl {
+
+FrameBlock::FrameBlock() : BufferBase() {
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  if (alignment <= 0)
+    alignment = 256;
+
+  auto align = static_cast<std::size_t>(alignment);
+  stride_ = (sizeof(Std140_) + align - 1) / align * align;
+
+  gen_id_();
+  allocate_(INITIAL_SLOTS_);
+}
+
+void FrameBlock::begin_frame() {
+  // Orphaning hands back fresh storage, while last frame's draws keep
+  // reading the old one
+  allocate_(capacity_);
+  next_slot_ = 0;
+  written_ = false;
+}
+
+void FrameBlock::write(const glm::mat4 &projection, const glm::mat4 &view, float z_max) {
+  if (written_ && last_.z_max == z_max && last_.projection == projection && last_.view == view)
+    return;
+
+  if (next_slot_ == capacity_) {
+    // Growing orphans too, which is fine since every slot written so far
+    // was already used by the draws that needed it
+    spdlog::debug("Growing frame block to {} slots", capacity_ * 2);
+    allocate_(capacity_ * 2);
+  }
+
+  last_.projection = projection;
+  last_.view = view;
+  last_.z_max = z_max;
+  written_ = true;
+
+  auto offset = static_cast<GLintptr>(next_slot_ * stride_);
+  next_slot_++;
+
+  bind(BufTarget::uniform);
+  glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(Std140_), &last_);
+  glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, id, offset, sizeof(Std140_));
+}
+
+void FrameBlock::allocate_(std::size_t slots) {
+  capacity_ = slots;
+
+  bind(BufTarget::uniform);
+  glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(capacity_ * stride_), nullptr, GL_STREAM_DRAW);
+  unbind(BufTarget::uniform);
+}
+
+} // namespace baphomet::gl
@@ -1,5 +1,6 @@
 #include "baphomet/gfx/gl/framebuffer.hpp"
 
+#include "baphomet/gfx/gl/state_cache.hpp"
 #include "baphomet/util/enum_bitmask_ops.hpp"
 #include "baphomet/util/random.hpp"
 
@@ -45,45 +46,43 @@ Framebuffer &Framebuffer::operator=(Framebuffer &&other) noexcept {
 }
 
 void Framebuffer::bind() {
-  glBindFramebuffer(GL_FRAMEBUFFER, id);
-  glViewport(0, 0, width, height);
+  state_cache().bind_framebuffer(id);
+  state_cache().viewport(0, 0, width, height);
 }
 
 void Framebuffer::bind(FboTarget target) {
-  glBindFramebuffer(unwrap(target), id);
+  state_cache().bind_framebuffer(target, id);
 }
 
 void Framebuffer::unbind() {
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  state_cache().bind_framebuffer(0);
 }
 
 void Framebuffer::copy_to_default_framebuffer(bool retro) {
   bind(FboTarget::read);
-  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  state_cache().bind_framebuffer(FboTarget::draw, 0);
   glBlitFramebuffer(
       0, 0, width, height,
       0, 0, width, height,
       GL_COLOR_BUFFER_BIT, retro ? GL_NEAREST : GL_LINEAR
   );
-  glBindFramebuffer(unwrap(FboTarget::read), 0);
-  glBindFramebuffer(unwrap(FboTarget::draw), 0);
+  state_cache().bind_framebuffer(0);
 }
 
 void Framebuffer::copy_to_default_framebuffer(GLint window_width, GLint window_height, bool retro) {
   bind(FboTarget::read);
-  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  state_cache().bind_framebuffer(FboTarget::draw, 0);
   glBlitFramebuffer(
       0, 0, width, height,
       0, 0, window_width, window_height,
       GL_COLOR_BUFFER_BIT, retro ? GL_NEAREST : GL_LINEAR
   );
-  glBindFramebuffer(unwrap(FboTarget::read), 0);
-  glBindFramebuffer(unwrap(FboTarget::draw), 0);
+  state_cache().bind_framebuffer(0);
 }
 
 void Framebuffer::use_texture(const std::string &tex_name) {
   // TODO: error check
-  glBindTexture(GL_TEXTURE_2D, tex_attachments_[tex_name]);
+  state_cache().bind_texture(GL_TEXTURE_2D, tex_attachments_[tex_name]);
 }
 
 void Framebuffer::del_id_() {
@@ -92,19 +91,21 @@ void Framebuffer::del_id_() {
     for (auto &p: tex_attachments_) {
       spdlog::trace("FBO/Deleting texture ({} / {})", p.second, id);
       glDeleteTextures(1, &p.second);
+      state_cache().forget_texture(p.second);
     }
     for (auto &p: rbo_attachments_) {
       spdlog::trace("FBO/Deleting renderbuffer ({} / {})", p.second, id);
       glDeleteRenderbuffers(1, &p.second);
     }
     glDeleteFramebuffers(1, &id);
+    state_cache().forget_framebuffer(id);
   }
 }
 
 FramebufferBuilder::FramebufferBuilder(GLsizei width, GLsizei height)
     : width_(width), height_(height) {
   gen_id_();
-  glBindFramebuffer(GL_FRAMEBUFFER, id_);
+  state_cache().bind_framebuffer(id_);
 }
 
 FramebufferBuilder &FramebufferBuilder::texture(const std::string &tag, TexFormat internalformat, bool retro) {
@@ -112,11 +113,11 @@ FramebufferBuilder &FramebufferBuilder::texture(const std::string &tag, TexForma
   glGenTextures(1, &tex);
   spdlog::trace("FBO/Generated texture ({})", tex);
 
-  glBindTexture(GL_TEXTURE_2D, tex);
+  state_cache().bind_texture(GL_TEXTURE_2D, tex);
   glTexStorage2D(GL_TEXTURE_2D, 1, unwrap(internalformat), width_, height_);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, retro ? GL_NEAREST : GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, retro ? GL_NEAREST : GL_LINEAR);
-  glBindTexture(GL_TEXTURE_2D, 0);
+  state_cache().bind_texture(GL_TEXTURE_2D, 0);
 
   glFramebufferTexture2D(
       GL_FRAMEBUFFER,
@@ -165,7 +166,7 @@ std::unique_ptr<Framebuffer> FramebufferBuilder::check_complete() {
     spdlog::error("Framebuffer is not complete");
   else
     spdlog::trace("Completed framebuffer ({})", id_);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  state_cache().bind_framebuffer(0);
 
   auto f = std::make_unique<Framebuffer>();
   f->id = id_;
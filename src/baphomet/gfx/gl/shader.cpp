@@ -3,10 +3,15 @@
 #include "glm/gtc/type_ptr.hpp"
 #include "spdlog/spdlog.h"
 
+#include "baphomet/gfx/gl/state_cache.hpp"
+#include "baphomet/util/hash.hpp"
+#include "baphomet/util/platform.hpp"
 #include "baphomet/util/random.hpp"
 
+#include <cstdlib>
 #include <fstream>
 #include <streambuf>
+#include <system_error>
 
 namespace baphomet::gl {
 
@@ -44,112 +49,112 @@ Shader &Shader::operator=(Shader &&other) noexcept {
 }
 
 void Shader::use() {
-  glUseProgram(id);
+  state_cache().use_program(id);
 }
 
-void Shader::uniform_1f(const std::string &name, float v) {
+void Shader::uniform_1f(UniformName name, float v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform1f(loc, v);
 }
 
-void Shader::uniform_2f(const std::string &name, glm::vec2 v) {
+void Shader::uniform_2f(UniformName name, glm::vec2 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform2fv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_3f(const std::string &name, glm::vec3 v) {
+void Shader::uniform_3f(UniformName name, glm::vec3 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform3fv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_4f(const std::string &name, glm::vec4 v) {
+void Shader::uniform_4f(UniformName name, glm::vec4 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform4fv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_1d(const std::string &name, double v) {
+void Shader::uniform_1d(UniformName name, double v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform1d(loc, v);
 }
 
-void Shader::uniform_2d(const std::string &name, glm::dvec2 v) {
+void Shader::uniform_2d(UniformName name, glm::dvec2 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform2dv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_3d(const std::string &name, glm::dvec3 v) {
+void Shader::uniform_3d(UniformName name, glm::dvec3 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform3dv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_4d(const std::string &name, glm::dvec4 v) {
+void Shader::uniform_4d(UniformName name, glm::dvec4 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform4dv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_1i(const std::string &name, int v) {
+void Shader::uniform_1i(UniformName name, int v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform1i(loc, v);
 }
 
-void Shader::uniform_2i(const std::string &name, glm::ivec2 v) {
+void Shader::uniform_2i(UniformName name, glm::ivec2 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform2iv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_3i(const std::string &name, glm::ivec3 v) {
+void Shader::uniform_3i(UniformName name, glm::ivec3 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform3iv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_4i(const std::string &name, glm::ivec4 v) {
+void Shader::uniform_4i(UniformName name, glm::ivec4 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform4iv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_1ui(const std::string &name, unsigned int v) {
+void Shader::uniform_1ui(UniformName name, unsigned int v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform1ui(loc, v);
 }
 
-void Shader::uniform_2ui(const std::string &name, glm::uvec2 v) {
+void Shader::uniform_2ui(UniformName name, glm::uvec2 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform2uiv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_3ui(const std::string &name, glm::uvec3 v) {
+void Shader::uniform_3ui(UniformName name, glm::uvec3 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform3uiv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_4ui(const std::string &name, glm::uvec4 v) {
+void Shader::uniform_4ui(UniformName name, glm::uvec4 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform4uiv(loc, 1, glm::value_ptr(v));
 }
 
-void Shader::uniform_1b(const std::string &name, bool v) {
+void Shader::uniform_1b(UniformName name, bool v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniform1i(loc, v ? 1 : 0);
 }
 
-void Shader::uniform_2b(const std::string &name, glm::bvec2 v) {
+void Shader::uniform_2b(UniformName name, glm::bvec2 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1) {
     const int iv[2] = {
@@ -160,7 +165,7 @@ void Shader::uniform_2b(const std::string &name, glm::bvec2 v) {
   }
 }
 
-void Shader::uniform_3b(const std::string &name, glm::bvec3 v) {
+void Shader::uniform_3b(UniformName name, glm::bvec3 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1) {
     const int iv[3] = {
@@ -172,7 +177,7 @@ void Shader::uniform_3b(const std::string &name, glm::bvec3 v) {
   }
 }
 
-void Shader::uniform_4b(const std::string &name, glm::bvec4 v) {
+void Shader::uniform_4b(UniformName name, glm::bvec4 v) {
   int loc = get_uniform_loc_(name);
   if (loc != -1) {
     const int iv[4] = {
@@ -185,167 +190,223 @@ void Shader::uniform_4b(const std::string &name, glm::bvec4 v) {
   }
 }
 
-void Shader::uniform_mat2f(const std::string &name, glm::mat2 v, bool transpose) {
+void Shader::uniform_mat2f(UniformName name, glm::mat2 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix2fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat3f(const std::string &name, glm::mat3 v, bool transpose) {
+void Shader::uniform_mat3f(UniformName name, glm::mat3 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix3fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat4f(const std::string &name, glm::mat4 v, bool transpose) {
+void Shader::uniform_mat4f(UniformName name, glm::mat4 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix4fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat2d(const std::string &name, glm::dmat2 v, bool transpose) {
+void Shader::uniform_mat2d(UniformName name, glm::dmat2 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix2dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat3d(const std::string &name, glm::dmat3 v, bool transpose) {
+void Shader::uniform_mat3d(UniformName name, glm::dmat3 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix3dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat4d(const std::string &name, glm::dmat4 v, bool transpose) {
+void Shader::uniform_mat4d(UniformName name, glm::dmat4 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix4dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat2x3f(const std::string &name, glm::mat2x3 v, bool transpose) {
+void Shader::uniform_mat2x3f(UniformName name, glm::mat2x3 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix2x3fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat3x2f(const std::string &name, glm::mat3x2 v, bool transpose) {
+void Shader::uniform_mat3x2f(UniformName name, glm::mat3x2 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix3x2fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat2x4f(const std::string &name, glm::mat2x4 v, bool transpose) {
+void Shader::uniform_mat2x4f(UniformName name, glm::mat2x4 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix2x4fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat4x2f(const std::string &name, glm::mat4x2 v, bool transpose) {
+void Shader::uniform_mat4x2f(UniformName name, glm::mat4x2 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix4x2fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat3x4f(const std::string &name, glm::mat3x4 v, bool transpose) {
+void Shader::uniform_mat3x4f(UniformName name, glm::mat3x4 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix3x4fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat4x3f(const std::string &name, glm::mat4x3 v, bool transpose) {
+void Shader::uniform_mat4x3f(UniformName name, glm::mat4x3 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix4x3fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat2x3d(const std::string &name, glm::dmat2x3 v, bool transpose) {
+void Shader::uniform_mat2x3d(UniformName name, glm::dmat2x3 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix2x3dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat3x2d(const std::string &name, glm::dmat3x2 v, bool transpose) {
+void Shader::uniform_mat3x2d(UniformName name, glm::dmat3x2 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix3x2dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat2x4d(const std::string &name, glm::dmat2x4 v, bool transpose) {
+void Shader::uniform_mat2x4d(UniformName name, glm::dmat2x4 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix2x4dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat4x2d(const std::string &name, glm::dmat4x2 v, bool transpose) {
+void Shader::uniform_mat4x2d(UniformName name, glm::dmat4x2 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix4x2dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat3x4d(const std::string &name, glm::dmat3x4 v, bool transpose) {
+void Shader::uniform_mat3x4d(UniformName name, glm::dmat3x4 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix3x4dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::uniform_mat4x3d(const std::string &name, glm::dmat4x3 v, bool transpose) {
+void Shader::uniform_mat4x3d(UniformName name, glm::dmat4x3 v, bool transpose) {
   int loc = get_uniform_loc_(name);
   if (loc != -1)
     glUniformMatrix4x3dv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(v));
 }
 
-GLint Shader::get_attrib_loc_(const std::string &name) {
-  if (!attrib_locs_.contains(name)) {
-    GLint loc = glGetAttribLocation(id, name.c_str());
-    if (loc == -1)
-      spdlog::error("Failed to get location of attrib: '{}'", name);
-    else
-      spdlog::trace("Located attrib '{}' in shader ({} / {}) at loc {}", name, id, tag, loc);
-    attrib_locs_[name] = loc;
-  }
-  return attrib_locs_[name];
+GLint Shader::get_attrib_loc_(UniformName name) {
+  if (auto it = attrib_locs_.find(name.hash()); it != attrib_locs_.end())
+    return it->second;
+
+  GLint loc = glGetAttribLocation(id, name.c_str());
+  if (loc == -1)
+    spdlog::error("Failed to get location of attrib: '{}'", name.c_str());
+  else
+    spdlog::trace("Located attrib '{}' in shader ({} / {}) at loc {}", name.c_str(), id, tag, loc);
+  attrib_locs_[name.hash()] = loc;
+  return loc;
 }
 
-GLint Shader::get_uniform_loc_(const std::string &name) {
-  if (!uniform_locs_.contains(name)) {
-    GLint loc = glGetUniformLocation(id, name.c_str());
-    if (loc == -1)
-      spdlog::error("Failed to get location of uniform: '{}'", name);
-    else
-      spdlog::trace("Located uniform '{}' in shader ({} / {}) at loc {}", name, id, tag, loc);
-    uniform_locs_[name] = loc;
-  }
-  return uniform_locs_[name];
+GLint Shader::get_uniform_loc_(UniformName name) {
+  if (auto it = uniform_locs_.find(name.hash()); it != uniform_locs_.end())
+    return it->second;
+
+  GLint loc = glGetUniformLocation(id, name.c_str());
+  if (loc == -1)
+    spdlog::error("Failed to get location of uniform: '{}'", name.c_str());
+  else
+    spdlog::trace("Located uniform '{}' in shader ({} / {}) at loc {}", name.c_str(), id, tag, loc);
+  uniform_locs_[name.hash()] = loc;
+  return loc;
 }
 
 void Shader::del_id_() {
   if (id != 0) {
     glDeleteProgram(id);
+    state_cache().forget_program(id);
     spdlog::trace("Deleted shader ({} / {})", id, tag);
   }
 }
 
-ShaderBuilder::ShaderBuilder()
-    : ShaderBuilder(rnd::base58(11)) {}
+namespace {
+
+struct BinaryCache_ {
+  std::filesystem::path dir{};
+  bool configured{false};
+};
+
+// Somewhere only the current user can write, since whatever is found in
+// the cache gets handed to the driver. Empty if there's no such place,
+// which leaves the cache off.
+std::filesystem::path user_cache_dir_() {
+#if defined(BAPHOMET_PLATFORM_WINDOWS)
+  if (auto local = std::getenv("LOCALAPPDATA"); local && *local)
+    return local;
+#else
+  if (auto xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    return xdg;
+  if (auto home = std::getenv("HOME"); home && *home) {
+# if defined(BAPHOMET_PLATFORM_APPLE)
+    return std::filesystem::path(home) / "Library" / "Caches";
+# else
+    return std::filesystem::path(home) / ".cache";
+# endif
+  }
+#endif
+  return {};
+}
 
-ShaderBuilder::ShaderBuilder(const std::string &tag)
-    : tag_(tag) {
-  program_id_ = glCreateProgram();
+BinaryCache_ &binary_cache_() {
+  static BinaryCache_ cache{};
 
-  spdlog::trace("Generated shader ({} / {})", program_id_, tag_);
+  if (!cache.configured) {
+    cache.dir = user_cache_dir_();
+    if (!cache.dir.empty())
+      cache.dir = cache.dir / "baphomet" / "shaders";
+    cache.configured = true;
+  }
+  return cache;
 }
 
-ShaderBuilder &ShaderBuilder::vert_from_src(const std::string &src) {
-  vert_id_ = glCreateShader(GL_VERTEX_SHADER);
+bool binaries_supported_() {
+  if (!(GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary))
+    return false;
 
-  const char *src_p = src.c_str();
-  glShaderSource(vert_id_, 1, &src_p, nullptr);
-  glCompileShader(vert_id_);
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
 
-  if (check_compile_(vert_id_, GL_VERTEX_SHADER)) {
-    glAttachShader(program_id_, vert_id_);
-    spdlog::trace("Attached vertex shader ({})", tag_);
-  }
+// Binaries are only valid for the driver that made them
+std::uint64_t driver_hash_() {
+  static std::uint64_t hash = [] {
+    std::string driver{};
+    for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      auto str = reinterpret_cast<const char *>(glGetString(name));
+      driver += str ? str : "";
+      driver += '\n';
+    }
+    return hash64(driver.data(), driver.size());
+  }();
+  return hash;
+}
+
+constexpr std::uint32_t BINARY_MAGIC{0x53485042}; // "BPHS"
+
+} // namespace
 
+ShaderBuilder::ShaderBuilder()
+    : ShaderBuilder(rnd::base58(11)) {}
+
+ShaderBuilder::ShaderBuilder(const std::string &tag)
+    : tag_(tag) {}
+
+ShaderBuilder &ShaderBuilder::vert_from_src(const std::string &src) {
+  vert_src_ = src;
   return *this;
 }
 
@@ -354,17 +415,7 @@ ShaderBuilder &ShaderBuilder::vert_from_file(const std::string &path) {
 }
 
 ShaderBuilder &ShaderBuilder::frag_from_src(const std::string &src) {
-  frag_id_ = glCreateShader(GL_FRAGMENT_SHADER);
-
-  const char *src_p = src.c_str();
-  glShaderSource(frag_id_, 1, &src_p, nullptr);
-  glCompileShader(frag_id_);
-
-  if (check_compile_(frag_id_, GL_FRAGMENT_SHADER)) {
-    glAttachShader(program_id_, frag_id_);
-    spdlog::trace("Attached fragment shader ({})", tag_);
-  }
-
+  frag_src_ = src;
   return *this;
 }
 
@@ -373,45 +424,219 @@ ShaderBuilder &ShaderBuilder::frag_from_file(const std::string &path) {
 }
 
 ShaderBuilder &ShaderBuilder::varyings(const std::vector<std::string> &vs) {
-  if (!vs.empty()) {
-    std::vector<const GLchar *> cs_varyings;
-
-    // Reserve to avoid reallocation, which would invalidate the pointers
-    cs_varyings.reserve(vs.size());
-    for (const auto &v: vs)
-      cs_varyings.push_back(v.c_str());
-
-    glTransformFeedbackVaryings(
-        program_id_,
-        static_cast<GLsizei>(vs.size()),
-        &cs_varyings[0],
-        GL_INTERLEAVED_ATTRIBS
-    );
-
-    spdlog::trace("Setup varyings ({})", tag_);
-  }
+  varyings_ = vs;
+  return *this;
+}
 
+ShaderBuilder &ShaderBuilder::block(const std::string &name, GLuint binding) {
+  blocks_.emplace_back(name, binding);
   return *this;
 }
 
 std::unique_ptr<Shader> ShaderBuilder::link() {
-  glLinkProgram(program_id_);
-  if (check_link_())
-    spdlog::trace("Linked shader program ({})", tag_);
-
-  if (vert_id_ != 0)
-    glDeleteShader(vert_id_);
+  auto program_id = glCreateProgram();
+  spdlog::trace("Generated shader ({} / {})", program_id, tag_);
+
+  auto path = binary_path_(key_());
+  if (path.empty() || !load_binary_(program_id, path)) {
+    GLuint vert_id = 0, frag_id = 0;
+
+    if (!vert_src_.empty()) {
+      vert_id = compile_(GL_VERTEX_SHADER, vert_src_);
+      if (vert_id != 0) {
+        glAttachShader(program_id, vert_id);
+        spdlog::trace("Attached vertex shader ({})", tag_);
+      }
+    }
+
+    if (!frag_src_.empty()) {
+      frag_id = compile_(GL_FRAGMENT_SHADER, frag_src_);
+      if (frag_id != 0) {
+        glAttachShader(program_id, frag_id);
+        spdlog::trace("Attached fragment shader ({})", tag_);
+      }
+    }
+
+    if (!varyings_.empty()) {
+      std::vector<const GLchar *> cs_varyings;
+
+      // Reserve to avoid reallocation, which would invalidate the pointers
+      cs_varyings.reserve(varyings_.size());
+      for (const auto &v: varyings_)
+        cs_varyings.push_back(v.c_str());
+
+      glTransformFeedbackVaryings(
+          program_id,
+          static_cast<GLsizei>(varyings_.size()),
+          &cs_varyings[0],
+          GL_INTERLEAVED_ATTRIBS
+      );
+
+      spdlog::trace("Setup varyings ({})", tag_);
+    }
+
+    if (!path.empty())
+      glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glLinkProgram(program_id);
+    auto linked = check_link_(program_id);
+    if (linked)
+      spdlog::trace("Linked shader program ({})", tag_);
+
+    if (vert_id != 0)
+      glDeleteShader(vert_id);
+
+    if (frag_id != 0)
+      glDeleteShader(frag_id);
+
+    if (linked && !path.empty())
+      save_binary_(program_id, path);
+  }
 
-  if (frag_id_ != 0)
-    glDeleteShader(frag_id_);
+  // Block bindings aren't part of a program binary, so they're set either way
+  for (const auto &[name, binding] : blocks_) {
+    auto index = glGetUniformBlockIndex(program_id, name.c_str());
+    if (index == GL_INVALID_INDEX)
+      spdlog::error("Failed to find uniform block '{}' in shader program ({})", name, tag_);
+    else
+      glUniformBlockBinding(program_id, index, binding);
+  }
 
   auto s = std::make_unique<Shader>();
-  s->id = program_id_;
+  s->id = program_id;
   s->tag = tag_;
 
   return s;
 }
 
+std::shared_ptr<Shader> ShaderBuilder::link_shared() {
+  // Weak, so a program goes away along with the last user of it
+  static std::unordered_map<std::uint64_t, std::weak_ptr<Shader>> programs{};
+
+  auto key = key_();
+  if (auto it = programs.find(key); it != programs.end())
+    if (auto shader = it->second.lock()) {
+      spdlog::trace("Reusing shader program ({} / {})", shader->id, shader->tag);
+      return shader;
+    }
+
+  std::shared_ptr<Shader> shader = link();
+  programs[key] = shader;
+
+  return shader;
+}
+
+void ShaderBuilder::binary_cache(const std::filesystem::path &dir) {
+  auto &cache = binary_cache_();
+  cache.dir = dir;
+  cache.configured = true;
+}
+
+std::uint64_t ShaderBuilder::key_() const {
+  auto key = hash64(vert_src_.data(), vert_src_.size());
+  key = hash64(frag_src_.data(), frag_src_.size(), key);
+  for (const auto &v : varyings_)
+    key = hash64(v.data(), v.size(), key);
+  for (const auto &[name, binding] : blocks_) {
+    key = hash64(name.data(), name.size(), key);
+    key = hash64(&binding, sizeof(binding), key);
+  }
+  return key;
+}
+
+GLuint ShaderBuilder::compile_(GLenum type, const std::string &src) {
+  auto shader_id = glCreateShader(type);
+
+  const char *src_p = src.c_str();
+  glShaderSource(shader_id, 1, &src_p, nullptr);
+  glCompileShader(shader_id);
+
+  if (!check_compile_(shader_id, type)) {
+    glDeleteShader(shader_id);
+    return 0;
+  }
+  return shader_id;
+}
+
+bool ShaderBuilder::load_binary_(GLuint program_id, const std::filesystem::path &path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f)
+    return false;
+
+  std::uint32_t magic = 0, format = 0;
+  f.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  f.read(reinterpret_cast<char *>(&format), sizeof(format));
+
+  std::vector<char> binary((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  if (magic != BINARY_MAGIC || binary.empty())
+    return false;
+
+  glProgramBinary(program_id, format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+  // Drivers may refuse binaries they made themselves, after an update
+  // that kept the version string for example, in which case it's compiled
+  // from source as usual
+  GLint success = 0;
+  glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+  if (!success) {
+    spdlog::debug("Cached binary for shader program ({}) was rejected, compiling instead", tag_);
+    return false;
+  }
+
+  spdlog::trace("Loaded shader program ({}) from '{}'", tag_, path.string());
+  return true;
+}
+
+void ShaderBuilder::save_binary_(GLuint program_id, const std::filesystem::path &path) {
+  GLint length = 0;
+  glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program_id, length, nullptr, &format, binary.data());
+
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  if (ec) {
+    spdlog::debug("Can't create shader cache directory '{}': {}", path.parent_path().string(), ec.message());
+    return;
+  }
+
+  // Written next to the final file and moved over it, so another instance
+  // starting at the same time never reads half a binary
+  auto tmp_path = path;
+  tmp_path += "." + rnd::base58(6);
+  {
+    std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+    auto format_u32 = static_cast<std::uint32_t>(format);
+    f.write(reinterpret_cast<const char *>(&BINARY_MAGIC), sizeof(BINARY_MAGIC));
+    f.write(reinterpret_cast<const char *>(&format_u32), sizeof(format_u32));
+    f.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!f) {
+      spdlog::debug("Failed to write shader binary '{}'", tmp_path.string());
+      f.close();
+      std::filesystem::remove(tmp_path, ec);
+      return;
+    }
+  }
+
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec)
+    std::filesystem::remove(tmp_path, ec);
+  else
+    spdlog::trace("Saved shader program ({}) to '{}'", tag_, path.string());
+}
+
+std::filesystem::path ShaderBuilder::binary_path_(std::uint64_t key) const {
+  const auto &cache = binary_cache_();
+  if (cache.dir.empty() || !binaries_supported_())
+    return {};
+
+  return cache.dir / fmt::format("{:016x}.bin", hash64(&key, sizeof(key), driver_hash_()));
+}
+
 bool ShaderBuilder::check_compile_(GLuint shader_id, GLenum type) {
   static auto info_log = std::vector<char>();
   static int success;
@@ -440,16 +665,16 @@ bool ShaderBuilder::check_compile_(GLuint shader_id, GLenum type) {
   return true;
 }
 
-bool ShaderBuilder::check_link_() {
+bool ShaderBuilder::check_link_(GLuint program_id) {
   static auto info_log = std::vector<char>();
   static int success;
 
-  glGetProgramiv(program_id_, GL_LINK_STATUS, &success);
+  glGetProgramiv(program_id, GL_LINK_STATUS, &success);
   if (!success) {
     info_log.clear();
     info_log.resize(512);
     glGetProgramInfoLog(
-        program_id_,
+        program_id,
         static_cast<GLsizei>(info_log.size()),
         nullptr,
         &info_log[0]
@@ -476,4 +701,4 @@ std::string ShaderBuilder::read_file_(const std::string &path) {
   return str;
 }
 
-} // namespace baphomet::gl
\ No newline at end of file
+} // namespace baphomet::gl
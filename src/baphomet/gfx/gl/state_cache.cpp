@@ -0,0 +1,206 @@
+#include "baphomet/gfx/gl/state_cache.hpp"
+
+#include "baphomet/util/enum_bitmask_ops.hpp"
+
+namespace baphomet::gl {
+
+StateCache &state_cache() {
+  static StateCache cache{};
+  return cache;
+}
+
+void StateCache::invalidate() {
+  program_.reset();
+  vertex_array_.reset();
+  array_buffer_.reset();
+
+  active_unit_.reset();
+  textures_.fill({});
+
+  draw_fbo_.reset();
+  read_fbo_.reset();
+
+  viewport_.reset();
+
+  blend_.reset();
+  depth_test_.reset();
+  scissor_test_.reset();
+  stencil_test_.reset();
+  primitive_restart_.reset();
+  depth_mask_.reset();
+
+  blend_func_.reset();
+}
+
+void StateCache::use_program(GLuint id) {
+  if (set_(program_, id))
+    glUseProgram(id);
+}
+
+void StateCache::bind_vertex_array(GLuint id) {
+  if (set_(vertex_array_, id))
+    glBindVertexArray(id);
+}
+
+void StateCache::bind_buffer(BufTarget target, GLuint id) {
+  if (target == BufTarget::array) {
+    if (set_(array_buffer_, id))
+      glBindBuffer(GL_ARRAY_BUFFER, id);
+    return;
+  }
+
+  if (target == BufTarget::element_array)
+    bind_vertex_array(0);
+
+  glBindBuffer(unwrap(target), id);
+  stats_.issued++;
+}
+
+void StateCache::active_texture(int unit) {
+  if (set_(active_unit_, unit))
+    glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void StateCache::bind_texture(GLenum target, GLuint id) {
+  auto slot = active_unit_ ? texture_slot_(*active_unit_, target) : nullptr;
+  if (!slot) {
+    glBindTexture(target, id);
+    stats_.issued++;
+    return;
+  }
+
+  if (set_(*slot, id))
+    glBindTexture(target, id);
+}
+
+void StateCache::bind_texture(int unit, GLenum target, GLuint id) {
+  active_texture(unit);
+  bind_texture(target, id);
+}
+
+void StateCache::bind_framebuffer(FboTarget target, GLuint id) {
+  if (target == FboTarget::draw) {
+    if (set_(draw_fbo_, id))
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, id);
+  } else {
+    if (set_(read_fbo_, id))
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, id);
+  }
+}
+
+void StateCache::bind_framebuffer(GLuint id) {
+  if (draw_fbo_ == id && read_fbo_ == id) {
+    stats_.filtered++;
+    return;
+  }
+
+  draw_fbo_ = read_fbo_ = id;
+  glBindFramebuffer(GL_FRAMEBUFFER, id);
+  stats_.issued++;
+}
+
+void StateCache::viewport(GLint x, GLint y, GLsizei w, GLsizei h) {
+  if (set_(viewport_, {x, y, w, h}))
+    glViewport(x, y, w, h);
+}
+
+void StateCache::set_enabled(Capability cap, bool enabled) {
+  auto slot = capability_slot_(cap);
+  if (slot && !set_(*slot, enabled))
+    return;
+
+  if (enabled)
+    glEnable(unwrap(cap));
+  else
+    glDisable(unwrap(cap));
+
+  if (!slot)
+    stats_.issued++;
+}
+
+void StateCache::depth_mask(bool flag) {
+  if (set_(depth_mask_, flag))
+    glDepthMask(flag ? GL_TRUE : GL_FALSE);
+}
+
+void StateCache::blend_func(BlendFunc src, BlendFunc dst) {
+  blend_func(src, dst, src, dst);
+}
+
+void StateCache::blend_func(BlendFunc src_rgb, BlendFunc dst_rgb, BlendFunc src_alpha, BlendFunc dst_alpha) {
+  if (set_(blend_func_, {src_rgb, dst_rgb, src_alpha, dst_alpha}))
+    glBlendFuncSeparate(unwrap(src_rgb), unwrap(dst_rgb), unwrap(src_alpha), unwrap(dst_alpha));
+}
+
+void StateCache::forget_program(GLuint id) {
+  // A deleted program stays in use until another replaces it, and its
+  // name may be handed out again, so what's in use is no longer known
+  if (program_ == id)
+    program_.reset();
+}
+
+void StateCache::forget_vertex_array(GLuint id) {
+  if (vertex_array_ == id)
+    vertex_array_ = 0;
+}
+
+void StateCache::forget_buffer(GLuint id) {
+  if (array_buffer_ == id)
+    array_buffer_ = 0;
+}
+
+void StateCache::forget_texture(GLuint id) {
+  for (auto &t : textures_) {
+    if (t.tex_2d == id)
+      t.tex_2d = 0;
+    if (t.tex_2d_array == id)
+      t.tex_2d_array = 0;
+  }
+}
+
+void StateCache::forget_framebuffer(GLuint id) {
+  if (draw_fbo_ == id)
+    draw_fbo_ = 0;
+  if (read_fbo_ == id)
+    read_fbo_ = 0;
+}
+
+StateStats &StateCache::stats() {
+  return stats_;
+}
+
+template<typename T>
+bool StateCache::set_(std::optional<T> &current, const T &value) {
+  if (current == value) {
+    stats_.filtered++;
+    return false;
+  }
+
+  current = value;
+  stats_.issued++;
+  return true;
+}
+
+std::optional<GLuint> *StateCache::texture_slot_(int unit, GLenum target) {
+  if (unit < 0 || unit >= MAX_TEXTURE_UNITS)
+    return nullptr;
+
+  switch (target) {
+    case GL_TEXTURE_2D: return &textures_[unit].tex_2d;
+    case GL_TEXTURE_2D_ARRAY: return &textures_[unit].tex_2d_array;
+    default: return nullptr;
+  }
+}
+
+std::optional<bool> *StateCache::capability_slot_(Capability cap) {
+  switch (cap) {
+    case Capability::blend: return &blend_;
+    case Capability::depth_test: return &depth_test_;
+    case Capability::scissor_test: return &scissor_test_;
+    case Capability::stencil_test: return &stencil_test_;
+    case Capability::primitive_restart: return &primitive_restart_;
+    default: return nullptr;
+  }
+}
+
+} // namespace baphomet::gl
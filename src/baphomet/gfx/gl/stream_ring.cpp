@@ -0,0 +1,135 @@
+#include "baphomet/gfx/gl/stream_ring.hpp"
+
+#include "baphomet/gfx/gl/state_cache.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+
+namespace baphomet::gl {
+
+bool StreamRing::supported() {
+  return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+StreamRing::StreamRing(std::size_t region_size) : BufferBase(), region_size_(region_size) {
+  fences_.fill(nullptr);
+  create_storage_();
+}
+
+StreamRing::~StreamRing() {
+  destroy_storage_();
+}
+
+std::uint64_t StreamRing::frame() const {
+  return frame_;
+}
+
+std::size_t StreamRing::region_size() const {
+  return region_size_;
+}
+
+void *StreamRing::alloc(std::size_t bytes, std::size_t align, std::size_t &offset) {
+  auto region_start = region_ * region_size_;
+  auto region_end = region_start + region_size_;
+
+  // Offsets are aligned relative to the start of the buffer, so that
+  // offset / align is a valid vertex (or instance) index
+  auto aligned = ((region_start + head_ + align - 1) / align) * align;
+  if (aligned + bytes > region_end) {
+    overflow_ += bytes + align;
+    return nullptr;
+  }
+
+  head_ = aligned + bytes - region_start;
+  offset = aligned;
+  return mapped_ + aligned;
+}
+
+void StreamRing::begin_frame() {
+  if (overflow_ > 0) {
+    auto new_size = std::max(region_size_ * 2, head_ + overflow_);
+    spdlog::debug("Growing stream ring ({}): {} -> {} bytes per region", id, region_size_, new_size);
+
+    // The old buffer is deleted only once the new one exists, so the new one
+    // can't reuse its name and VAOs still pointing at it notice the change
+    wait_all_();
+    unmap_();
+
+    auto old_id = id;
+    region_size_ = new_size;
+    create_storage_();
+    glDeleteBuffers(1, &old_id);
+    state_cache().forget_buffer(old_id);
+  }
+
+  region_ = (region_ + 1) % REGION_COUNT_;
+  wait_(fences_[region_]);
+
+  head_ = 0;
+  overflow_ = 0;
+  frame_++;
+}
+
+void StreamRing::end_frame() {
+  if (fences_[region_])
+    glDeleteSync(fences_[region_]);
+  fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamRing::create_storage_() {
+  constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  auto size = static_cast<GLsizeiptr>(region_size_ * REGION_COUNT_);
+
+  gen_id_();
+  bind(BufTarget::array);
+  glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+  mapped_ = static_cast<std::byte *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+  unbind(BufTarget::array);
+
+  if (!mapped_)
+    spdlog::error("Failed to map stream ring ({})", id);
+  else
+    spdlog::debug("Created stream ring ({}): {} x {} bytes", id, REGION_COUNT_, region_size_);
+}
+
+void StreamRing::destroy_storage_() {
+  // Nothing may still be reading from the buffer when it goes away
+  wait_all_();
+  unmap_();
+
+  del_id_();
+  id = 0;
+}
+
+void StreamRing::unmap_() {
+  if (mapped_) {
+    bind(BufTarget::array);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    unbind(BufTarget::array);
+    mapped_ = nullptr;
+  }
+}
+
+void StreamRing::wait_all_() {
+  for (auto &f : fences_)
+    wait_(f);
+}
+
+void StreamRing::wait_(GLsync &fence) {
+  if (!fence)
+    return;
+
+  GLbitfield flags = 0;
+  while (true) {
+    auto result = glClientWaitSync(fence, flags, 1'000'000);
+    if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+      break;
+    flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  }
+
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+} // namespace baphomet::gl
@@ -0,0 +1,161 @@
+#include "baphomet/gfx/gl/texture_array.hpp"
+
+#include "baphomet/gfx/gl/state_cache.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace baphomet::gl {
+
+TextureArray::TextureArray(GLsizei page_size, bool retro)
+    : page_size_(page_size), retro_(retro) {
+  reallocate_(INITIAL_CAPACITY_);
+}
+
+TextureArray::~TextureArray() {
+  del_id_();
+}
+
+GLuint TextureArray::id() const {
+  return id_;
+}
+
+void TextureArray::bind(int unit) {
+  state_cache().bind_texture(unit, GL_TEXTURE_2D_ARRAY, id_);
+}
+
+void TextureArray::unbind() {
+  state_cache().bind_texture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLsizei TextureArray::page_size() const {
+  return page_size_;
+}
+
+GLsizei TextureArray::layers() const {
+  return layers_;
+}
+
+int TextureArray::add_layer() {
+  if (layers_ == capacity_) {
+    GLint max_layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+
+    if (capacity_ >= max_layers) {
+      spdlog::warn("Texture array ({}) is out of layers ({})", id_, capacity_);
+      return -1;
+    }
+    reallocate_(std::min(capacity_ * 2, static_cast<GLsizei>(max_layers)));
+  }
+
+  // Fresh storage is undefined, and filtering at the edge of a packed
+  // texture can read the space around it
+  std::vector<unsigned char> blank(static_cast<std::size_t>(page_size_) * page_size_ * 4, 0);
+  bind();
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layers_, page_size_, page_size_, 1, GL_RGBA, GL_UNSIGNED_BYTE, blank.data());
+  unbind();
+
+  return layers_++;
+}
+
+void TextureArray::write(int layer, GLsizei x, GLsizei y, const TextureUnit &texture_unit, GLsizei padding) {
+  auto w = static_cast<GLsizei>(texture_unit.width());
+  auto h = static_cast<GLsizei>(texture_unit.height());
+  if (w == 0 || h == 0)
+    return;
+
+  // Read back as RGBA, whatever the source format was
+  std::vector<std::uint32_t> pixels(static_cast<std::size_t>(w) * h);
+  state_cache().bind_texture(GL_TEXTURE_2D, texture_unit.id());
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  state_cache().bind_texture(GL_TEXTURE_2D, 0);
+
+  // Every padding texel takes the nearest texel of the texture
+  auto pw = w + padding * 2;
+  auto ph = h + padding * 2;
+  std::vector<std::uint32_t> padded(static_cast<std::size_t>(pw) * ph);
+  for (GLsizei py = 0; py < ph; ++py) {
+    auto sy = std::clamp(py - padding, 0, h - 1);
+    for (GLsizei px = 0; px < pw; ++px) {
+      auto sx = std::clamp(px - padding, 0, w - 1);
+      padded[static_cast<std::size_t>(py) * pw + px] = pixels[static_cast<std::size_t>(sy) * w + sx];
+    }
+  }
+
+  bind();
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage3D(
+      GL_TEXTURE_2D_ARRAY, 0,
+      x - padding, y - padding, layer, pw, ph, 1,
+      GL_RGBA, GL_UNSIGNED_BYTE, padded.data()
+  );
+  unbind();
+
+  spdlog::debug("Copied texture ({}) into layer {} of texture array ({}) at ({}, {})", texture_unit.id(), layer, id_, x, y);
+}
+
+void TextureArray::reallocate_(GLsizei capacity) {
+  auto old_id = id_;
+
+  glGenTextures(1, &id_);
+  bind();
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, retro_ ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, retro_ ? GL_NEAREST : GL_LINEAR);
+
+  glTexImage3D(
+      GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8,
+      page_size_, page_size_, capacity,
+      0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr
+  );
+
+  if (old_id != 0 && layers_ > 0) {
+    if (GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_copy_image)
+      glCopyImageSubData(
+          old_id, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+          id_, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+          page_size_, page_size_, layers_
+      );
+
+    else {
+      // Round trip through the CPU; the whole array comes back at once
+      std::vector<unsigned char> pixels(static_cast<std::size_t>(page_size_) * page_size_ * 4 * capacity_);
+      state_cache().bind_texture(GL_TEXTURE_2D_ARRAY, old_id);
+      glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+      state_cache().bind_texture(GL_TEXTURE_2D_ARRAY, id_);
+      glTexSubImage3D(
+          GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+          page_size_, page_size_, layers_,
+          GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()
+      );
+    }
+  }
+
+  unbind();
+
+  if (old_id != 0) {
+    glDeleteTextures(1, &old_id);
+    state_cache().forget_texture(old_id);
+    spdlog::debug("Grew texture array ({} -> {}): {} -> {} layers", old_id, id_, capacity_, capacity);
+  } else
+    spdlog::debug("Created texture array ({}): {} layers of {}x{}", id_, capacity, page_size_, page_size_);
+
+  capacity_ = capacity;
+}
+
+void TextureArray::del_id_() {
+  if (id_ != 0) {
+    glDeleteTextures(1, &id_);
+    state_cache().forget_texture(id_);
+    spdlog::trace("Deleted texture array ({})", id_);
+  }
+}
+
+} // namespace baphomet::gl
@@ -0,0 +1,68 @@
+#include "baphomet/gfx/gl/texture_atlas.hpp"
+
+#include "spdlog/spdlog.h"
+
+// imgui compiles its own static copy, so this one is kept static as well
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace baphomet::gl {
+
+struct TextureAtlas::Packer_ {
+  stbrp_context context{};
+  std::vector<stbrp_node> nodes{};
+
+  explicit Packer_(GLsizei page_size) : nodes(page_size) {
+    stbrp_init_target(&context, page_size, page_size, nodes.data(), static_cast<int>(nodes.size()));
+  }
+};
+
+TextureAtlas::TextureAtlas(GLsizei page_size, bool retro) {
+  pages_ = std::make_shared<TextureArray>(page_size, retro);
+}
+
+TextureAtlas::~TextureAtlas() = default;
+
+const std::shared_ptr<TextureArray> &TextureAtlas::pages() const {
+  return pages_;
+}
+
+std::optional<TextureAtlas::Region> TextureAtlas::add(const TextureUnit &texture_unit) {
+  auto w = static_cast<GLsizei>(texture_unit.width()) + PADDING_ * 2;
+  auto h = static_cast<GLsizei>(texture_unit.height()) + PADDING_ * 2;
+  if (w > pages_->page_size() || h > pages_->page_size())
+    return std::nullopt;
+
+  std::optional<Region> region{};
+  for (std::size_t i = 0; i < packers_.size() && !region; ++i)
+    region = pack_(static_cast<int>(i), w, h);
+
+  if (!region) {
+    auto layer = pages_->add_layer();
+    if (layer < 0)
+      return std::nullopt;
+
+    packers_.emplace_back(std::make_unique<Packer_>(pages_->page_size()));
+    region = pack_(layer, w, h);
+  }
+
+  if (region)
+    pages_->write(region->layer, region->x, region->y, texture_unit, PADDING_);
+
+  return region;
+}
+
+std::optional<TextureAtlas::Region> TextureAtlas::pack_(int layer, GLsizei w, GLsizei h) {
+  stbrp_rect rect{};
+  rect.w = w;
+  rect.h = h;
+
+  stbrp_pack_rects(&packers_[layer]->context, &rect, 1);
+  if (!rect.was_packed)
+    return std::nullopt;
+
+  return Region{layer, rect.x + PADDING_, rect.y + PADDING_};
+}
+
+} // namespace baphomet::gl
@@ -1,5 +1,7 @@
 #include "baphomet/gfx/gl/texture_unit.hpp"
 
+#include "baphomet/gfx/gl/state_cache.hpp"
+
 #include "spdlog/spdlog.h"
 #include "stb_image.h"
 
@@ -60,6 +62,23 @@ TextureUnit::TextureUnit(const std::string &path, bool retro) {
 TextureUnit::TextureUnit(const std::filesystem::path &path, bool retro)
     : TextureUnit(path.string(), retro) {}
 
+TextureUnit::TextureUnit(GLuint width, GLuint height, bool fully_opaque, bool retro)
+    : width_(width), height_(height), fully_opaque_(fully_opaque) {
+  gen_id_();
+  bind();
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, retro ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, retro ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+  spdlog::debug("Created empty texture ({}x{})", width_, height_);
+  unbind();
+}
+
 TextureUnit::~TextureUnit() {
   del_id_();
 }
@@ -94,12 +113,11 @@ GLuint TextureUnit::id() const {
 }
 
 void TextureUnit::bind(int unit) {
-  glActiveTexture(GL_TEXTURE0 + unit);
-  glBindTexture(GL_TEXTURE_2D, id_);
+  state_cache().bind_texture(unit, GL_TEXTURE_2D, id_);
 }
 
 void TextureUnit::unbind() {
-  glBindTexture(GL_TEXTURE_2D, 0);
+  state_cache().bind_texture(GL_TEXTURE_2D, 0);
 }
 
 GLuint TextureUnit::width() const {
@@ -122,6 +140,7 @@ void TextureUnit::gen_id_() {
 void TextureUnit::del_id_() {
   if (id_ != 0) {
     glDeleteTextures(1, &id_);
+    state_cache().forget_texture(id_);
     spdlog::trace("Deleted texture ({})", id_);
   }
 }
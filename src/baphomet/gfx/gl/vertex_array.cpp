@@ -1,9 +1,13 @@
 #include "baphomet/gfx/gl/vertex_array.hpp"
 
+#include "baphomet/gfx/gl/state_cache.hpp"
 #include "baphomet/util/enum_bitmask_ops.hpp"
 
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+#include <cstdint>
+
 namespace baphomet::gl {
 
 VertexArray::VertexArray() {
@@ -16,69 +20,144 @@ VertexArray::~VertexArray() {
 
 VertexArray::VertexArray(VertexArray &&other) noexcept {
   std::swap(id, other.id);
+  std::swap(attrib_buffers_, other.attrib_buffers_);
+  std::swap(instance_buffer_, other.instance_buffer_);
+  std::swap(instance_definitions_, other.instance_definitions_);
+  std::swap(instance_offset_, other.instance_offset_);
 }
 
 VertexArray &VertexArray::operator=(VertexArray &&other) noexcept {
   if (this != &other) {
     del_id_();
     std::swap(id, other.id);
+    std::swap(attrib_buffers_, other.attrib_buffers_);
+    std::swap(instance_buffer_, other.instance_buffer_);
+    std::swap(instance_definitions_, other.instance_definitions_);
+    std::swap(instance_offset_, other.instance_offset_);
   }
   return *this;
 }
 
 void VertexArray::bind() {
-  glBindVertexArray(id);
+  state_cache().bind_vertex_array(id);
 }
 
 void VertexArray::unbind() {
-  glBindVertexArray(0);
+  state_cache().bind_vertex_array(0);
 }
 
 void VertexArray::attrib_pointer(const BufferBase *buffer, const std::vector<AttrDef> &definitions) {
   bind();
   buffer->bind(BufTarget::array);
-  for (const auto &d : definitions)
+  for (const auto &d : definitions) {
     setup_enable_definition_(d);
-  buffer->unbind(BufTarget::array);
-  unbind();
+    record_definition_(buffer, d);
+  }
 }
 
 void VertexArray::attrib_pointer(const BufferBase *buffer, const AttrDef &definition) {
   bind();
   buffer->bind(BufTarget::array);
   setup_enable_definition_(definition);
-  buffer->unbind(BufTarget::array);
-  unbind();
+  record_definition_(buffer, definition);
+}
+
+void VertexArray::ensure_attrib_pointer(const BufferBase *buffer, const std::vector<AttrDef> &definitions) {
+  auto current = std::all_of(definitions.begin(), definitions.end(), [&](const auto &d) {
+    return d.index < attrib_buffers_.size() && attrib_buffers_[d.index] == buffer->id;
+  });
+
+  if (!current)
+    attrib_pointer(buffer, definitions);
 }
 
 void VertexArray::indices(const BufferBase *buffer) {
+  // Bound directly, since the state cache keeps element array binds away
+  // from whichever vertex array is bound, and this one is meant to keep it
   bind();
-  buffer->bind(BufTarget::element_array);
-  unbind();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->id);
 }
 
 void VertexArray::draw_arrays(DrawMode mode, GLint first, GLsizei count) {
   bind();
   glDrawArrays(unwrap(mode), first, count);
-  unbind();
 }
 
-void VertexArray::draw_elements(DrawMode mode, GLsizei count, GLenum type, void *indices) {
+void VertexArray::draw_arrays_instanced(DrawMode mode, GLint first, GLsizei count, GLsizei instance_count, GLuint base_instance) {
+  bind();
+  if (base_instance == 0 && instance_offset_ == 0)
+    glDrawArraysInstanced(unwrap(mode), first, count, instance_count);
+
+  else if (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_base_instance)
+    glDrawArraysInstancedBaseInstance(unwrap(mode), first, count, instance_count, base_instance);
+
+  else {
+    offset_instance_definitions_(base_instance);
+    glDrawArraysInstanced(unwrap(mode), first, count, instance_count);
+  }
+}
+
+void VertexArray::draw_elements(DrawMode mode, GLsizei count, GLenum type, void *indices, GLint base_vertex) {
+  bind();
+  if (base_vertex == 0)
+    glDrawElements(unwrap(mode), count, type, indices);
+  else
+    glDrawElementsBaseVertex(unwrap(mode), count, type, indices, base_vertex);
+}
+
+void VertexArray::multi_draw_arrays(DrawMode mode, const GLint *first, const GLsizei *count, GLsizei draw_count) {
+  bind();
+  glMultiDrawArrays(unwrap(mode), first, count, draw_count);
+}
+
+void VertexArray::multi_draw_elements(DrawMode mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei draw_count, const GLint *base_vertex) {
   bind();
-  glDrawElements(unwrap(mode), count, type, indices);
-  unbind();
+  if (base_vertex)
+    glMultiDrawElementsBaseVertex(unwrap(mode), count, type, indices, draw_count, base_vertex);
+  else
+    glMultiDrawElements(unwrap(mode), count, type, indices, draw_count);
 }
 
-void VertexArray::setup_enable_definition_(const AttrDef &definition) {
+void VertexArray::setup_enable_definition_(const AttrDef &definition, GLsizei extra_offset) {
   glVertexAttribPointer(
       definition.index,
       definition.size,
       unwrap(definition.type),
       definition.normalized ? GL_TRUE : GL_FALSE,
       definition.stride,
-      reinterpret_cast<void *>(definition.offset));
+      reinterpret_cast<void *>(static_cast<std::intptr_t>(definition.offset + extra_offset)));
   glEnableVertexAttribArray(definition.index);
-  spdlog::trace("VertexAttrib: {}, {}, {}, {}, {}, {}", definition.index, definition.size, unwrap(definition.type), definition.normalized, definition.stride, definition.offset);
+  if (definition.divisor != 0)
+    glVertexAttribDivisor(definition.index, definition.divisor);
+  spdlog::trace("VertexAttrib: {}, {}, {}, {}, {}, {}, {}", definition.index, definition.size, unwrap(definition.type), definition.normalized, definition.stride, definition.offset + extra_offset, definition.divisor);
+}
+
+void VertexArray::record_definition_(const BufferBase *buffer, const AttrDef &definition) {
+  if (definition.index >= attrib_buffers_.size())
+    attrib_buffers_.resize(definition.index + 1, 0);
+  attrib_buffers_[definition.index] = buffer->id;
+
+  if (definition.divisor == 0)
+    return;
+
+  if (instance_buffer_ != buffer) {
+    instance_buffer_ = buffer;
+    instance_definitions_.clear();
+  }
+  instance_definitions_.emplace_back(definition);
+  instance_offset_ = 0;
+}
+
+void VertexArray::offset_instance_definitions_(GLuint base_instance) {
+  if (!instance_buffer_ || base_instance == instance_offset_)
+    return;
+
+  // Assumes the VAO is already bound
+  instance_buffer_->bind(BufTarget::array);
+  for (const auto &d : instance_definitions_)
+    setup_enable_definition_(d, static_cast<GLsizei>(d.stride * (base_instance / d.divisor)));
+
+  instance_offset_ = base_instance;
 }
 
 void VertexArray::gen_id_() {
@@ -89,6 +168,7 @@ void VertexArray::gen_id_() {
 void VertexArray::del_id_() {
   if (id != 0) {
     glDeleteVertexArrays(1, &id);
+    state_cache().forget_vertex_array(id);
     spdlog::trace("Deleted vertex array ({})", id);
   }
 }
@@ -1,8 +1,15 @@
 #include "baphomet/gfx/internal/batch_set.hpp"
 
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
 namespace baphomet {
 
-BatchSet::BatchSet() {
+BatchSet::BatchSet(std::shared_ptr<gl::StreamRing> stream_ring)
+    : stream_ring_(std::move(stream_ring)) {
   clear_batch_starts_();
 }
 
@@ -15,9 +22,15 @@ void BatchSet::clear() {
   if (ovals)  ovals->clear();
   for (auto &p : tex_batches_)
     p.second->clear();
+  for (auto &p : sprite_batches_)
+    p.second->clear();
+  if (uber_)  uber_->clear();
+  if (static_layers_) static_layers_->clear();
 
   clear_batch_starts_();
-  alpha_fns_.clear();
+  alpha_cmds_.clear();
+  culled_count_ = 0;
+  damage_current_.clear();
   last_batch_type_ = gl::BatchType::none;
   last_tex_name_ = "";
 
@@ -47,7 +60,9 @@ std::size_t BatchSet::oval_vertex_count_opaque() const {
 std::size_t BatchSet::texture_vertex_count_opaque() const {
   std::size_t vertex_count{0};
   for (const auto &p : tex_batches_)
-    vertex_count += p.second->vertex_count_alpha();
+    vertex_count += p.second->vertex_count_opaque();
+  for (const auto &p : sprite_batches_)
+    vertex_count += p.second->vertex_count_opaque();
   return vertex_count;
 }
 
@@ -74,245 +89,612 @@ std::size_t BatchSet::oval_vertex_count_alpha() const {
 std::size_t BatchSet::texture_vertex_count_alpha() const {
   std::size_t vertex_count{0};
   for (const auto &p : tex_batches_)
-    vertex_count += p.second->vertex_count_opaque();
+    vertex_count += p.second->vertex_count_alpha();
+  for (const auto &p : sprite_batches_)
+    vertex_count += p.second->vertex_count_alpha();
   return vertex_count;
 }
 
+void BatchSet::unify_alpha(bool unify) {
+  unify_alpha_ = unify;
+}
+
+void BatchSet::record_static(bool record) {
+  record_static_ = record;
+}
+
+std::shared_ptr<gl::StaticGeometry> BatchSet::bake_static() {
+  for (const auto &p : tex_batches_)
+    if (!p.second->empty_opaque() || !p.second->empty_alpha())
+      spdlog::warn("Textures outside of a texture atlas can't be part of a static layer, and were left out");
+
+  if (!uber_)
+    return std::make_shared<gl::StaticGeometry>();
+  return uber_->bake();
+}
+
+void BatchSet::add_static_layer(const std::shared_ptr<const gl::StaticGeometry> &geometry, float x, float y, float scale_x, float scale_y) {
+  auto bounds = bounds_of_({
+      {geometry->x0 * scale_x + x, geometry->y0 * scale_y + y},
+      {geometry->x1 * scale_x + x, geometry->y1 * scale_y + y}
+  }, 0.0f, 0.0f, 0.0f);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::static_layer, geometry.get(), x, y, scale_x, scale_y);
+
+  if (!static_layers_)
+    static_layers_ = std::make_unique<gl::StaticLayerBatch>();
+  check_store_alpha_batch_(gl::BatchType::static_layer);
+
+  static_layers_->add(geometry, x, y, scale_x, scale_y, z_level);
+  close_alpha_primitive_(bounds);
+  z_level++;
+}
+
+void BatchSet::reorder_alpha(bool reorder) {
+  reorder_alpha_ = reorder;
+}
+
+void BatchSet::cull(bool enable) {
+  cull_ = enable;
+}
+
+void BatchSet::cull_to(float x, float y, float w, float h) {
+  cull_x0_ = x;
+  cull_y0_ = y;
+  cull_x1_ = x + w;
+  cull_y1_ = y + h;
+}
+
+Rect BatchSet::cull_bounds() const {
+  return {cull_x0_, cull_y0_, cull_x1_ - cull_x0_, cull_y1_ - cull_y0_};
+}
+
+std::size_t BatchSet::culled_count() const {
+  return culled_count_;
+}
+
+void BatchSet::track_damage(bool enable) {
+  damage_tracking_ = enable;
+  damage_current_.clear();
+  damage_previous_.clear();
+  damage_all_ = true;
+}
+
+bool BatchSet::tracking_damage() const {
+  return damage_tracking_;
+}
+
+void BatchSet::damage_all() {
+  damage_all_ = true;
+}
+
+Rect BatchSet::take_damage() {
+  Bounds_ damage{
+      std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+      std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()
+  };
+
+  auto extend = [&](const Bounds_ &b) {
+    damage.x0 = std::min(damage.x0, b.x0);
+    damage.y0 = std::min(damage.y0, b.y0);
+    damage.x1 = std::max(damage.x1, b.x1);
+    damage.y1 = std::max(damage.y1, b.y1);
+  };
+
+  if (damage_all_)
+    damage = Bounds_{};
+  else {
+    // Anything that differs has to be redrawn where it is now, and where
+    // it was before
+    auto n = std::max(damage_current_.size(), damage_previous_.size());
+    for (std::size_t i = 0; i < n; ++i) {
+      bool in_current = i < damage_current_.size();
+      bool in_previous = i < damage_previous_.size();
+      if (in_current && in_previous && damage_current_[i].hash == damage_previous_[i].hash)
+        continue;
+
+      if (in_current)  extend(damage_current_[i].bounds);
+      if (in_previous) extend(damage_previous_[i].bounds);
+    }
+  }
+
+  std::swap(damage_current_, damage_previous_);
+  damage_current_.clear();
+  damage_all_ = false;
+
+  float x0 = std::floor(std::max(damage.x0, cull_x0_));
+  float y0 = std::floor(std::max(damage.y0, cull_y0_));
+  float x1 = std::ceil(std::min(damage.x1, cull_x1_));
+  float y1 = std::ceil(std::min(damage.y1, cull_y1_));
+  if (!(x1 > x0 && y1 > y0))
+    return {};
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+void BatchSet::fingerprint_uploads(bool enable) {
+  fingerprint_uploads_ = enable;
+
+  for (gl::Batch *b : std::initializer_list<gl::Batch *>{
+      pixels.get(), lines.get(), lined.get(), tris.get(), rects.get(), ovals.get(), uber_.get()})
+    if (b) b->fingerprint_uploads(enable);
+  for (auto &p : tex_batches_)
+    p.second->fingerprint_uploads(enable);
+  for (auto &p : sprite_batches_)
+    p.second->fingerprint_uploads(enable);
+}
+
+void BatchSet::init_batch_(gl::Batch *batch) {
+  batch->stream_through(stream_ring_);
+  batch->fingerprint_uploads(fingerprint_uploads_);
+}
+
+std::size_t BatchSet::alpha_segment_count() const {
+  return alpha_segment_count_;
+}
+
 void BatchSet::add_pixel(float x, float y, const baphomet::RGB &color) {
-  if (!pixels)
+  auto bounds = bounds_of_({{x, y}, {x + 1.0f, y + 1.0f}}, 0.0f, 0.0f, 0.0f);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::pixel, x, y, color);
+
+  if (!pixels) {
     pixels = std::make_unique<gl::PixelBatch>();
+    init_batch_(pixels.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_pixel(x + 0.5f, y + 0.5f, z_level, packed);
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
     check_store_alpha_batch_(gl::BatchType::pixel);
 
-  auto cv = color.vec4();
-  pixels->add(x + 0.5f, y + 0.5f, z_level, cv.r, cv.g, cv.b, cv.a);
+  pixels->add(x + 0.5f, y + 0.5f, z_level, packed);
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_line(float x0, float y0, float x1, float y1, const baphomet::RGB &color, float cx, float cy, float angle) {
-  if (!lines)
+  auto bounds = bounds_of_({{x0, y0}, {x1, y1}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::line, x0, y0, x1, y1, color, cx, cy, angle);
+
+  if (!lines) {
     lines = std::make_unique<gl::LineBatch>();
+    init_batch_(lines.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_line(x0 + 0.5f, y0 + 0.5f, x1 + 0.5f, y1 + 0.5f, z_level, packed, cx, cy, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
     check_store_alpha_batch_(gl::BatchType::line);
 
-  auto cv = color.vec4();
   lines->add(
       x0 + 0.5f, y0 + 0.5f,
       x1 + 0.5f, y1 + 0.5f,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx, cy, glm::radians(angle)
   );
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle) {
-  if (!tris)
+  auto bounds = bounds_of_({{x0, y0}, {x1, y1}, {x2, y2}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::tri, x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
+
+  if (!tris) {
     tris = std::make_unique<gl::TriBatch>();
+    init_batch_(tris.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_tri(x0, y0, x1, y1, x2, y2, z_level, packed, cx, cy, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
     check_store_alpha_batch_(gl::BatchType::tri);
 
-  auto cv = color.vec4();
   tris->add(
       x0, y0,
       x1, y1,
       x2, y2,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx, cy, glm::radians(angle)
   );
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle) {
-  if (!rects)
+  auto bounds = bounds_of_({{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::rect, x, y, w, h, color, cx, cy, angle);
+
+  if (!rects) {
     rects = std::make_unique<gl::RectBatch>();
+    init_batch_(rects.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_rect(x, y, w, h, z_level, packed, cx, cy, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
     check_store_alpha_batch_(gl::BatchType::rect);
 
-  auto cv = color.vec4();
   rects->add(
       x, y,
       w, h,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx, cy, glm::radians(angle)
   );
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle) {
-  if (!ovals)
+  auto bounds = bounds_of_({{x - x_radius, y - y_radius}, {x + x_radius, y - y_radius}, {x + x_radius, y + y_radius}, {x - x_radius, y + y_radius}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::oval, x, y, x_radius, y_radius, color, cx, cy, angle);
+
+  if (!ovals) {
     ovals = std::make_unique<gl::OvalBatch>();
+    init_batch_(ovals.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_oval(x + 0.5f, y + 0.5f, x_radius + 0.5f, y_radius + 0.5f, z_level, packed, cx + 0.5f, cy + 0.5f, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
     check_store_alpha_batch_(gl::BatchType::oval);
 
-  auto cv = color.vec4();
   ovals->add(
       x + 0.5f, y + 0.5f,
       x_radius + 0.5f, y_radius + 0.5f,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx + 0.5f, cy + 0.5f, glm::radians(angle)
   );
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_texture(const std::string &name, const std::shared_ptr<gl::TextureUnit> &tex_unit, float x, float y, float w, float h, float tx, float ty, float tw, float th, float cx, float cy, float angle, const baphomet::RGB &color) {
+  auto bounds = bounds_of_({{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::texture, tex_unit.get(), x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
+
   if (!tex_batches_.contains(name)) {
     tex_batches_[name] = std::make_unique<gl::TextureBatch>(tex_unit);
+    init_batch_(tex_batches_[name].get());
     tex_batch_starts_[name] = 0;
   }
 
   if (color.a < 255 || !tex_batches_[name]->fully_opaque())
     check_store_alpha_batch_(gl::BatchType::texture, name);
 
-  auto cv = color.vec4();
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
   tex_batches_[name]->add(
       x, y, w, h,
       tx, ty, tw, th,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx, cy, glm::radians(angle)
   );
+  if (color.a < 255 || !tex_batches_[name]->fully_opaque())
+    close_alpha_primitive_(bounds);
+  z_level++;
+}
+
+void BatchSet::add_sprite(const std::string &pages_name, const std::shared_ptr<gl::TextureArray> &pages, int layer, bool fully_opaque, float x, float y, float w, float h, float tx, float ty, float tw, float th, float cx, float cy, float angle, const baphomet::RGB &color) {
+  auto bounds = bounds_of_({{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::sprite, pages.get(), layer, fully_opaque, x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
+
+  if (!sprite_batches_.contains(pages_name)) {
+    sprite_batches_[pages_name] = std::make_unique<gl::SpriteBatch>(pages);
+    init_batch_(sprite_batches_[pages_name].get());
+    sprite_batch_starts_[pages_name] = 0;
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255 || !fully_opaque) && (!uber_ || uber_->accepts(pages))) {
+    uber_alpha_()->add_sprite(pages, layer, x, y, w, h, tx, ty, tw, th, z_level, packed, cx, cy, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
+  if (color.a < 255 || !fully_opaque)
+    check_store_alpha_batch_(gl::BatchType::sprite, pages_name);
+
+  sprite_batches_[pages_name]->add(
+      layer, fully_opaque,
+      x, y, w, h,
+      tx, ty, tw, th,
+      z_level,
+      packed,
+      cx, cy, glm::radians(angle)
+  );
+  if (color.a < 255 || !fully_opaque)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_lined_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle) {
-  if (!lined)
+  auto bounds = bounds_of_({{x0, y0}, {x1, y1}, {x2, y2}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::lined_tri, x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
+
+  if (!lined) {
     lined = std::make_unique<gl::LinedBatch>();
+    init_batch_(lined.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_lined_tri(x0 + 0.5f, y0 + 0.5f, x1 + 0.5f, y1 + 0.5f, x2 + 0.5f, y2 + 0.5f, z_level, packed, cx, cy, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
     check_store_alpha_batch_(gl::BatchType::lined);
 
-  auto cv = color.vec4();
   lined->add_tri(
       x0 + 0.5f, y0 + 0.5f,
       x1 + 0.5f, y1 + 0.5f,
       x2 + 0.5f, y2 + 0.5f,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx, cy, glm::radians(angle)
   );
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_lined_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle) {
-  if (!lined)
+  auto bounds = bounds_of_({{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::lined_rect, x, y, w, h, color, cx, cy, angle);
+
+  if (!lined) {
     lined = std::make_unique<gl::LinedBatch>();
+    init_batch_(lined.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_lined_rect(x + 0.5f, y + 0.5f, w - 1, h - 1, z_level, packed, cx, cy, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
     check_store_alpha_batch_(gl::BatchType::lined);
 
-  auto cv = color.vec4();
   lined->add_rect(
       x + 0.5f, y + 0.5f,
       w - 1, h - 1,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx, cy, glm::radians(angle)
   );
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
 void BatchSet::add_lined_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle) {
-  if (!lined)
-    lined = std::make_unique<gl::LinedBatch>();
+  auto bounds = bounds_of_({{x - x_radius, y - y_radius}, {x + x_radius, y - y_radius}, {x + x_radius, y + y_radius}, {x - x_radius, y + y_radius}}, cx, cy, angle);
+  if (culled_(bounds))
+    return;
+  track_damage_(bounds, Prim_::lined_oval, x, y, x_radius, y_radius, color, cx, cy, angle);
+
+  if (!ovals) {
+    ovals = std::make_unique<gl::OvalBatch>();
+    init_batch_(ovals.get());
+  }
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  if (to_uber_(color.a < 255)) {
+    uber_alpha_()->add_lined_oval(x + 0.5f, y + 0.5f, x_radius, y_radius, z_level, packed, cx + 0.5f, cy + 0.5f, glm::radians(angle));
+    close_alpha_primitive_(bounds);
+    z_level++;
+    return;
+  }
+
   if (color.a < 255)
-    check_store_alpha_batch_(gl::BatchType::lined);
+    check_store_alpha_batch_(gl::BatchType::oval);
 
-  auto cv = color.vec4();
-  lined->add_oval(
+  ovals->add_outline(
       x + 0.5f, y + 0.5f,
       x_radius, y_radius,
+      1.0f,
       z_level,
-      cv.r, cv.g, cv.b, cv.a,
+      packed,
       cx + 0.5f, cy + 0.5f, glm::radians(angle)
   );
+  if (color.a < 255)
+    close_alpha_primitive_(bounds);
   z_level++;
 }
 
-void BatchSet::draw_opaque(glm::mat4 projection) {
+void BatchSet::merge(std::span<DrawRecorder *const> recorders) {
+  if (record_static_) {
+    spdlog::warn("Recorded draws can't be baked into a static layer, dropping them");
+    for (auto *recorder : recorders)
+      recorder->clear();
+    return;
+  }
+
+  merge_runs_.clear();
+  for (auto *recorder : recorders)
+    for (std::uint32_t i = 0; i < recorder->run_count_; ++i)
+      merge_runs_.emplace_back(recorder, i);
+
+  auto by_key = [](const auto &a, const auto &b) {
+    return a.first->runs_[a.second].key < b.first->runs_[b.second].key;
+  };
+
+  // Usually each thread records under one key, in key order already
+  if (!std::is_sorted(merge_runs_.begin(), merge_runs_.end(), by_key))
+    std::stable_sort(merge_runs_.begin(), merge_runs_.end(), by_key);
+
+  // Whatever alpha segment is open ends before the merged draws
+  store_alpha_batch_();
+
+  for (const auto &[recorder, i] : merge_runs_) {
+    const auto &run = recorder->runs_[i];
+
+    // The vertices were made on the recording thread, so all that's left
+    // is moving them past everything drawn so far
+    merge_spans_.clear();
+    for (const auto &span : run.spans) {
+      auto batch = batch_for_(span);
+      auto base = static_cast<GLint>(batch->size_alpha());
+      merge_spans_.emplace_back(batch, base);
+
+      if (span.type == gl::BatchType::lined) {
+        lined->append_opaque(span.opaque, span.opaque_indices, z_level);
+        lined->append_alpha(span.alpha, span.alpha_indices, z_level);
+      } else {
+        batch->append_opaque(span.opaque, z_level);
+        batch->append_alpha(span.alpha, z_level);
+      }
+
+      // Direct draws that follow start their segments after these
+      last_batch_type_ = span.type;
+      last_tex_name_ = span.name;
+      last_alpha_start_() = static_cast<GLint>(batch->size_alpha());
+    }
+
+    for (const auto &cmd : run.alpha_cmds) {
+      auto [batch, base] = merge_spans_[cmd.span];
+      record_alpha_cmd_(
+          batch,
+          base + static_cast<GLint>(cmd.first),
+          static_cast<GLsizei>(cmd.count),
+          Bounds_{cmd.bounds.x0, cmd.bounds.y0, cmd.bounds.x1, cmd.bounds.y1}
+      );
+    }
+
+    if (damage_tracking_) {
+      if (recorder->track_damage_)
+        for (const auto &d : run.damage)
+          damage_current_.push_back({d.hash, Bounds_{d.bounds.x0, d.bounds.y0, d.bounds.x1, d.bounds.y1}});
+      else
+        damage_all_ = true;
+    }
+
+    z_level += run.z_count;
+  }
+
+  last_batch_type_ = gl::BatchType::none;
+  last_tex_name_ = "";
+
+  for (auto *recorder : recorders) {
+    culled_count_ += recorder->culled_count_;
+    recorder->clear();
+  }
+}
+
+float BatchSet::z_max() const {
+  return z_level;
+}
+
+void BatchSet::draw_opaque() {
   for (auto &p : tex_batches_)
-    p.second->draw_opaque(z_level, projection);
-  if (ovals)  ovals->draw_opaque(z_level, projection);
-  if (rects)  rects->draw_opaque(z_level, projection);
-  if (tris)   tris->draw_opaque(z_level, projection);
-  if (lined)  lined->draw_opaque(z_level, projection);
-  if (lines)  lines->draw_opaque(z_level, projection);
-  if (pixels) pixels->draw_opaque(z_level, projection);
+    p.second->draw_opaque();
+  for (auto &p : sprite_batches_)
+    p.second->draw_opaque();
+  if (ovals)  ovals->draw_opaque();
+  if (rects)  rects->draw_opaque();
+  if (tris)   tris->draw_opaque();
+  if (lined)  lined->draw_opaque();
+  if (lines)  lines->draw_opaque();
+  if (pixels) pixels->draw_opaque();
 }
 
-void BatchSet::draw_alpha(glm::mat4 projection) {
-  for (auto &f : alpha_fns_)
-    f(z_level, projection);
+void BatchSet::draw_alpha() {
+  // Close off the segment still open on whichever batch was used last
+  store_alpha_batch_();
+  order_alpha_cmds_();
 
-  switch (last_batch_type_) {
-    case gl::BatchType::pixel:
-      pixels->draw_alpha(
-          z_level,
-          projection,
-          batch_starts_[last_batch_type_],
-          pixels->size_alpha() - batch_starts_[last_batch_type_]
-      );
-      break;
-
-    case gl::BatchType::line:
-      lines->draw_alpha(
-          z_level,
-          projection,
-          batch_starts_[last_batch_type_],
-          lines->size_alpha() - batch_starts_[last_batch_type_]
-      );
-      break;
-
-    case gl::BatchType::lined:
-      lined->draw_alpha(
-          z_level,
-          projection,
-          batch_starts_[last_batch_type_],
-          lined->size_alpha() - batch_starts_[last_batch_type_]
-      );
-      break;
-
-    case gl::BatchType::tri:
-      tris->draw_alpha(
-          z_level,
-          projection,
-          batch_starts_[last_batch_type_],
-          tris->size_alpha() - batch_starts_[last_batch_type_]
-      );
-      break;
-
-    case gl::BatchType::rect:
-      rects->draw_alpha(
-          z_level,
-          projection,
-          batch_starts_[last_batch_type_],
-          rects->size_alpha() - batch_starts_[last_batch_type_]
-      );
-      break;
-
-    case gl::BatchType::oval:
-      ovals->draw_alpha(
-          z_level,
-          projection,
-          batch_starts_[last_batch_type_],
-          ovals->size_alpha() - batch_starts_[last_batch_type_]
-      );
-      break;
+  gl::Batch *run_batch = nullptr;
+  alpha_ranges_.clear();
+  alpha_segment_count_ = 0;
 
-    case gl::BatchType::texture:
-      tex_batches_[last_tex_name_]->draw_alpha(
-          z_level,
-          projection,
-          tex_batch_starts_[last_tex_name_],
-          tex_batches_[last_tex_name_]->size_alpha() - tex_batch_starts_[last_tex_name_]
-      );
-      break;
+  // Consecutive commands on the same batch are submitted together
+  auto flush_run = [&] {
+    if (run_batch) {
+      run_batch->draw_alpha(alpha_ranges_);
+      alpha_segment_count_++;
+    }
+    alpha_ranges_.clear();
+  };
 
-    case gl::BatchType::none:
-      // We didn't draw any alpha geometry
-      break;
+  for (auto i : alpha_order_) {
+    const auto &cmd = alpha_cmds_[i];
+    if (cmd.batch != run_batch) {
+      flush_run();
+      run_batch = cmd.batch;
+    }
+
+    // Primitives that were added one after the other usually still are
+    if (!alpha_ranges_.empty() && alpha_ranges_.back().first + alpha_ranges_.back().count == cmd.first)
+      alpha_ranges_.back().count += cmd.count;
+    else
+      alpha_ranges_.push_back({cmd.first, cmd.count});
   }
+
+  flush_run();
 }
 
 void BatchSet::clear_batch_starts_() {
@@ -322,8 +704,25 @@ void BatchSet::clear_batch_starts_() {
   batch_starts_[gl::BatchType::tri] = 0;
   batch_starts_[gl::BatchType::rect] = 0;
   batch_starts_[gl::BatchType::oval] = 0;
+  batch_starts_[gl::BatchType::uber] = 0;
+  batch_starts_[gl::BatchType::static_layer] = 0;
   for (auto &p : tex_batches_)
     tex_batch_starts_[p.first] = 0;
+  for (auto &p : sprite_batches_)
+    sprite_batch_starts_[p.first] = 0;
+}
+
+bool BatchSet::to_uber_(bool translucent) const {
+  return record_static_ || (translucent && unify_alpha_);
+}
+
+gl::UberBatch *BatchSet::uber_alpha_() {
+  if (!uber_) {
+    uber_ = std::make_unique<gl::UberBatch>();
+    init_batch_(uber_.get());
+  }
+  check_store_alpha_batch_(gl::BatchType::uber);
+  return uber_.get();
 }
 
 void BatchSet::check_store_alpha_batch_(gl::BatchType current_type) {
@@ -340,84 +739,319 @@ void BatchSet::check_store_alpha_batch_(gl::BatchType current_type, const std::s
 }
 
 void BatchSet::store_alpha_batch_() {
-  switch (last_batch_type_) {
-    case gl::BatchType::pixel:
-      alpha_fns_.emplace_back(std::bind(
-          &gl::PixelBatch::draw_alpha,
-          pixels.get(),
-          std::placeholders::_1, std::placeholders::_2,
-          batch_starts_[last_batch_type_],
-          pixels->size_alpha() - batch_starts_[last_batch_type_])
-      );
-      batch_starts_[last_batch_type_] = pixels->size_alpha();
-      break;
-
-    case gl::BatchType::line:
-      alpha_fns_.emplace_back(std::bind(
-          &gl::LineBatch::draw_alpha,
-          lines.get(),
-          std::placeholders::_1, std::placeholders::_2,
-          batch_starts_[last_batch_type_],
-          lines->size_alpha() - batch_starts_[last_batch_type_])
-      );
-      batch_starts_[last_batch_type_] = lines->size_alpha();
-      break;
-
-    case gl::BatchType::lined:
-      alpha_fns_.emplace_back(std::bind(
-          &gl::LinedBatch::draw_alpha,
-          lined.get(),
-          std::placeholders::_1, std::placeholders::_2,
-          batch_starts_[last_batch_type_],
-          lined->size_alpha() - batch_starts_[last_batch_type_])
-      );
-      batch_starts_[last_batch_type_] = lined->size_alpha();
-      break;
-
-    case gl::BatchType::tri:
-      alpha_fns_.emplace_back(std::bind(
-          &gl::TriBatch::draw_alpha,
-          tris.get(),
-          std::placeholders::_1, std::placeholders::_2,
-          batch_starts_[last_batch_type_],
-          tris->size_alpha() - batch_starts_[last_batch_type_])
-      );
-      batch_starts_[last_batch_type_] = tris->size_alpha();
-      break;
-
-    case gl::BatchType::rect:
-      alpha_fns_.emplace_back(std::bind(
-          &gl::RectBatch::draw_alpha,
-          rects.get(),
-          std::placeholders::_1, std::placeholders::_2,
-          batch_starts_[last_batch_type_],
-          rects->size_alpha() - batch_starts_[last_batch_type_])
-      );
-      batch_starts_[last_batch_type_] = rects->size_alpha();
-      break;
-
-    case gl::BatchType::oval:
-      alpha_fns_.emplace_back(std::bind(
-          &gl::OvalBatch::draw_alpha,
-          ovals.get(),
-          std::placeholders::_1, std::placeholders::_2,
-          batch_starts_[last_batch_type_],
-          ovals->size_alpha() - batch_starts_[last_batch_type_])
-      );
-      batch_starts_[last_batch_type_] = ovals->size_alpha();
-      break;
+  store_alpha_batch_(Bounds_{});
+}
+
+void BatchSet::store_alpha_batch_(const Bounds_ &bounds) {
+  auto batch = last_alpha_batch_();
+  if (!batch)
+    return;
+
+  auto &start = last_alpha_start_();
+  auto end = static_cast<GLint>(batch->size_alpha());
+  record_alpha_cmd_(batch, start, end - start, bounds);
+  start = end;
+}
+
+BatchSet::Bounds_ BatchSet::bounds_of_(std::initializer_list<glm::vec2> points, float cx, float cy, float angle) const {
+  // Unbounded is always correct, so skip the work if nothing will look
+  if (record_static_ || !(cull_ || reorder_alpha_ || damage_tracking_))
+    return {};
+
+  Bounds_ bounds{
+      std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+      std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()
+  };
+
+  auto extend = [&](float x, float y) {
+    bounds.x0 = std::min(bounds.x0, x);
+    bounds.y0 = std::min(bounds.y0, y);
+    bounds.x1 = std::max(bounds.x1, x);
+    bounds.y1 = std::max(bounds.y1, y);
+  };
+
+  if (angle == 0.0f)
+    for (auto p : points)
+      extend(p.x, p.y);
+  else {
+    gl::Rotation rot(cx, cy, glm::radians(angle));
+    for (auto p : points) {
+      rot.apply(p.x, p.y);
+      extend(p.x, p.y);
+    }
+  }
+
+  // Lines, outlines and antialiased edges reach a little past the points
+  bounds.x0 -= 1.0f;
+  bounds.y0 -= 1.0f;
+  bounds.x1 += 1.0f;
+  bounds.y1 += 1.0f;
+
+  return bounds;
+}
+
+bool BatchSet::culled_(const Bounds_ &bounds) {
+  if (!cull_ || record_static_)
+    return false;
+
+  // NaNs compare false, so they're kept along with anything unbounded
+  if (bounds.x1 <= cull_x0_ || bounds.y1 <= cull_y0_ || bounds.x0 >= cull_x1_ || bounds.y0 >= cull_y1_) {
+    culled_count_++;
+    return true;
+  }
+  return false;
+}
+
+void BatchSet::close_alpha_primitive_(const Bounds_ &bounds) {
+  if (!reorder_alpha_ || record_static_)
+    return;
+
+  store_alpha_batch_(bounds);
+}
+
+void BatchSet::record_alpha_cmd_(gl::Batch *batch, GLint first, GLsizei count, const Bounds_ &bounds) {
+  if (count <= 0)
+    return;
+
+  // Reordering needs each primitive's own bounds, so the commands are
+  // only merged back together after it
+  if (!reorder_alpha_ && !alpha_cmds_.empty()) {
+    auto &prev = alpha_cmds_.back();
+    if (prev.batch == batch && prev.first + prev.count == first) {
+      prev.count += count;
+      return;
+    }
+  }
+
+  alpha_cmds_.push_back({batch, first, count, bounds});
+}
+
+void BatchSet::order_alpha_cmds_() {
+  auto n = alpha_cmds_.size();
+
+  alpha_order_.resize(n);
+  for (std::size_t i = 0; i < n; ++i)
+    alpha_order_[i] = static_cast<std::uint32_t>(i);
+
+  if (!reorder_alpha_ || n < 3 || n > MAX_REORDER_CMDS_)
+    return;
+
+  Bounds_ extent = alpha_cmds_[0].bounds;
+  bool one_batch = true;
+  for (const auto &cmd : alpha_cmds_) {
+    extent.x0 = std::min(extent.x0, cmd.bounds.x0);
+    extent.y0 = std::min(extent.y0, cmd.bounds.y0);
+    extent.x1 = std::max(extent.x1, cmd.bounds.x1);
+    extent.y1 = std::max(extent.y1, cmd.bounds.y1);
+    one_batch = one_batch && cmd.batch == alpha_cmds_[0].batch;
+  }
+
+  // Nothing to gain, or something without bounds which has to stay put
+  if (one_batch || !std::isfinite(extent.x0) || !std::isfinite(extent.y0) ||
+                   !std::isfinite(extent.x1) || !std::isfinite(extent.y1))
+    return;
+
+  auto cell_w = std::max((extent.x1 - extent.x0) / GRID_DIM_, 1.0f);
+  auto cell_h = std::max((extent.y1 - extent.y0) / GRID_DIM_, 1.0f);
+  auto cell_of = [](float v, float origin, float size) {
+    auto c = static_cast<std::size_t>(std::max((v - origin) / size, 0.0f));
+    return std::min(c, GRID_DIM_ - 1);
+  };
+
+  // Batches missing from the last pass are dropped, the rest keep their
+  // storage
+  grid_cells_.resize(GRID_DIM_ * GRID_DIM_);
+  for (auto &cell : grid_cells_) {
+    std::erase_if(cell, [](const auto &p) { return p.second.empty(); });
+    for (auto &p : cell)
+      p.second.clear();
+  }
+
+  alpha_seen_.assign(n, std::numeric_limits<std::uint32_t>::max());
+  alpha_indegree_.assign(n, 0);
+  alpha_edges_.clear();
+  alpha_last_.clear();
+
+  auto add_edge = [&](std::uint32_t i, std::uint32_t j) {
+    // Commands covering several cells meet in each of them
+    if (alpha_seen_[i] == j)
+      return;
+    alpha_seen_[i] = j;
+
+    alpha_edges_.emplace_back(i, j);
+    alpha_indegree_[j]++;
+  };
+
+  // Commands of one batch keep their submission order, so depending on
+  // one command of a batch covers every earlier one as well
+  for (std::uint32_t j = 0; j < n; ++j) {
+    auto [it, inserted] = alpha_last_.try_emplace(alpha_cmds_[j].batch, j);
+    if (!inserted) {
+      add_edge(it->second, j);
+      it->second = j;
+    }
+  }
+
+  // In each cell it covers, a command depends on the latest earlier
+  // command of each other batch that it overlaps. Only the newest
+  // SCAN_DEPTH_ of a batch are tested; past those it depends on the
+  // newest outright, which may hold back a command that could have moved
+  // but never lets one jump ahead of what it overlaps. Past the budgets
+  // the pass gives up and leaves the submission order alone.
+  std::size_t tests = 0;
+  for (std::uint32_t j = 0; j < n; ++j) {
+    const auto &b = alpha_cmds_[j].bounds;
+    auto batch = alpha_cmds_[j].batch;
+    auto cx0 = cell_of(b.x0, extent.x0, cell_w), cx1 = cell_of(b.x1, extent.x0, cell_w);
+    auto cy0 = cell_of(b.y0, extent.y0, cell_h), cy1 = cell_of(b.y1, extent.y0, cell_h);
+
+    for (auto cy = cy0; cy <= cy1; ++cy)
+      for (auto cx = cx0; cx <= cx1; ++cx) {
+        auto &cell = grid_cells_[cy * GRID_DIM_ + cx];
+
+        std::vector<std::uint32_t> *own = nullptr;
+        for (auto &[other, cmds] : cell) {
+          if (other == batch) {
+            own = &cmds;
+            continue;
+          }
+          if (cmds.empty())
+            continue;
+
+          auto depth = std::min(cmds.size(), SCAN_DEPTH_);
+          tests += depth;
+
+          auto k = cmds.size();
+          while (k > cmds.size() - depth && !alpha_cmds_[cmds[k - 1]].bounds.overlaps(b))
+            --k;
+
+          if (k > cmds.size() - depth)
+            add_edge(cmds[k - 1], j);
+          else if (depth < cmds.size())
+            add_edge(cmds.back(), j);
+        }
+
+        if (!own)
+          own = &cell.emplace_back(batch, std::vector<std::uint32_t>{}).second;
+        own->push_back(j);
+      }
+
+    if (tests > MAX_REORDER_TESTS_ || alpha_edges_.size() > MAX_REORDER_EDGES_)
+      return;
+  }
+
+  // Successors of each command, as offsets into alpha_edge_targets_
+  alpha_edge_starts_.assign(n + 1, 0);
+  for (const auto &e : alpha_edges_)
+    alpha_edge_starts_[e.first + 1]++;
+  for (std::size_t i = 0; i < n; ++i)
+    alpha_edge_starts_[i + 1] += alpha_edge_starts_[i];
+
+  alpha_edge_targets_.resize(alpha_edges_.size());
+  alpha_seen_.assign(alpha_edge_starts_.begin(), alpha_edge_starts_.end() - 1);
+  for (const auto &e : alpha_edges_)
+    alpha_edge_targets_[alpha_seen_[e.first]++] = e.second;
+
+  // Topological order which stays on the current batch for as long as it
+  // has commands ready, falling back to whichever ready command came first
+  for (auto &p : alpha_ready_)
+    p.second.clear();
+
+  auto push_ready = [&](std::uint32_t i) {
+    auto &ready = alpha_ready_[alpha_cmds_[i].batch];
+    ready.push_back(i);
+    std::push_heap(ready.begin(), ready.end(), std::greater<>{});
+  };
+
+  for (std::uint32_t i = 0; i < n; ++i)
+    if (alpha_indegree_[i] == 0)
+      push_ready(i);
+
+  gl::Batch *current = alpha_cmds_[0].batch;
+  for (std::size_t k = 0; k < n; ++k) {
+    auto it = alpha_ready_.find(current);
+    if (it == alpha_ready_.end() || it->second.empty()) {
+      it = alpha_ready_.end();
+      for (auto p = alpha_ready_.begin(); p != alpha_ready_.end(); ++p)
+        if (!p->second.empty() && (it == alpha_ready_.end() || p->second.front() < it->second.front()))
+          it = p;
+    }
+
+    auto &ready = it->second;
+    std::pop_heap(ready.begin(), ready.end(), std::greater<>{});
+    auto i = ready.back();
+    ready.pop_back();
+
+    alpha_order_[k] = i;
+    current = alpha_cmds_[i].batch;
+
+    for (auto e = alpha_edge_starts_[i]; e < alpha_edge_starts_[i + 1]; ++e)
+      if (--alpha_indegree_[alpha_edge_targets_[e]] == 0)
+        push_ready(alpha_edge_targets_[e]);
+  }
+}
+
+gl::Batch *BatchSet::batch_for_(const DrawRecorder::Span_ &span) {
+  auto make = [&]<typename T>(std::unique_ptr<T> &batch) {
+    if (!batch) {
+      batch = std::make_unique<T>();
+      init_batch_(batch.get());
+    }
+    return batch.get();
+  };
+
+  switch (span.type) {
+    case gl::BatchType::pixel: return make(pixels);
+    case gl::BatchType::line:  return make(lines);
+    case gl::BatchType::lined: return make(lined);
+    case gl::BatchType::tri:   return make(tris);
+    case gl::BatchType::rect:  return make(rects);
+    case gl::BatchType::oval:  return make(ovals);
 
     case gl::BatchType::texture:
-      alpha_fns_.emplace_back(std::bind(
-          &gl::TextureBatch::draw_alpha,
-          tex_batches_[last_tex_name_].get(),
-          std::placeholders::_1, std::placeholders::_2,
-          tex_batch_starts_[last_tex_name_],
-          tex_batches_[last_tex_name_]->size_alpha() - tex_batch_starts_[last_tex_name_]
-      ));
-      tex_batch_starts_[last_tex_name_] = tex_batches_[last_tex_name_]->size_alpha();
-      break;
+      if (!tex_batches_.contains(span.name)) {
+        tex_batches_[span.name] = std::make_unique<gl::TextureBatch>(span.unit);
+        init_batch_(tex_batches_[span.name].get());
+        tex_batch_starts_[span.name] = 0;
+      }
+      return tex_batches_[span.name].get();
+
+    case gl::BatchType::sprite:
+      if (!sprite_batches_.contains(span.name)) {
+        sprite_batches_[span.name] = std::make_unique<gl::SpriteBatch>(span.pages);
+        init_batch_(sprite_batches_[span.name].get());
+        sprite_batch_starts_[span.name] = 0;
+      }
+      return sprite_batches_[span.name].get();
+
+    default: break;
   }
+  return nullptr;
+}
+
+gl::Batch *BatchSet::last_alpha_batch_() {
+  switch (last_batch_type_) {
+    case gl::BatchType::pixel:   return pixels.get();
+    case gl::BatchType::line:    return lines.get();
+    case gl::BatchType::lined:   return lined.get();
+    case gl::BatchType::tri:     return tris.get();
+    case gl::BatchType::rect:    return rects.get();
+    case gl::BatchType::oval:    return ovals.get();
+    case gl::BatchType::texture: return tex_batches_[last_tex_name_].get();
+    case gl::BatchType::sprite:  return sprite_batches_[last_tex_name_].get();
+    case gl::BatchType::uber:    return uber_.get();
+    case gl::BatchType::static_layer: return static_layers_.get();
+    case gl::BatchType::none:    break;
+  }
+  return nullptr;
+}
+
+GLint &BatchSet::last_alpha_start_() {
+  if (last_batch_type_ == gl::BatchType::texture)
+    return tex_batch_starts_[last_tex_name_];
+  if (last_batch_type_ == gl::BatchType::sprite)
+    return sprite_batch_starts_[last_tex_name_];
+  return batch_starts_[last_batch_type_];
 }
 
-} // namespace baphomet
\ No newline at end of file
+} // namespace baphomet
@@ -0,0 +1,187 @@
+#include "baphomet/gfx/internal/compositor.hpp"
+
+#include "baphomet/gfx/gl/state_cache.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace baphomet {
+
+Compositor::Compositor() {
+  shader_ = gl::ShaderBuilder("Compositor")
+      .vert_from_src(R"glsl(
+#version 330 core
+layout (location = 0) in vec2 in_pos;
+layout (location = 1) in vec2 in_tex_coords;
+layout (location = 2) in float in_layer;
+
+out vec2 out_tex_coords;
+flat out int out_layer;
+
+uniform mat4 projection;
+
+void main() {
+  gl_Position = projection * vec4(in_pos, 0.0, 1.0);
+
+  out_tex_coords = in_tex_coords;
+  out_layer = int(in_layer);
+}
+    )glsl")
+      .frag_from_src(R"glsl(
+#version 330 core
+in vec2 out_tex_coords;
+flat in int out_layer;
+
+out vec4 FragColor;
+
+uniform sampler2D layers[16];
+
+void main() {
+  // GLSL 3.30 only allows sampler arrays to be indexed by constants. The
+  // targets have no mipmaps, so sampling the base level directly also
+  // avoids needing derivatives inside the branch.
+  switch (out_layer) {
+    case 0: FragColor = textureLod(layers[0], out_tex_coords, 0.0); break;
+    case 1: FragColor = textureLod(layers[1], out_tex_coords, 0.0); break;
+    case 2: FragColor = textureLod(layers[2], out_tex_coords, 0.0); break;
+    case 3: FragColor = textureLod(layers[3], out_tex_coords, 0.0); break;
+    case 4: FragColor = textureLod(layers[4], out_tex_coords, 0.0); break;
+    case 5: FragColor = textureLod(layers[5], out_tex_coords, 0.0); break;
+    case 6: FragColor = textureLod(layers[6], out_tex_coords, 0.0); break;
+    case 7: FragColor = textureLod(layers[7], out_tex_coords, 0.0); break;
+    case 8: FragColor = textureLod(layers[8], out_tex_coords, 0.0); break;
+    case 9: FragColor = textureLod(layers[9], out_tex_coords, 0.0); break;
+    case 10: FragColor = textureLod(layers[10], out_tex_coords, 0.0); break;
+    case 11: FragColor = textureLod(layers[11], out_tex_coords, 0.0); break;
+    case 12: FragColor = textureLod(layers[12], out_tex_coords, 0.0); break;
+    case 13: FragColor = textureLod(layers[13], out_tex_coords, 0.0); break;
+    case 14: FragColor = textureLod(layers[14], out_tex_coords, 0.0); break;
+    case 15: FragColor = textureLod(layers[15], out_tex_coords, 0.0); break;
+  }
+}
+    )glsl")
+      .link();
+
+  projection_ = shader_->uniform<glm::mat4>("projection");
+
+  shader_->use();
+  for (int i = 0; i < MAX_LAYERS_; i++)
+    shader_->uniform_1i("layers[" + std::to_string(i) + "]", i);
+
+  vbo_ = std::make_unique<gl::VecBuffer<float>>(5 * 6 * MAX_LAYERS_, false, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
+
+  vao_ = std::make_unique<gl::VertexArray>();
+  vao_->attrib_pointer(vbo_.get(), {
+      {0, 2, gl::AttrType::float_t, false, sizeof(float) * 5, 0},
+      {1, 2, gl::AttrType::float_t, false, sizeof(float) * 5, sizeof(float) * 2},
+      {2, 1, gl::AttrType::float_t, false, sizeof(float) * 5, sizeof(float) * 4}
+  });
+
+  pending_.reserve(MAX_LAYERS_);
+}
+
+void Compositor::draw(
+    std::span<const std::shared_ptr<RenderTarget>> targets,
+    GLsizei window_width, GLsizei window_height,
+    glm::mat4 projection
+) {
+  submission_count_ = 0;
+
+  auto &state = gl::state_cache();
+  state.viewport(0, 0, window_width, window_height);
+  state.set_enabled(gl::Capability::depth_test, false);
+  state.set_enabled(gl::Capability::blend, true);
+  state.blend_func(
+      gl::BlendFunc::one, gl::BlendFunc::one_minus_src_alpha,
+      gl::BlendFunc::one_minus_dst_alpha, gl::BlendFunc::one
+  );
+
+  for (const auto &target : targets) {
+    const RenderTarget *rt = target.get();
+
+    if (rt->opaque_) {
+      // Covers whatever is below it, so it can be copied in as long as
+      // nothing still waiting to be drawn lies underneath
+      bool overlaps = std::any_of(pending_.begin(), pending_.end(), [&](const RenderTarget *p) {
+        return rt->x_ < p->x_ + p->w_ && p->x_ < rt->x_ + rt->w_ &&
+               rt->y_ < p->y_ + p->h_ && p->y_ < rt->y_ + rt->h_;
+      });
+      if (overlaps)
+        flush_(projection);
+
+      blit_(*rt, window_height);
+      continue;
+    }
+
+    if (pending_.size() == MAX_LAYERS_)
+      flush_(projection);
+    pending_.push_back(rt);
+  }
+  flush_(projection);
+
+  state.active_texture(0);
+  state.set_enabled(gl::Capability::blend, false);
+  state.set_enabled(gl::Capability::depth_test, true);
+}
+
+std::size_t Compositor::submission_count() const {
+  return submission_count_;
+}
+
+void Compositor::flush_(glm::mat4 projection) {
+  if (pending_.empty())
+    return;
+
+  vbo_->clear();
+  for (std::size_t i = 0; i < pending_.size(); i++) {
+    const RenderTarget *rt = pending_[i];
+
+    gl::state_cache().active_texture(static_cast<int>(i));
+    rt->fbo_->use_texture("color");
+
+    // Texture rows run bottom to top, but the targets are drawn top down
+    float x0 = rt->x_, y0 = rt->y_, x1 = rt->x_ + rt->w_, y1 = rt->y_ + rt->h_;
+    auto layer = static_cast<float>(i);
+    vbo_->add({
+        x0, y0,  0.0f, 1.0f,  layer,
+        x1, y0,  1.0f, 1.0f,  layer,
+        x1, y1,  1.0f, 0.0f,  layer,
+        x0, y0,  0.0f, 1.0f,  layer,
+        x1, y1,  1.0f, 0.0f,  layer,
+        x0, y1,  0.0f, 0.0f,  layer
+    });
+  }
+  vbo_->sync();
+
+  shader_->use();
+  projection_.set(projection);
+
+  vao_->draw_arrays(
+      gl::DrawMode::triangles,
+      vbo_->front() / 5,
+      vbo_->size() / 5
+  );
+
+  pending_.clear();
+  submission_count_++;
+}
+
+void Compositor::blit_(const RenderTarget &target, GLsizei window_height) {
+  auto x = static_cast<GLint>(target.x_);
+  auto y = static_cast<GLint>(target.y_);
+  auto w = target.fbo_->width;
+  auto h = target.fbo_->height;
+
+  // The window's origin is at the bottom left
+  target.fbo_->bind(gl::FboTarget::read);
+  glBlitFramebuffer(
+      0, 0, w, h,
+      x, window_height - y - h, x + w, window_height - y,
+      GL_COLOR_BUFFER_BIT, GL_NEAREST
+  );
+  gl::state_cache().bind_framebuffer(gl::FboTarget::read, 0);
+
+  submission_count_++;
+}
+
+} // namespace baphomet
@@ -2,6 +2,17 @@
 
 #include "glm/glm.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+# define BAPHOMET_PARTICLES_AVX2
+# include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define BAPHOMET_PARTICLES_SSE2
+# include <emmintrin.h>
+#endif
+
 using namespace std::chrono_literals;
 
 namespace baphomet {
@@ -11,10 +22,12 @@ ParticleSystem::ParticleSystem(std::unique_ptr<baphomet::Texture> &tex)
   render_func_ = tex->render_func_;
   tex_width_ = tex->width_;
   tex_height_ = tex->height_;
+
+  build_color_lut_();
 }
 
 std::size_t ParticleSystem::live_count() {
-  return live_count_;
+  return particles_.size();
 }
 
 void ParticleSystem::set_emitter_pos(float x, float y) {
@@ -70,22 +83,34 @@ void ParticleSystem::set_spin(float min, float max) {
 }
 
 void ParticleSystem::set_colors(const std::vector<baphomet::RGB> &colors) {
+  if (colors.empty())
+    return;
+
   params_.colors.clear();
 
-  float step = 1.0f / (colors.size() - 1);
-  float acc = 0.0;
-  for (const auto &color : colors) {
-    params_.colors.emplace_back(acc, color);
-    acc += step;
+  // A single color is held for the whole life
+  if (colors.size() == 1) {
+    params_.colors.emplace_back(0.0f, colors[0]);
+    params_.colors.emplace_back(1.0f, colors[0]);
+
+  } else {
+    float step = 1.0f / (colors.size() - 1);
+    float acc = 0.0;
+    for (const auto &color : colors) {
+      params_.colors.emplace_back(acc, color);
+      acc += step;
+    }
   }
+
+  build_color_lut_();
 }
 
 void ParticleSystem::emit_count(std::size_t count, float x, float y) {
-  if (live_count_ >= params_.particle_limit)
+  if (particles_.size() >= params_.particle_limit)
     return;
 
-  for (std::size_t i = 0; i < count && live_count_ < params_.particle_limit; ++i)
-    find_insert_particle_(x, y);
+  for (std::size_t i = 0; i < count && particles_.size() < params_.particle_limit; ++i)
+    spawn_(x, y);
 }
 
 void ParticleSystem::emit_count(std::size_t count) {
@@ -93,14 +118,14 @@ void ParticleSystem::emit_count(std::size_t count) {
 }
 
 void ParticleSystem::emit(Duration dt, float x, float y) {
-  if (live_count_ >= params_.particle_limit)
+  if (particles_.size() >= params_.particle_limit)
     return;
 
   auto acc_step = baphomet::sec(1 / params_.emitter_rate);
 
   params_.emitter_acc += dt;
-  while (params_.emitter_acc >= acc_step && live_count_ < params_.particle_limit) {
-    find_insert_particle_(x, y);
+  while (params_.emitter_acc >= acc_step && particles_.size() < params_.particle_limit) {
+    spawn_(x, y);
     params_.emitter_acc -= acc_step;
   }
 
@@ -116,15 +141,14 @@ void ParticleSystem::emit(Duration dt) {
 }
 
 void ParticleSystem::draw() {
-  for (const auto &p : particles_) {
-    if (p.alive)
-      render_func_(
-          p.x - (p.w / 2), p.y - (p.h / 2), p.w, p.h,
-          0.0f, 0.0f, p.w, p.h,
-          p.x, p.y, p.tex_angle,
-          p.color
-      );
-  }
+  const auto &p = particles_;
+  for (std::size_t i = 0; i < p.size(); ++i)
+    render_func_(
+        p.x[i] - (tex_width_ / 2), p.y[i] - (tex_height_ / 2), tex_width_, tex_height_,
+        0.0f, 0.0f, tex_width_, tex_height_,
+        p.x[i], p.y[i], p.tex_angle[i],
+        color_lut_[p.color_idx[i]]
+    );
 }
 
 float lerp(float a, float b, float t) {
@@ -132,101 +156,224 @@ float lerp(float a, float b, float t) {
 }
 
 void ParticleSystem::update_(Duration dt) {
-  for (std::size_t i = 0; i < particles_.size(); ++i) {
-    if (!particles_[i].alive)
-      continue;
-
-    particles_[i].acc += dt;
-    if (particles_[i].acc >= particles_[i].ttl) {
-      particles_[i].alive = false;
-      dead_positions_.push(i);
-      live_count_--;
-
-    } else {
-      double dt_sec = dt / 1s;
-
-      // Radial movement
-      particles_[i].radial_vel += particles_[i].radial_accel * dt_sec;
-      particles_[i].x += std::cos(particles_[i].angle) * particles_[i].radial_vel * dt_sec;
-      particles_[i].y += -std::sin(particles_[i].angle) * particles_[i].radial_vel * dt_sec;
-
-      // Linear movement
-      particles_[i].ldx += particles_[i].lax * dt_sec;
-      particles_[i].ldy += particles_[i].lay * dt_sec;
-      particles_[i].x += particles_[i].ldx * dt_sec;
-      particles_[i].y += particles_[i].ldy * dt_sec;
-
-      particles_[i].tex_angle += particles_[i].spin * dt_sec;
-
-      // Color modification
-      auto progress = particles_[i].acc / particles_[i].ttl;
-      for (std::size_t j = particles_[i].color_idx; j < params_.colors.size() - 1; ++j) {
-        auto[prog1, color1] = params_.colors[j];
-        auto[prog2, color2] = params_.colors[j + 1];
-        if (progress >= prog1 && progress <= prog2) {
-          double prog = (progress - prog1) / (prog2 - prog1);
-          particles_[i].color = baphomet::rgba(
-              lerp(color1.r, color2.r, prog),
-              lerp(color1.g, color2.g, prog),
-              lerp(color1.b, color2.b, prog),
-              lerp(color1.a, color2.a, prog)
-          );
-          particles_[i].color_idx = j;
-          break;
-        }
-      }
-    }
+  auto dt_sec = static_cast<float>(dt / 1s);
+
+  auto done = update_simd_(dt_sec);
+  update_scalar_(done, particles_.size(), dt_sec);
+
+  // Moving the last particle into a dead one's place keeps the live ones
+  // packed, at the cost of drawing them in a different order
+  for (std::size_t i = 0; i < particles_.size();) {
+    if (particles_.age[i] * particles_.inv_ttl[i] >= 1.0f) {
+      particles_.move(i, particles_.size() - 1);
+      particles_.pop_back();
+    } else
+      ++i;
   }
 }
 
-void ParticleSystem::find_insert_particle_(float x, float y) {
-  if (live_count_ >= params_.particle_limit)
-    return;
+namespace {
 
-  if (!dead_positions_.empty()) {
-    std::size_t i = dead_positions_.top();
-    dead_positions_.pop();
-
-    particles_[i].ttl = baphomet::sec(rnd::get<float>(params_.ttl_min / 1s, params_.ttl_max / 1s));
-    particles_[i].angle = rnd::get<float>(params_.angle_min, params_.angle_max);
-    particles_[i].radial_vel = rnd::get<float>(params_.delta_min, params_.delta_max);
-    particles_[i].radial_accel = rnd::get<float>(params_.accel_min, params_.accel_max);
-    particles_[i].ldx = rnd::get<float>(params_.ldx_min, params_.ldx_max);
-    particles_[i].ldy = rnd::get<float>(params_.ldy_min, params_.ldy_max);
-    particles_[i].lax = rnd::get<float>(params_.lax_min, params_.lax_max);
-    particles_[i].lay = rnd::get<float>(params_.lay_min, params_.lay_max);
-    particles_[i].spin = rnd::get<float>(params_.spin_min, params_.spin_max);
-    particles_[i].x = x;
-    particles_[i].y = y;
-    particles_[i].w = tex_width_;
-    particles_[i].h = tex_height_;
-    particles_[i].tex_angle = 0.0f;
-    particles_[i].color = std::get<1>(params_.colors[0]);
-    particles_[i].color_idx = 0;
-    particles_[i].acc = baphomet::sec(0);
-    particles_[i].alive = true;
+#if defined(BAPHOMET_PARTICLES_AVX2)
+using Lanes_ = __m256;
+constexpr std::size_t LANES_{8};
 
-  } else {
-    particles_.emplace_back(
-        baphomet::sec(rnd::get<float>(params_.ttl_min / 1s, params_.ttl_max / 1s)),
-        rnd::get<float>(params_.angle_min, params_.angle_max),
-        rnd::get<float>(params_.delta_min, params_.delta_max),
-        rnd::get<float>(params_.accel_min, params_.accel_max),
-        rnd::get<float>(params_.ldx_min, params_.ldx_max),
-        rnd::get<float>(params_.ldy_min, params_.ldy_max),
-        rnd::get<float>(params_.lax_min, params_.lax_max),
-        rnd::get<float>(params_.lay_min, params_.lay_max),
-        rnd::get<float>(params_.spin_min, params_.spin_max),
-        x,
-        y,
-        tex_width_,
-        tex_height_,
-        0.0f,
-        std::get<1>(params_.colors[0])
+inline Lanes_ load_(const float *p) { return _mm256_loadu_ps(p); }
+inline void store_(float *p, Lanes_ v) { _mm256_storeu_ps(p, v); }
+inline Lanes_ splat_(float v) { return _mm256_set1_ps(v); }
+
+inline Lanes_ add_(Lanes_ a, Lanes_ b) { return _mm256_add_ps(a, b); }
+inline Lanes_ mul_(Lanes_ a, Lanes_ b) { return _mm256_mul_ps(a, b); }
+inline Lanes_ min_(Lanes_ a, Lanes_ b) { return _mm256_min_ps(a, b); }
+
+// a * b + c
+inline Lanes_ madd_(Lanes_ a, Lanes_ b, Lanes_ c) {
+# if defined(__FMA__)
+  return _mm256_fmadd_ps(a, b, c);
+# else
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+# endif
+}
+
+// Truncated, like a static_cast
+inline void store_index_(std::int32_t *p, Lanes_ v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_cvttps_epi32(v));
+}
+
+#elif defined(BAPHOMET_PARTICLES_SSE2)
+using Lanes_ = __m128;
+constexpr std::size_t LANES_{4};
+
+inline Lanes_ load_(const float *p) { return _mm_loadu_ps(p); }
+inline void store_(float *p, Lanes_ v) { _mm_storeu_ps(p, v); }
+inline Lanes_ splat_(float v) { return _mm_set1_ps(v); }
+
+inline Lanes_ add_(Lanes_ a, Lanes_ b) { return _mm_add_ps(a, b); }
+inline Lanes_ mul_(Lanes_ a, Lanes_ b) { return _mm_mul_ps(a, b); }
+inline Lanes_ min_(Lanes_ a, Lanes_ b) { return _mm_min_ps(a, b); }
+
+// a * b + c
+inline Lanes_ madd_(Lanes_ a, Lanes_ b, Lanes_ c) {
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+// Truncated, like a static_cast
+inline void store_index_(std::int32_t *p, Lanes_ v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_cvttps_epi32(v));
+}
+#endif
+
+} // namespace
+
+std::size_t ParticleSystem::update_simd_(float dt) {
+#if defined(BAPHOMET_PARTICLES_AVX2) || defined(BAPHOMET_PARTICLES_SSE2)
+  auto &p = particles_;
+  auto n = p.size() - p.size() % LANES_;
+
+  auto vdt = splat_(dt);
+  auto one = splat_(1.0f);
+  auto lut_max = splat_(static_cast<float>(COLOR_LUT_SIZE_ - 1));
+
+  // Same steps as update_scalar_, LANES_ particles at a time
+  for (std::size_t i = 0; i < n; i += LANES_) {
+    auto age = add_(load_(&p.age[i]), vdt);
+    store_(&p.age[i], age);
+
+    auto radial_vel = madd_(load_(&p.radial_accel[i]), vdt, load_(&p.radial_vel[i]));
+    store_(&p.radial_vel[i], radial_vel);
+
+    auto ldx = madd_(load_(&p.lax[i]), vdt, load_(&p.ldx[i]));
+    auto ldy = madd_(load_(&p.lay[i]), vdt, load_(&p.ldy[i]));
+    store_(&p.ldx[i], ldx);
+    store_(&p.ldy[i], ldy);
+
+    auto vx = madd_(load_(&p.dir_x[i]), radial_vel, ldx);
+    auto vy = madd_(load_(&p.dir_y[i]), radial_vel, ldy);
+    store_(&p.x[i], madd_(vx, vdt, load_(&p.x[i])));
+    store_(&p.y[i], madd_(vy, vdt, load_(&p.y[i])));
+
+    store_(&p.tex_angle[i], madd_(load_(&p.spin[i]), vdt, load_(&p.tex_angle[i])));
+
+    auto progress = min_(mul_(age, load_(&p.inv_ttl[i])), one);
+    store_index_(&p.color_idx[i], mul_(progress, lut_max));
+  }
+
+  return n;
+#else
+  (void)dt;
+  return 0;
+#endif
+}
+
+void ParticleSystem::update_scalar_(std::size_t begin, std::size_t end, float dt) {
+  auto &p = particles_;
+  auto lut_max = static_cast<float>(COLOR_LUT_SIZE_ - 1);
+
+  for (std::size_t i = begin; i < end; ++i) {
+    p.age[i] += dt;
+
+    // Radial movement
+    p.radial_vel[i] += p.radial_accel[i] * dt;
+
+    // Linear movement
+    p.ldx[i] += p.lax[i] * dt;
+    p.ldy[i] += p.lay[i] * dt;
+
+    p.x[i] += (p.dir_x[i] * p.radial_vel[i] + p.ldx[i]) * dt;
+    p.y[i] += (p.dir_y[i] * p.radial_vel[i] + p.ldy[i]) * dt;
+
+    p.tex_angle[i] += p.spin[i] * dt;
+
+    auto progress = std::min(p.age[i] * p.inv_ttl[i], 1.0f);
+    p.color_idx[i] = static_cast<std::int32_t>(progress * lut_max);
+  }
+}
+
+void ParticleSystem::build_color_lut_() {
+  const auto &stops = params_.colors;
+
+  std::size_t j = 0;
+  for (std::size_t i = 0; i < COLOR_LUT_SIZE_; ++i) {
+    auto progress = static_cast<float>(i) / (COLOR_LUT_SIZE_ - 1);
+
+    // Both the stops and the entries go in order of progress
+    while (j + 2 < stops.size() && progress > std::get<0>(stops[j + 1]))
+      ++j;
+
+    auto [prog1, color1] = stops[j];
+    auto [prog2, color2] = stops[j + 1];
+
+    float t = 0.0f;
+    if (prog2 > prog1)
+      t = std::clamp((progress - prog1) / (prog2 - prog1), 0.0f, 1.0f);
+
+    color_lut_[i] = baphomet::rgba(
+        lerp(color1.r, color2.r, t),
+        lerp(color1.g, color2.g, t),
+        lerp(color1.b, color2.b, t),
+        lerp(color1.a, color2.a, t)
     );
   }
+}
+
+void ParticleSystem::spawn_(float x, float y) {
+  if (particles_.size() >= params_.particle_limit)
+    return;
+
+  auto ttl = rnd::get<float>(params_.ttl_min / 1s, params_.ttl_max / 1s);
+  auto angle = rnd::get<float>(params_.angle_min, params_.angle_max);
+
+  auto &p = particles_;
+  p.x.push_back(x);
+  p.y.push_back(y);
+
+  // The direction never changes, so it's only worked out here
+  p.dir_x.push_back(std::cos(angle));
+  p.dir_y.push_back(-std::sin(angle));
+
+  p.radial_vel.push_back(rnd::get<float>(params_.delta_min, params_.delta_max));
+  p.radial_accel.push_back(rnd::get<float>(params_.accel_min, params_.accel_max));
+  p.ldx.push_back(rnd::get<float>(params_.ldx_min, params_.ldx_max));
+  p.ldy.push_back(rnd::get<float>(params_.ldy_min, params_.ldy_max));
+  p.lax.push_back(rnd::get<float>(params_.lax_min, params_.lax_max));
+  p.lay.push_back(rnd::get<float>(params_.lay_min, params_.lay_max));
+  p.tex_angle.push_back(0.0f);
+  p.spin.push_back(rnd::get<float>(params_.spin_min, params_.spin_max));
+
+  // Particles with no time to live still last until the next update
+  p.age.push_back(0.0f);
+  p.inv_ttl.push_back(1.0f / std::max(ttl, 1e-6f));
+  p.color_idx.push_back(0);
+}
+
+/****************
+ * PARTICLE DATA
+ */
+
+std::size_t ParticleSystem::Particles_::size() const {
+  return x.size();
+}
+
+std::array<std::vector<float> *, 14> ParticleSystem::Particles_::floats_() {
+  return {&x, &y, &dir_x, &dir_y, &radial_vel, &radial_accel, &ldx, &ldy, &lax, &lay, &tex_angle, &spin, &age, &inv_ttl};
+}
+
+void ParticleSystem::Particles_::reserve(std::size_t n) {
+  for (auto *v : floats_())
+    v->reserve(n);
+  color_idx.reserve(n);
+}
+
+void ParticleSystem::Particles_::pop_back() {
+  for (auto *v : floats_())
+    v->pop_back();
+  color_idx.pop_back();
+}
 
-  live_count_++;
+void ParticleSystem::Particles_::move(std::size_t dst, std::size_t src) {
+  for (auto *v : floats_())
+    (*v)[dst] = (*v)[src];
+  color_idx[dst] = color_idx[src];
 }
 
-} // namespace baphomet
\ No newline at end of file
+} // namespace baphomet
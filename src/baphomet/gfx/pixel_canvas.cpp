@@ -0,0 +1,125 @@
+#include "baphomet/gfx/pixel_canvas.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace baphomet {
+
+PixelCanvas::PixelCanvas(const std::string &name, int width, int height, bool opaque, bool retro)
+    : name_(name), width_(width), height_(height) {
+  pixels_.resize(static_cast<std::size_t>(width_) * height_, 0);
+
+  tex_unit_ = std::make_shared<gl::TextureUnit>(width_, height_, opaque, retro);
+
+  for (auto &pbo : pbos_)
+    pbo = std::make_unique<gl::StaticBuffer<std::uint32_t>>(
+        pixels_.size(),
+        gl::BufTarget::pixel_unpack,
+        gl::BufUsage::stream_draw
+    );
+
+  // Storage starts out undefined, so the first draw sends everything
+  mark_dirty();
+}
+
+int PixelCanvas::w() const {
+  return width_;
+}
+
+int PixelCanvas::h() const {
+  return height_;
+}
+
+baphomet::RGB PixelCanvas::get(int x, int y) const {
+  if (x < 0 || y < 0 || x >= width_ || y >= height_)
+    return rgba(0, 0, 0, 0);
+
+  auto p = pixels_[y * width_ + x];
+  return rgba(p & 0xff, (p >> 8) & 0xff, (p >> 16) & 0xff, p >> 24);
+}
+
+void PixelCanvas::fill(const baphomet::RGB &color) {
+  std::ranges::fill(pixels_, gl::pack_rgba8(color.r, color.g, color.b, color.a));
+  mark_dirty();
+}
+
+void PixelCanvas::fill_rect(int x, int y, int w, int h, const baphomet::RGB &color) {
+  auto x0 = std::clamp(x, 0, width_);
+  auto y0 = std::clamp(y, 0, height_);
+  auto x1 = std::clamp(x + w, 0, width_);
+  auto y1 = std::clamp(y + h, 0, height_);
+  if (x0 >= x1 || y0 >= y1)
+    return;
+
+  auto packed = gl::pack_rgba8(color.r, color.g, color.b, color.a);
+  for (int ry = y0; ry < y1; ++ry) {
+    auto start = pixels_.begin() + ry * width_;
+    std::fill(start + x0, start + x1, packed);
+  }
+  dirty_rows_(y0, y1);
+}
+
+std::span<std::uint32_t> PixelCanvas::row(int y) {
+  if (y < 0 || y >= height_)
+    return {};
+
+  dirty_rows_(y, y + 1);
+  return {pixels_.data() + y * width_, static_cast<std::size_t>(width_)};
+}
+
+std::span<std::uint32_t> PixelCanvas::pixels() {
+  mark_dirty();
+  return pixels_;
+}
+
+void PixelCanvas::mark_dirty(int y0, int y1) {
+  y0 = std::clamp(y0, 0, height_);
+  y1 = std::clamp(y1, 0, height_);
+  if (y0 < y1)
+    dirty_rows_(y0, y1);
+}
+
+void PixelCanvas::mark_dirty() {
+  dirty_rows_(0, height_);
+}
+
+bool PixelCanvas::upload_() {
+  if (dirty_y0_ >= dirty_y1_)
+    return false;
+
+  auto offset = static_cast<std::size_t>(dirty_y0_) * width_;
+  auto count = static_cast<std::size_t>(dirty_y1_ - dirty_y0_) * width_;
+
+  // Alternating between two buffers, and orphaning the one being written,
+  // means the driver never has to wait for last frame's transfer to finish
+  // before this one can be mapped
+  auto &pbo = pbos_[next_pbo_];
+  next_pbo_ = (next_pbo_ + 1) % pbos_.size();
+
+  pbo->resize(pbo->size());
+  auto mapped = pbo->map(count);
+  if (mapped) {
+    std::memcpy(mapped, pixels_.data() + offset, count * sizeof(std::uint32_t));
+    pbo->unmap();
+
+    tex_unit_->bind();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(
+        GL_TEXTURE_2D, 0,
+        0, dirty_y0_, width_, dirty_y1_ - dirty_y0_,
+        GL_RGBA, GL_UNSIGNED_BYTE,
+        nullptr
+    );
+    tex_unit_->unbind();
+
+    gl::upload_stats().bytes_uploaded += count * sizeof(std::uint32_t);
+
+  } else
+    spdlog::error("Failed to map pixel buffer for canvas '{}'", name_);
+  pbo->unbind(gl::BufTarget::pixel_unpack);
+
+  dirty_y0_ = dirty_y1_ = 0;
+  return mapped != nullptr;
+}
+
+} // namespace baphomet
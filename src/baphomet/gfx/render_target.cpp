@@ -1,11 +1,15 @@
 #include "baphomet/gfx/render_target.hpp"
 
+#include <algorithm>
+#include <limits>
+
 namespace baphomet {
 
 RenderTarget::RenderTarget(
     const std::string &tag,
     std::uint64_t weight,
-    float x, float y, float w, float h
+    float x, float y, float w, float h,
+    std::shared_ptr<gl::StreamRing> stream_ring
 ) : tag_(tag), weight_(weight), x_(x), y_(y), w_(w), h_(h) {
   fbo_ = gl::FramebufferBuilder(w, h)
       .texture("color", gl::TexFormat::rgba8)
@@ -13,75 +17,8 @@ RenderTarget::RenderTarget(
       .check_complete();
   projection_ = glm::ortho(0.0f, w, h, 0.0f, 0.0f, 1.0f);
 
-  batches_ = std::make_unique<BatchSet>();
-
-  shader_ = gl::ShaderBuilder("RenderTarget")
-      .vert_from_src(R"glsl(
-#version 330 core
-layout (location = 0) in vec3 in_pos;
-layout (location = 1) in vec4 in_color;
-layout (location = 2) in vec2 in_tex_coords;
-layout (location = 3) in vec3 in_trans;
-
-out vec4 out_color;
-out vec2 out_tex_coords;
-
-uniform float z_max;
-uniform mat4 projection;
-
-void main() {
-  float c = cos(in_trans.z);
-  float s = sin(in_trans.z);
-  float x = in_trans.x;
-  float y = in_trans.y;
-  float m30 = -x * c + y * s + x;
-  float m31 = -x * s - y * c + y;
-  mat4 trans = mat4(
-    vec4(c,   s,   0.0, 0.0),
-    vec4(-s,  c,   0.0, 0.0),
-    vec4(0.0, 0.0, 1.0, 0.0),
-    vec4(m30, m31, 0.0, 1.0)
-  );
-
-  float z = -(z_max - in_pos.z) / (z_max + 1.0);
-  gl_Position = projection * trans * vec4(in_pos.xy, z, 1.0);
-
-  out_color = in_color;
-  out_tex_coords = in_tex_coords;
-}
-    )glsl")
-      .frag_from_src(R"glsl(
-#version 330 core
-in vec4 out_color;
-in vec2 out_tex_coords;
-
-out vec4 FragColor;
-
-uniform sampler2D tex;
-
-void main() {
-  FragColor = out_color * texture(tex, out_tex_coords);
-}
-    )glsl")
-      .link();
-
-  vbo_ = std::make_unique<gl::VecBuffer<float>>(10 * 6, true, gl::BufTarget::array, gl::BufUsage::dynamic_draw);
-  vbo_->add({
-      x,     y,     1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  0.0f, 1.0f,  0.0f, 0.0f, 0.0f,
-      x + w, y,     1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  1.0f, 1.0f,  0.0f, 0.0f, 0.0f,
-      x + w, y + h, 1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  1.0f, 0.0f,  0.0f, 0.0f, 0.0f,
-      x,     y,     1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  0.0f, 1.0f,  0.0f, 0.0f, 0.0f,
-      x + w, y + h, 1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  1.0f, 0.0f,  0.0f, 0.0f, 0.0f,
-      x,     y + h, 1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  0.0f, 0.0f,  0.0f, 0.0f, 0.0f
-  });
-
-  vao_ = std::make_unique<gl::VertexArray>();
-  vao_->attrib_pointer(vbo_.get(), {
-      {0, 3, gl::AttrType::float_t, false, sizeof(float) * 12, 0},
-      {1, 4, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 3},
-      {2, 2, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 7},
-      {3, 3, gl::AttrType::float_t, false, sizeof(float) * 12, sizeof(float) * 9}
-  });
+  batches_ = std::make_unique<BatchSet>(std::move(stream_ring));
+  update_cull_bounds_();
 }
 
 float RenderTarget::x() const {
@@ -111,35 +48,121 @@ void RenderTarget::resize(float x, float y, float w, float h) {
       .renderbuffer(gl::RBufFormat::d32f)
       .check_complete();
   projection_ = glm::ortho(0.0f, w, h, 0.0f, 0.0f, 1.0f);
-
-  vbo_->clear();
-  vbo_->add({
-      x,     y,     1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  0.0f, 1.0f,  0.0f, 0.0f, 0.0f,
-      x + w, y,     1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  1.0f, 1.0f,  0.0f, 0.0f, 0.0f,
-      x + w, y + h, 1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  1.0f, 0.0f,  0.0f, 0.0f, 0.0f,
-      x,     y,     1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  0.0f, 1.0f,  0.0f, 0.0f, 0.0f,
-      x + w, y + h, 1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  1.0f, 0.0f,  0.0f, 0.0f, 0.0f,
-      x,     y + h, 1.0f,  1.0f, 1.0f, 1.0f, 1.0f,  0.0f, 0.0f,  0.0f, 0.0f, 0.0f
-  });
+  update_cull_bounds_();
+  invalidate();
 }
 
 void RenderTarget::resize(float w, float h) {
   resize(x_, y_, w, h);
 }
 
-void RenderTarget::draw_(glm::mat4 window_projection) {
-  vbo_->sync();
+std::size_t RenderTarget::add_camera(const Camera &camera) {
+  cameras_.push_back(camera);
+  update_cull_bounds_();
+  invalidate();
+  return cameras_.size() - 1;
+}
+
+void RenderTarget::set_camera(std::size_t i, const Camera &camera) {
+  cameras_[i] = camera;
+  update_cull_bounds_();
+  invalidate();
+}
+
+const Camera &RenderTarget::camera(std::size_t i) const {
+  return cameras_[i];
+}
+
+std::size_t RenderTarget::camera_count() const {
+  return cameras_.size();
+}
+
+void RenderTarget::clear_cameras() {
+  cameras_.clear();
+  update_cull_bounds_();
+  invalidate();
+}
+
+void RenderTarget::opaque(bool opaque) {
+  opaque_ = opaque;
+}
+
+bool RenderTarget::opaque() const {
+  return opaque_;
+}
+
+void RenderTarget::cache(Duration refresh_interval) {
+  cached_ = true;
+  refresh_interval_ = refresh_interval;
+  invalidate();
+}
+
+void RenderTarget::uncache() {
+  cached_ = false;
+}
+
+bool RenderTarget::cached() const {
+  return cached_;
+}
+
+void RenderTarget::invalidate() {
+  dirty_ = true;
+  batches_->damage_all();
+}
+
+bool RenderTarget::refreshing() const {
+  return refreshing_;
+}
+
+void RenderTarget::track_damage(bool enable) {
+  batches_->track_damage(enable);
+  deferred_clear_.pending = false;
+}
+
+Rect RenderTarget::damage() const {
+  return damage_;
+}
+
+void RenderTarget::begin_frame_() {
+  refreshing_ = !cached_ || dirty_ ||
+      (refresh_interval_ > Duration::zero() && Clock::now() - last_refresh_ >= refresh_interval_);
+}
+
+void RenderTarget::end_frame_() {
+  if (refreshing_) {
+    dirty_ = false;
+    last_refresh_ = Clock::now();
+  }
+  deferred_clear_.pending = false;
+}
+
+void RenderTarget::update_cull_bounds_() {
+  if (cameras_.empty()) {
+    batches_->cull_to(0.0f, 0.0f, w_, h_);
+    return;
+  }
+
+  auto x0 = std::numeric_limits<float>::max(), y0 = std::numeric_limits<float>::max();
+  auto x1 = std::numeric_limits<float>::lowest(), y1 = std::numeric_limits<float>::lowest();
+  for (const auto &camera : cameras_) {
+    auto r = camera.visible();
+    x0 = std::min(x0, r.x);
+    y0 = std::min(y0, r.y);
+    x1 = std::max(x1, r.x + r.w);
+    y1 = std::max(y1, r.y + r.h);
+  }
+  batches_->cull_to(x0, y0, x1 - x0, y1 - y0);
+}
 
-  shader_->use();
-  shader_->uniform_1f("z_max", 2.0f);
-  shader_->uniform_mat4f("projection", window_projection);
-  fbo_->use_texture("color");
+void RenderTarget::defer_clear_(const baphomet::RGB &color, gl::ClearMask mask) {
+  // A different clear changes pixels no primitive accounts for
+  const auto &last = deferred_clear_.color;
+  if (color.r != last.r || color.g != last.g || color.b != last.b || color.a != last.a || mask != deferred_clear_.mask)
+    batches_->damage_all();
 
-  vao_->draw_arrays(
-      gl::DrawMode::triangles,
-      vbo_->front() / 12,
-      vbo_->size() / 12
-  );
+  deferred_clear_.pending = true;
+  deferred_clear_.color = color;
+  deferred_clear_.mask = mask;
 }
 
 } // namespace baphomet
\ No newline at end of file
@@ -6,8 +6,10 @@ Spritesheet::Spritesheet(
     TexRenderFunc render_func,
     const std::string &name,
     std::unordered_map<std::string, glm::vec4> mappings,
-    float tile_w, float tile_h
-) : render_func_(render_func), name_(name), mappings_(mappings), tile_w_(tile_w), tile_h_(tile_h) {}
+    float tile_w, float tile_h,
+    TextureSource source
+) : render_func_(render_func), name_(name), mappings_(mappings), tile_w_(tile_w), tile_h_(tile_h),
+    source_(std::move(source)), atlased_(source_.pages != nullptr) {}
 
 float Spritesheet::tile_w() const {
   return tile_w_;
@@ -71,8 +73,8 @@ void Spritesheet::draw(
   );
 }
 
-SpritesheetBuilder::SpritesheetBuilder(TexRenderFunc render_func, const std::string &name)
-    : render_func_(render_func), name_(name) {}
+SpritesheetBuilder::SpritesheetBuilder(TexRenderFunc render_func, const std::string &name, TextureSource source)
+    : render_func_(render_func), name_(name), source_(std::move(source)) {}
 
 SpritesheetBuilder &SpritesheetBuilder::load_ini(const std::string &path) {
   // TODO: NYI
@@ -128,7 +130,7 @@ SpritesheetBuilder &SpritesheetBuilder::add_sprite(
 }
 
 std::unique_ptr<Spritesheet> SpritesheetBuilder::build() {
-  return std::make_unique<Spritesheet>(render_func_, name_, mappings_, tile_w_, tile_h_);
+  return std::make_unique<Spritesheet>(render_func_, name_, mappings_, tile_w_, tile_h_, source_);
 }
 
 } // namespace baphomet
@@ -0,0 +1,13 @@
+#include "baphomet/gfx/static_layer.hpp"
+
+namespace baphomet {
+
+bool StaticLayer::valid() const {
+  return geometry_ != nullptr;
+}
+
+void StaticLayer::invalidate() {
+  geometry_ = nullptr;
+}
+
+} // namespace baphomet
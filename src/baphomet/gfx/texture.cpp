@@ -5,8 +5,9 @@ namespace baphomet {
 Texture::Texture(
     TexRenderFunc render_func,
     const std::string &name,
-    GLuint width, GLuint height
-) : name_(name), width_(width), height_(height), render_func_(render_func) {}
+    GLuint width, GLuint height,
+    TextureSource source
+) : name_(name), width_(width), height_(height), source_(std::move(source)), render_func_(render_func) {}
 
 GLuint Texture::w() const {
   return width_;
@@ -0,0 +1,125 @@
+#include "baphomet/gfx/tilemap.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+
+namespace baphomet {
+
+Tilemap::Tilemap(std::unique_ptr<Spritesheet> &sheet, int cols, int rows)
+    : cols_(std::max(cols, 0)), rows_(std::max(rows, 0)) {
+  // Copied out, since the spritesheet may go away first
+  render_func_ = sheet->render_func_;
+  sprites_ = sheet->mappings_;
+  atlased_ = sheet->atlased_;
+  tile_w_ = sheet->tile_w_;
+  tile_h_ = sheet->tile_h_;
+
+  if (tile_w_ <= 0 || tile_h_ <= 0)
+    spdlog::error("Tilemaps need a tiled spritesheet, see SpritesheetBuilder::set_tiled");
+
+  chunk_cols_ = (cols_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  chunk_rows_ = (rows_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+  chunks_.resize(static_cast<std::size_t>(chunk_cols_) * chunk_rows_);
+  for (auto &chunk : chunks_)
+    chunk.tiles.resize(CHUNK_SIZE * CHUNK_SIZE, EMPTY);
+}
+
+int Tilemap::cols() const {
+  return cols_;
+}
+
+int Tilemap::rows() const {
+  return rows_;
+}
+
+float Tilemap::tile_w() const {
+  return tile_w_;
+}
+
+float Tilemap::tile_h() const {
+  return tile_h_;
+}
+
+int Tilemap::add_tile(const std::string &sprite_name) {
+  auto it = sprites_.find(sprite_name);
+  if (it == sprites_.end()) {
+    spdlog::error("Spritesheet has no sprite named '{}'", sprite_name);
+    return EMPTY;
+  }
+
+  const auto &m = it->second;
+  overhang_w_ = std::max(overhang_w_, m.z - tile_w_);
+  overhang_h_ = std::max(overhang_h_, m.w - tile_h_);
+
+  tiles_.push_back(m);
+  return static_cast<int>(tiles_.size()) - 1;
+}
+
+void Tilemap::set(int col, int row, int tile) {
+  if (col < 0 || row < 0 || col >= cols_ || row >= rows_)
+    return;
+
+  if (tile < 0 || tile >= static_cast<int>(tiles_.size()))
+    tile = EMPTY;
+
+  auto &chunk = chunk_at_(col, row);
+  auto &slot = chunk.tiles[(row % CHUNK_SIZE) * CHUNK_SIZE + (col % CHUNK_SIZE)];
+  if (slot == tile)
+    return;
+
+  if (slot == EMPTY)
+    chunk.filled++;
+  else if (tile == EMPTY)
+    chunk.filled--;
+
+  slot = tile;
+  chunk.dirty = true;
+}
+
+int Tilemap::get(int col, int row) const {
+  if (col < 0 || row < 0 || col >= cols_ || row >= rows_)
+    return EMPTY;
+
+  return chunk_at_(col, row).tiles[(row % CHUNK_SIZE) * CHUNK_SIZE + (col % CHUNK_SIZE)];
+}
+
+void Tilemap::fill(int tile) {
+  for (int row = 0; row < rows_; ++row)
+    for (int col = 0; col < cols_; ++col)
+      set(col, row, tile);
+}
+
+void Tilemap::invalidate() {
+  for (auto &chunk : chunks_)
+    chunk.dirty = true;
+}
+
+Tilemap::Chunk_ &Tilemap::chunk_at_(int col, int row) {
+  return chunks_[(row / CHUNK_SIZE) * chunk_cols_ + (col / CHUNK_SIZE)];
+}
+
+const Tilemap::Chunk_ &Tilemap::chunk_at_(int col, int row) const {
+  return chunks_[(row / CHUNK_SIZE) * chunk_cols_ + (col / CHUNK_SIZE)];
+}
+
+void Tilemap::draw_chunk_(const Chunk_ &chunk, float x, float y, float scale_x, float scale_y) {
+  for (int ly = 0; ly < CHUNK_SIZE; ++ly)
+    for (int lx = 0; lx < CHUNK_SIZE; ++lx) {
+      auto tile = chunk.tiles[ly * CHUNK_SIZE + lx];
+      if (tile == EMPTY)
+        continue;
+
+      const auto &m = tiles_[tile];
+      render_func_(
+          x + lx * tile_w_ * scale_x, y + ly * tile_h_ * scale_y,
+          m.z * scale_x, m.w * scale_y,
+          m.x, m.y, m.z, m.w,
+          0.0f, 0.0f, 0.0f,
+          rgb(0xffffff)
+      );
+    }
+}
+
+} // namespace baphomet
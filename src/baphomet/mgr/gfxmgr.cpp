@@ -2,13 +2,25 @@
 
 #include "baphomet/util/random.hpp"
 
+#include "spdlog/spdlog.h"
+
 #include <algorithm>
+#include <cmath>
+#include <utility>
 
 namespace baphomet {
 
 GfxMgr::GfxMgr(float width, float height) {
   resource_loader = std::make_unique<ResourceLoader>();
 
+  if (gl::StreamRing::supported())
+    stream_ring_ = std::make_shared<gl::StreamRing>(STREAM_RING_REGION_SIZE_);
+  else
+    spdlog::debug("Buffer storage unsupported, batches will use their own buffers");
+
+  compositor_ = std::make_unique<Compositor>();
+  frame_block_ = std::make_unique<gl::FrameBlock>();
+
   // create the default render target
   make_render_target(0, 0, width, height);
   push_render_target(render_targets_[0]);
@@ -32,6 +44,24 @@ GfxMgr &GfxMgr::operator=(GfxMgr &&other) noexcept {
  */
 
 void GfxMgr::clear(const baphomet::RGB &color, gl::ClearMask mask) {
+  // A cached render target keeps its contents until it's redrawn
+  auto &rt = render_stack_.top();
+  if (!rt->refreshing_)
+    return;
+
+  if (!recording_layer_ && rt->batches_->tracking_damage()) {
+    rt->defer_clear_(color, mask);
+    return;
+  }
+
+  clear_(color, mask);
+}
+
+void GfxMgr::clear(gl::ClearMask mask) {
+  clear(baphomet::rgba(0x00000000), mask);
+}
+
+void GfxMgr::clear_(const baphomet::RGB &color, gl::ClearMask mask) {
   glClearColor(
       static_cast<float>(color.r) / 255.0f,
       static_cast<float>(color.g) / 255.0f,
@@ -41,16 +71,12 @@ void GfxMgr::clear(const baphomet::RGB &color, gl::ClearMask mask) {
   glClear(unwrap(mask));
 }
 
-void GfxMgr::clear(gl::ClearMask mask) {
-  clear(baphomet::rgba(0x00000000), mask);
-}
-
 /*************
  * PRIMITIVES
  */
 
 void GfxMgr::pixel(float x, float y, const baphomet::RGB &color) {
-  render_stack_.top()->batches_->add_pixel(x, y, color);
+  active_batches_()->add_pixel(x, y, color);
 }
 
 void GfxMgr::pixel(Point p, const baphomet::RGB &color) {
@@ -58,7 +84,7 @@ void GfxMgr::pixel(Point p, const baphomet::RGB &color) {
 }
 
 void GfxMgr::line(float x0, float y0, float x1, float y1, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_line(x0, y0, x1, y1, color, cx, cy, angle);
+  active_batches_()->add_line(x0, y0, x1, y1, color, cx, cy, angle);
 }
 
 void GfxMgr::line(float x0, float y0, float x1, float y1, const baphomet::RGB &color, float angle) {
@@ -84,7 +110,7 @@ void GfxMgr::line(Line l, const baphomet::RGB &color) {
 // ********** FILLED ***********
 
 void GfxMgr::fill_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_tri(x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
+  active_batches_()->add_tri(x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
 }
 
 void GfxMgr::fill_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float angle) {
@@ -168,7 +194,7 @@ void GfxMgr::fill_tri(Point origin, float radius, const baphomet::RGB &color) {
 }
 
 void GfxMgr::fill_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_rect(x, y, w, h, color, cx, cy, angle);
+  active_batches_()->add_rect(x, y, w, h, color, cx, cy, angle);
 }
 
 void GfxMgr::fill_rect(float x, float y, float w, float h, const baphomet::RGB &color, float angle) {
@@ -192,7 +218,7 @@ void GfxMgr::fill_rect(Rect r, const baphomet::RGB &color) {
 }
 
 void GfxMgr::fill_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_oval(x, y, x_radius, y_radius, color, cx, cy, angle);
+  active_batches_()->add_oval(x, y, x_radius, y_radius, color, cx, cy, angle);
 }
 
 void GfxMgr::fill_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float angle) {
@@ -242,7 +268,7 @@ void GfxMgr::fill_circle(Circle c, const baphomet::RGB &color) {
 // ********** LINED ***********
 
 void GfxMgr::draw_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_lined_tri(x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
+  active_batches_()->add_lined_tri(x0, y0, x1, y1, x2, y2, color, cx, cy, angle);
 }
 
 void GfxMgr::draw_tri(float x0, float y0, float x1, float y1, float x2, float y2, const baphomet::RGB &color, float angle) {
@@ -326,7 +352,7 @@ void GfxMgr::draw_tri(Point origin, float radius, const baphomet::RGB &color) {
 }
 
 void GfxMgr::draw_rect(float x, float y, float w, float h, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_lined_rect(x, y, w, h, color, cx, cy, angle);
+  active_batches_()->add_lined_rect(x, y, w, h, color, cx, cy, angle);
 }
 
 void GfxMgr::draw_rect(float x, float y, float w, float h, const baphomet::RGB &color, float angle) {
@@ -350,7 +376,7 @@ void GfxMgr::draw_rect(Rect r, const baphomet::RGB &color) {
 }
 
 void GfxMgr::draw_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_lined_oval(x, y, x_radius, y_radius, color, cx, cy, angle);
+  active_batches_()->add_lined_oval(x, y, x_radius, y_radius, color, cx, cy, angle);
 }
 
 void GfxMgr::draw_oval(float x, float y, float x_radius, float y_radius, const baphomet::RGB &color, float angle) {
@@ -374,7 +400,7 @@ void GfxMgr::draw_oval(Oval o, const baphomet::RGB &color) {
 }
 
 void GfxMgr::draw_circle(float x, float y, float radius, const baphomet::RGB &color, float cx, float cy, float angle) {
-  render_stack_.top()->batches_->add_lined_oval(x, y, radius, radius, color, cx, cy, angle);
+  active_batches_()->add_lined_oval(x, y, radius, radius, color, cx, cy, angle);
 }
 
 void GfxMgr::draw_circle(float x, float y, float radius, const baphomet::RGB &color, float angle) {
@@ -401,22 +427,23 @@ void GfxMgr::draw_circle(Circle c, const baphomet::RGB &color) {
  * TEXTURES
  */
 
+void GfxMgr::use_texture_atlas(GLsizei page_size) {
+  atlas_page_size_ = page_size;
+}
+
 std::unique_ptr<Texture> GfxMgr::load_texture(const std::string &path, bool retro) {
   auto name = rnd::base58(11);
   resource_loader->load_texture_unit(name, path, retro);
 
-  auto &tex = resource_loader->get_texture_unit(name);
+  auto tex = resource_loader->get_texture_unit(name);
+  TextureSource source{};
+  auto render_func = texture_render_func_(name, retro, &source);
 
   return std::make_unique<Texture>(
-      [=, this](
-          float x, float y, float w, float h,
-          float tx, float ty, float tw, float th,
-          float cx, float cy, float angle,
-          const baphomet::RGB &color) {
-        render_texture_(name, tex, x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
-      },
+      render_func,
       name,
-      tex->width(), tex->height()
+      tex->width(), tex->height(),
+      source
   );
 }
 
@@ -424,37 +451,26 @@ SpritesheetBuilder GfxMgr::load_spritesheet(const std::string &path, bool retro)
   auto name = rnd::base58(11);
   resource_loader->load_texture_unit(name, path, retro);
 
-  auto &tex = resource_loader->get_texture_unit(name);
+  TextureSource source{};
+  auto render_func = texture_render_func_(name, retro, &source);
 
-  return SpritesheetBuilder(
-      [=, this](
-          float x, float y, float w, float h,
-          float tx, float ty, float tw, float th,
-          float cx, float cy, float angle,
-          const baphomet::RGB &color) {
-        render_texture_(name, tex, x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
-      },
-      name
-  );
+  return SpritesheetBuilder(render_func, name, source);
 }
 
 std::unique_ptr<CP437> GfxMgr::load_cp437(const std::string &path, int char_w, int char_h, bool retro) {
   auto name = rnd::base58(11);
   resource_loader->load_texture_unit(name, path, retro);
 
-  auto &tex = resource_loader->get_texture_unit(name);
+  auto tex = resource_loader->get_texture_unit(name);
+  TextureSource source{};
+  auto render_func = texture_render_func_(name, retro, &source);
 
   return std::make_unique<CP437>(
-      [=, this](
-          float x, float y, float w, float h,
-          float tx, float ty, float tw, float th,
-          float cx, float cy, float angle,
-          const baphomet::RGB &color) {
-        render_texture_(name, tex, x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
-      },
+      render_func,
       name,
       tex->width(), tex->height(),
-      char_w, char_h
+      char_w, char_h,
+      source
   );
 }
 
@@ -472,8 +488,13 @@ std::shared_ptr<RenderTarget> GfxMgr::make_render_target(float x, float y, float
   auto new_render_target = std::make_shared<RenderTarget>(
       rnd::base58(11),
       weight,
-      x, y, w, h
+      x, y, w, h,
+      stream_ring_
   );
+  new_render_target->batches_->unify_alpha(unify_alpha_batches_);
+  new_render_target->batches_->reorder_alpha(reorder_alpha_draws_);
+  new_render_target->batches_->fingerprint_uploads(fingerprint_uploads_);
+  new_render_target->batches_->cull(cull_offscreen_);
 
   // Find where this element should be inserted according to its weight
   auto it = std::upper_bound(
@@ -490,6 +511,46 @@ std::shared_ptr<RenderTarget> GfxMgr::make_render_target(float x, float y, float
   return make_render_target(x, y, w, h, next_render_target_weight_++);
 }
 
+void GfxMgr::unify_alpha_batches(bool unify) {
+  unify_alpha_batches_ = unify;
+  for (auto &render_target : render_targets_)
+    render_target->batches_->unify_alpha(unify);
+}
+
+void GfxMgr::reorder_alpha_draws(bool reorder) {
+  reorder_alpha_draws_ = reorder;
+  for (auto &render_target : render_targets_)
+    render_target->batches_->reorder_alpha(reorder);
+}
+
+void GfxMgr::fingerprint_uploads(bool enable) {
+  fingerprint_uploads_ = enable;
+  for (auto &render_target : render_targets_)
+    render_target->batches_->fingerprint_uploads(enable);
+}
+
+const gl::UploadStats &GfxMgr::upload_stats() const {
+  return last_upload_stats_;
+}
+
+const gl::StateStats &GfxMgr::state_stats() const {
+  return last_state_stats_;
+}
+
+void GfxMgr::shader_binary_cache(const std::filesystem::path &dir) {
+  gl::ShaderBuilder::binary_cache(dir);
+}
+
+void GfxMgr::cull_offscreen(bool cull) {
+  cull_offscreen_ = cull;
+  for (auto &render_target : render_targets_)
+    render_target->batches_->cull(cull);
+}
+
+std::size_t GfxMgr::culled_count() const {
+  return last_culled_count_;
+}
+
 void GfxMgr::push_render_target(std::shared_ptr<RenderTarget> &render_target) {
   render_stack_.push(render_target);
   render_target->fbo_->bind();
@@ -502,6 +563,200 @@ void GfxMgr::pop_render_target(std::size_t count) {
   render_stack_.top()->fbo_->bind();
 }
 
+/****************
+ * STATIC LAYERS
+ */
+
+std::shared_ptr<StaticLayer> GfxMgr::make_static_layer() {
+  return std::make_shared<StaticLayer>();
+}
+
+void GfxMgr::begin_static_layer(const std::shared_ptr<StaticLayer> &layer) {
+  if (recording_layer_) {
+    spdlog::error("Already recording a static layer, finish it with end_static_layer first");
+    return;
+  }
+
+  if (!layer->recorder_) {
+    layer->recorder_ = std::make_unique<BatchSet>();
+    layer->recorder_->record_static(true);
+  }
+  layer->recorder_->clear();
+
+  recording_layer_ = layer;
+}
+
+void GfxMgr::end_static_layer() {
+  if (!recording_layer_) {
+    spdlog::error("No static layer is being recorded");
+    return;
+  }
+
+  recording_layer_->geometry_ = recording_layer_->recorder_->bake_static();
+
+  // The CPU side copy is only needed while recording
+  recording_layer_->recorder_ = nullptr;
+  recording_layer_ = nullptr;
+}
+
+void GfxMgr::draw_static_layer(const std::shared_ptr<StaticLayer> &layer, float x, float y, float scale_x, float scale_y) {
+  if (!layer->valid()) {
+    spdlog::warn("Static layer hasn't been recorded, or was invalidated");
+    return;
+  }
+
+  active_batches_()->add_static_layer(layer->geometry_, x, y, scale_x, scale_y);
+}
+
+void GfxMgr::draw_static_layer(const std::shared_ptr<StaticLayer> &layer, float x, float y) {
+  draw_static_layer(layer, x, y, 1.0f, 1.0f);
+}
+
+void GfxMgr::draw_static_layer(const std::shared_ptr<StaticLayer> &layer) {
+  draw_static_layer(layer, 0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+/*****************
+ * PIXEL CANVASES
+ */
+
+std::shared_ptr<PixelCanvas> GfxMgr::make_pixel_canvas(int width, int height, bool opaque, bool retro) {
+  return std::make_shared<PixelCanvas>(rnd::base58(11), width, height, opaque, retro);
+}
+
+void GfxMgr::draw_pixel_canvas(const std::shared_ptr<PixelCanvas> &canvas, float x, float y, float w, float h) {
+  auto batches = active_batches_();
+
+  // Damage records only see the quad, not what's in the texture, so new
+  // contents have to damage the target on their own
+  if (canvas->upload_() && batches->tracking_damage())
+    batches->damage_all();
+
+  render_texture_(
+      canvas->name_, canvas->tex_unit_,
+      x, y, w, h,
+      0.0f, 0.0f, canvas->width_, canvas->height_,
+      0.0f, 0.0f, 0.0f,
+      rgb(0xffffff)
+  );
+}
+
+void GfxMgr::draw_pixel_canvas(const std::shared_ptr<PixelCanvas> &canvas, float x, float y) {
+  draw_pixel_canvas(canvas, x, y, canvas->width_, canvas->height_);
+}
+
+void GfxMgr::draw_pixel_canvas(const std::shared_ptr<PixelCanvas> &canvas) {
+  draw_pixel_canvas(canvas, 0.0f, 0.0f, canvas->width_, canvas->height_);
+}
+
+/***********
+ * TILEMAPS
+ */
+
+std::shared_ptr<Tilemap> GfxMgr::make_tilemap(std::unique_ptr<Spritesheet> &sheet, int cols, int rows) {
+  return std::make_shared<Tilemap>(sheet, cols, rows);
+}
+
+void GfxMgr::draw_tilemap(const std::shared_ptr<Tilemap> &tilemap, float x, float y, float scale_x, float scale_y) {
+  auto chunk_w = Tilemap::CHUNK_SIZE * tilemap->tile_w_ * scale_x;
+  auto chunk_h = Tilemap::CHUNK_SIZE * tilemap->tile_h_ * scale_y;
+  if (chunk_w <= 0.0f || chunk_h <= 0.0f)
+    return;
+
+  // Chunks the target can't show are never looked at, so the cost follows
+  // the view rather than the size of the map. Everything is visible to a
+  // static layer being recorded.
+  int c0 = 0, r0 = 0;
+  int c1 = tilemap->chunk_cols_, r1 = tilemap->chunk_rows_;
+
+  auto view = active_batches_()->cull_bounds();
+  if (!recording_layer_ && std::isfinite(view.x) && std::isfinite(view.w) && std::isfinite(view.y) && std::isfinite(view.h)) {
+    // Oversized tiles hang into the tiles to their right and below, so a
+    // chunk up and to the left of the view can still reach into it
+    auto overhang_x = tilemap->overhang_w_ * scale_x;
+    auto overhang_y = tilemap->overhang_h_ * scale_y;
+    view.x -= overhang_x;
+    view.y -= overhang_y;
+    view.w += overhang_x;
+    view.h += overhang_y;
+
+    auto to_chunk = [](float v, int count) {
+      return static_cast<int>(std::clamp(v, 0.0f, static_cast<float>(count)));
+    };
+    c0 = to_chunk(std::floor((view.x - x) / chunk_w), c1);
+    r0 = to_chunk(std::floor((view.y - y) / chunk_h), r1);
+    c1 = to_chunk(std::ceil((view.x + view.w - x) / chunk_w), c1);
+    r1 = to_chunk(std::ceil((view.y + view.h - y) / chunk_h), r1);
+  }
+
+  for (int r = r0; r < r1; ++r)
+    for (int c = c0; c < c1; ++c) {
+      auto &chunk = tilemap->chunks_[r * tilemap->chunk_cols_ + c];
+      if (chunk.filled == 0)
+        continue;
+
+      auto chunk_x = x + c * chunk_w;
+      auto chunk_y = y + r * chunk_h;
+
+      // Only atlas sprites can be baked, and layers can't be nested
+      if (!tilemap->atlased_ || recording_layer_) {
+        tilemap->draw_chunk_(chunk, chunk_x, chunk_y, scale_x, scale_y);
+        continue;
+      }
+
+      if (chunk.dirty || !chunk.layer || !chunk.layer->valid()) {
+        if (!chunk.layer)
+          chunk.layer = make_static_layer();
+
+        begin_static_layer(chunk.layer);
+        tilemap->draw_chunk_(chunk, 0.0f, 0.0f, 1.0f, 1.0f);
+        end_static_layer();
+
+        chunk.dirty = false;
+      }
+      draw_static_layer(chunk.layer, chunk_x, chunk_y, scale_x, scale_y);
+    }
+}
+
+void GfxMgr::draw_tilemap(const std::shared_ptr<Tilemap> &tilemap, float x, float y) {
+  draw_tilemap(tilemap, x, y, 1.0f, 1.0f);
+}
+
+void GfxMgr::draw_tilemap(const std::shared_ptr<Tilemap> &tilemap) {
+  draw_tilemap(tilemap, 0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+/************
+ * RECORDERS
+ */
+
+DrawRecorder GfxMgr::make_recorder(std::uint64_t sort_key) {
+  DrawRecorder recorder(sort_key);
+
+  auto batches = active_batches_();
+  auto view = batches->cull_bounds();
+  if (cull_offscreen_ && std::isfinite(view.w) && std::isfinite(view.h))
+    recorder.cull_to(view.x, view.y, view.w, view.h);
+  recorder.track_damage(batches->tracking_damage());
+
+  return recorder;
+}
+
+void GfxMgr::merge_recorders(std::span<DrawRecorder *const> recorders) {
+  active_batches_()->merge(recorders);
+}
+
+void GfxMgr::merge_recorder(DrawRecorder &recorder) {
+  DrawRecorder *recorders[] = {&recorder};
+  merge_recorders(recorders);
+}
+
+BatchSet *GfxMgr::active_batches_() {
+  if (recording_layer_)
+    return recording_layer_->recorder_.get();
+  return render_stack_.top()->batches_.get();
+}
+
 void GfxMgr::update_(Duration dt) {
   for (auto &&ps : particle_systems_)
     ps->update_(dt);
@@ -512,11 +767,11 @@ void GfxMgr::update_(Duration dt) {
  */
 
 void GfxMgr::enable_(gl::Capability cap) {
-  glEnable(unwrap(cap));
+  gl::state_cache().set_enabled(cap, true);
 }
 
 void GfxMgr::disable_(gl::Capability cap) {
-  glDisable(unwrap(cap));
+  gl::state_cache().set_enabled(cap, false);
 }
 
 void GfxMgr::depth_func_(gl::DepthFunc func) {
@@ -524,15 +779,15 @@ void GfxMgr::depth_func_(gl::DepthFunc func) {
 }
 
 void GfxMgr::depth_mask_(bool flag) {
-  glDepthMask(flag ? GL_TRUE : GL_FALSE);
+  gl::state_cache().depth_mask(flag);
 }
 
 void GfxMgr::blend_func_(gl::BlendFunc src, gl::BlendFunc dst) {
-  glBlendFunc(unwrap(src), unwrap(dst));
+  gl::state_cache().blend_func(src, dst);
 }
 
 void GfxMgr::viewport_(int x, int y, int w, int h) {
-  glViewport(x, y, w, h);
+  gl::state_cache().viewport(x, y, w, h);
 }
 
 void GfxMgr::clip_control_(gl::ClipOrigin origin, gl::ClipDepth depth) {
@@ -548,8 +803,10 @@ void GfxMgr::flush_() {
  */
 
 void GfxMgr::clear_render_targets_() {
-  for (auto &rt : render_targets_)
+  for (auto &rt : render_targets_) {
+    rt->begin_frame_();
     rt->batches_->clear();
+  }
 }
 
 void GfxMgr::reset_to_base_render_target_() {
@@ -562,45 +819,128 @@ void GfxMgr::draw_render_targets_(
     GLsizei window_width, GLsizei window_height,
     glm::mat4 projection
 ) {
+  // Anything may have touched GL since last frame (ImGui, user code), so
+  // the cache starts over rather than trusting what it saw then
+  gl::state_cache().invalidate();
+
   // Clear the window itself of all drawing with a *real* black (non-transparent)
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glViewport(0, 0, window_width, window_height);
-  clear(baphomet::rgb(0x000000));
+  gl::state_cache().bind_framebuffer(0);
+  viewport_(0, 0, window_width, window_height);
+  clear_(baphomet::rgb(0x000000), gl::ClearMask::color | gl::ClearMask::depth);
+
+  if (stream_ring_)
+    stream_ring_->begin_frame();
+  frame_block_->begin_frame();
 
+  last_culled_count_ = 0;
   for (auto &rt : render_targets_) {
+    last_culled_count_ += rt->batches_->culled_count();
+
+    // Cached render targets that aren't due keep last time's texture
+    if (!rt->refreshing_)
+      continue;
+
+    // Only what changed needs redrawing
+    bool tracked = rt->batches_->tracking_damage();
+    if (tracked) {
+      rt->damage_ = rt->batches_->take_damage();
+      if (rt->damage_.w <= 0.0f || rt->damage_.h <= 0.0f) {
+        rt->end_frame_();
+        continue;
+      }
+    }
+
     rt->fbo_->bind();
 
-    rt->batches_->draw_opaque(rt->projection_);
+    if (rt->cameras_.empty()) {
+      if (tracked) {
+        // The damage is in target pixels here, so it can be scissored to
+        scissor_(rt->fbo_->height, rt->damage_);
+        enable_(gl::Capability::scissor_test);
+
+        if (rt->deferred_clear_.pending)
+          clear_(rt->deferred_clear_.color, rt->deferred_clear_.mask);
+      }
+
+      draw_batches_(*rt->batches_, rt->projection_, glm::mat4(1.0f));
+
+      if (tracked)
+        disable_(gl::Capability::scissor_test);
+    } else {
+      // Damage is in world coordinates with cameras, so it only decides
+      // whether to redraw at all
+      if (tracked && rt->deferred_clear_.pending)
+        clear_(rt->deferred_clear_.color, rt->deferred_clear_.mask);
+
+      for (std::size_t i = 0; i < rt->cameras_.size(); i++) {
+        const auto &camera = rt->cameras_[i];
+        auto viewport = camera.viewport();
+
+        viewport_(
+            static_cast<GLint>(viewport.x),
+            static_cast<GLint>(rt->fbo_->height - viewport.y - viewport.h),
+            static_cast<GLsizei>(viewport.w),
+            static_cast<GLsizei>(viewport.h)
+        );
+
+        // Every camera draws the same depths, so later ones need the
+        // depth buffer back where they draw
+        if (i > 0) {
+          scissor_(rt->fbo_->height, viewport);
+          enable_(gl::Capability::scissor_test);
+          clear_(baphomet::rgba(0x00000000), gl::ClearMask::depth);
+          disable_(gl::Capability::scissor_test);
+        }
+
+        draw_batches_(*rt->batches_, camera.projection(), camera.view());
+      }
+    }
+
+    rt->end_frame_();
+  }
 
-    // There is no way this actually single-handedly fixed the alpha blending issue,
-    // but I cannot currently find a case that it *didn't* work on, so whatever I guess?
-    glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA, GL_ONE);
-    enable_(gl::Capability::blend);
-    depth_mask_(false);
+  // Reset back to the default framebuffer, and put every target on it in
+  // as few draws as possible
+  gl::state_cache().bind_framebuffer(0);
+  compositor_->draw(render_targets_, window_width, window_height, projection);
 
-    rt->batches_->draw_alpha(rt->projection_);
+  if (stream_ring_)
+    stream_ring_->end_frame();
 
-    depth_mask_(true);
-    disable_(gl::Capability::blend);
+  last_upload_stats_ = std::exchange(gl::upload_stats(), {});
+  last_state_stats_ = std::exchange(gl::state_cache().stats(), {});
+}
 
-    // Reset back to the default framebuffer
-    // and fix the viewport, so we can draw on it
-    rt->fbo_->unbind();
-    glViewport(0, 0, window_width, window_height);
+void GfxMgr::draw_batches_(BatchSet &batches, const glm::mat4 &projection, const glm::mat4 &view) {
+  // Every batch reads these from the frame block, rather than each one
+  // setting its own uniforms
+  frame_block_->write(projection, view, batches.z_max());
 
-    // This needs to be done between each call
-    clear(gl::ClearMask::depth);
+  batches.draw_opaque();
 
-    // Blend in case we did a transparent
-    // clear on this layer
-    enable_(gl::Capability::blend);
-    depth_mask_(false);
+  // There is no way this actually single-handedly fixed the alpha blending issue,
+  // but I cannot currently find a case that it *didn't* work on, so whatever I guess?
+  gl::state_cache().blend_func(
+      gl::BlendFunc::one, gl::BlendFunc::one_minus_src_alpha,
+      gl::BlendFunc::one_minus_dst_alpha, gl::BlendFunc::one
+  );
+  enable_(gl::Capability::blend);
+  depth_mask_(false);
 
-    rt->draw_(projection);
+  batches.draw_alpha();
 
-    depth_mask_(true);
-    disable_(gl::Capability::blend);
-  }
+  depth_mask_(true);
+  disable_(gl::Capability::blend);
+}
+
+void GfxMgr::scissor_(GLsizei target_height, const Rect &rect) {
+  // Scissor boxes start at the bottom left
+  glScissor(
+      static_cast<GLint>(rect.x),
+      static_cast<GLint>(target_height - rect.y - rect.h),
+      static_cast<GLsizei>(rect.w),
+      static_cast<GLsizei>(rect.h)
+  );
 }
 
 void GfxMgr::resize_builtin_render_targets_(int width, int height) {
@@ -618,7 +958,7 @@ void GfxMgr::render_texture_(
     float cx, float cy, float angle,
     const baphomet::RGB &color
 ) {
-  render_stack_.top()->batches_->add_texture(
+  active_batches_()->add_texture(
       name, tex_unit,
       x, y, w, h,
       tx, ty, tw, th,
@@ -627,4 +967,70 @@ void GfxMgr::render_texture_(
   );
 }
 
+TexRenderFunc GfxMgr::texture_render_func_(const std::string &name, bool retro, TextureSource *source) {
+  auto tex = resource_loader->get_texture_unit(name);
+  if (source)
+    *source = {name, tex, nullptr, 0, 0.0f, 0.0f, tex->fully_opaque()};
+
+  if (atlas_page_size_ > 0) {
+    auto &atlas = atlases_[retro ? 1 : 0];
+    if (!atlas)
+      atlas = std::make_unique<gl::TextureAtlas>(atlas_page_size_, retro);
+
+    if (auto region = atlas->add(*tex)) {
+      std::string pages_name = retro ? "atlas_retro" : "atlas";
+      auto pages = atlas->pages();
+      auto fully_opaque = tex->fully_opaque();
+
+      // The pixels live in the atlas now, so the texture itself can go
+      resource_loader->unload_texture_unit(name);
+      if (source)
+        *source = {pages_name, nullptr, pages, region->layer, static_cast<float>(region->x), static_cast<float>(region->y), fully_opaque};
+
+      // Mappings stay relative to the original texture, and are moved
+      // to where it was packed here
+      return [=, this](
+          float x, float y, float w, float h,
+          float tx, float ty, float tw, float th,
+          float cx, float cy, float angle,
+          const baphomet::RGB &color) {
+        render_sprite_(
+            pages_name, pages, region->layer, fully_opaque,
+            x, y, w, h,
+            tx + region->x, ty + region->y, tw, th,
+            cx, cy, angle,
+            color
+        );
+      };
+    }
+  }
+
+  return [=, this](
+      float x, float y, float w, float h,
+      float tx, float ty, float tw, float th,
+      float cx, float cy, float angle,
+      const baphomet::RGB &color) {
+    render_texture_(name, tex, x, y, w, h, tx, ty, tw, th, cx, cy, angle, color);
+  };
+}
+
+void GfxMgr::render_sprite_(
+    const std::string &pages_name,
+    const std::shared_ptr<gl::TextureArray> &pages,
+    int layer, bool fully_opaque,
+    float x, float y, float w, float h,
+    float tx, float ty, float tw, float th,
+    float cx, float cy, float angle,
+    const baphomet::RGB &color
+) {
+  active_batches_()->add_sprite(
+      pages_name, pages,
+      layer, fully_opaque,
+      x, y, w, h,
+      tx, ty, tw, th,
+      cx, cy, angle,
+      color
+  );
+}
+
 } // namespace baphomet
@@ -0,0 +1,47 @@
+#include "baphomet/util/hash.hpp"
+
+#include <cstring>
+
+namespace baphomet {
+
+// MurmurHash64A, which takes the input a word at a time
+std::uint64_t hash64(const void *data, std::size_t size, std::uint64_t seed) {
+  constexpr std::uint64_t m = 0xc6a4a7935bd1e995ull;
+  constexpr int r = 47;
+
+  auto bytes = static_cast<const unsigned char *>(data);
+  std::uint64_t h = seed ^ (size * m);
+
+  auto words = size / 8;
+  for (std::size_t i = 0; i < words; ++i) {
+    std::uint64_t k;
+    std::memcpy(&k, bytes + i * 8, 8);
+
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  auto tail = bytes + words * 8;
+  switch (size & 7) {
+    case 7: h ^= std::uint64_t(tail[6]) << 48; [[fallthrough]];
+    case 6: h ^= std::uint64_t(tail[5]) << 40; [[fallthrough]];
+    case 5: h ^= std::uint64_t(tail[4]) << 32; [[fallthrough]];
+    case 4: h ^= std::uint64_t(tail[3]) << 24; [[fallthrough]];
+    case 3: h ^= std::uint64_t(tail[2]) << 16; [[fallthrough]];
+    case 2: h ^= std::uint64_t(tail[1]) << 8;  [[fallthrough]];
+    case 1: h ^= std::uint64_t(tail[0]);
+            h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+
+  return h;
+}
+
+} // namespace baphomet